@@ -0,0 +1,127 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include "Fill.h"
+#include "Instrument.h"
+#include <cstdint>
+#include <type_traits>
+
+// Binary order entry for OrderGateway. Every message is a fixed-size little-endian struct that
+// starts with a BinaryHeader; sizes are multiples of 8, so messages read in place from the receive
+// buffer stay aligned. Prices are integer ticks of the symbol's tick size. Order IDs and symbols are
+// NUL-padded. A session is binary if its first bytes are BINARY_SESSION_MAGIC (the gateway echoes
+// them back); a session that starts with anything else speaks the text protocol.
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Binary messages are sent in host byte order, which must be little-endian");
+#endif
+
+// Text requests never start with a NUL byte; the last byte is the protocol version
+const char BINARY_SESSION_MAGIC[8] = {'\0', 'V', 'C', 'B', 'I', 'N', '\0', '\1'};
+
+// Longest symbol a binary message carries
+const std::size_t BINARY_SYMBOL_LENGTH = 16;
+
+enum class BinaryMessageType : std::uint8_t {
+    NEW_ORDER = 1, // Client -> gateway
+    CANCEL = 2,    // Client -> gateway
+    MODIFY = 3,    // Client -> gateway
+    ACK = 4,       // Gateway -> client: the request named in BinaryAck::request was applied
+    FILL = 5,      // Gateway -> client, to the sessions that entered either side
+    REJECT = 6     // Gateway -> client
+};
+
+enum class RejectReason : std::uint8_t {
+    INVALID_ORDER_ID = 1,
+    INVALID_SYMBOL = 2,
+    INVALID_SIDE = 3,
+    INVALID_PRICE = 4,
+    PRICE_NOT_ON_TICK = 5, // Text requests only; binary prices are ticks already
+    INVALID_QUANTITY = 6,
+    UNKNOWN_ORDER = 7,
+    ENGINE_REJECTED = 8
+};
+
+// Side byte of NEW_ORDER and FILL
+const std::uint8_t BINARY_SIDE_BUY = 'B';
+const std::uint8_t BINARY_SIDE_SELL = 'S';
+
+struct BinaryHeader {
+    std::uint16_t length; // Of the whole message; must match the size of its type
+    BinaryMessageType type;
+    std::uint8_t reserved;
+};
+
+struct BinaryNewOrder {
+    BinaryHeader header;
+    std::int32_t quantity;
+    Price price;
+    std::uint8_t side;
+    std::uint8_t reserved[7];
+    char symbol[BINARY_SYMBOL_LENGTH];
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+struct BinaryCancel {
+    BinaryHeader header;
+    std::uint32_t reserved;
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+struct BinaryModify {
+    BinaryHeader header;
+    std::int32_t quantity;
+    Price price;
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+struct BinaryAck {
+    BinaryHeader header;
+    BinaryMessageType request; // NEW_ORDER, MODIFY or CANCEL
+    std::uint8_t reserved[3];
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+struct BinaryFill {
+    BinaryHeader header;
+    std::int32_t quantity;
+    Price price;
+    std::uint64_t tradeId;
+    std::uint8_t side; // Of the order this fill is reported for
+    std::uint8_t reserved[7];
+    char symbol[BINARY_SYMBOL_LENGTH]; // Cut to BINARY_SYMBOL_LENGTH if longer
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+struct BinaryReject {
+    BinaryHeader header;
+    RejectReason reason;
+    BinaryMessageType request;
+    std::uint8_t reserved[2];
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+static_assert(sizeof(BinaryHeader) == 4, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryNewOrder) == 72, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryCancel) == 40, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryModify) == 48, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryAck) == 40, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryFill) == 80, "Binary message layout is part of the protocol");
+static_assert(sizeof(BinaryReject) == 40, "Binary message layout is part of the protocol");
+static_assert(std::is_trivially_copyable<BinaryNewOrder>::value && std::is_trivially_copyable<BinaryFill>::value,
+              "Binary messages are sent as raw bytes");
+
+// Size of a message of the given type; 0 for a type the protocol does not have
+inline std::size_t binaryMessageSize(BinaryMessageType type) {
+    switch (type) {
+        case BinaryMessageType::NEW_ORDER: return sizeof(BinaryNewOrder);
+        case BinaryMessageType::CANCEL: return sizeof(BinaryCancel);
+        case BinaryMessageType::MODIFY: return sizeof(BinaryModify);
+        case BinaryMessageType::ACK: return sizeof(BinaryAck);
+        case BinaryMessageType::FILL: return sizeof(BinaryFill);
+        case BinaryMessageType::REJECT: return sizeof(BinaryReject);
+        default: return 0;
+    }
+}
+
+#endif // BINARY_PROTOCOL_H
@@ -95,8 +95,14 @@ void CLI::placeOrder() {
     }
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Clear buffer after numeric input
 
+    const Instrument& instrument = matchingEngine.getSymbols().getInstrument(symbol);
+    if (!instrument.isOnTick(price)) {
+        consoleLogger.consoleLog("Invalid price. Must be a multiple of the tick size " + std::to_string(instrument.tickSize) + ".");
+        return;
+    }
+
     std::string orderId = generateUniqueOrderId();
-    Order newOrder(orderId, symbol, type, price, quantity);
+    Order newOrder(orderId, matchingEngine.internSymbol(symbol), type, instrument.toTicks(price), quantity);
     matchingEngine.placeOrder(newOrder);
     consoleLogger.consoleLog("Order placed successfully with ID: " + orderId);
 }
@@ -129,7 +135,17 @@ void CLI::modifyOrder() {
     }
     std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Clear buffer
 
-    matchingEngine.modifyOrder(orderId, newPrice, newQuantity);
+    const Instrument* instrument = matchingEngine.getOrderInstrument(orderId);
+    if (instrument == nullptr) {
+        consoleLogger.consoleLog("Order ID " + orderId + " not found.");
+        return;
+    }
+    if (!instrument->isOnTick(newPrice)) {
+        consoleLogger.consoleLog("Invalid price. Must be a multiple of the tick size " + std::to_string(instrument->tickSize) + ".");
+        return;
+    }
+
+    matchingEngine.modifyOrder(orderId, instrument->toTicks(newPrice), newQuantity);
 }
 
 void CLI::cancelOrder() {
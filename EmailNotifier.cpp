@@ -1,50 +1,197 @@
 #include "EmailNotifier.h"
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
-EmailNotifier::EmailNotifier() {}
+// Most notifications one digest pass collects before it sends
+static const std::size_t MAX_BURST = 256;
+// How long an idle worker sleeps between polls
+static const std::chrono::microseconds WORKER_IDLE_SLEEP(200);
 
-void EmailNotifier::sendOrderPlacedNotification(const Order& order) {
-    std::stringstream ss;
-    ss << "Order Placed Successfully\n"
-       << "Order ID: " << order.getOrderId() << "\n"
-       << "Symbol: " << order.getSymbol() << "\n"
-       << "Type: " << (order.getType() == BUY ? "BUY" : "SELL") << "\n"
-       << "Price: ₹" << order.getPrice() << "\n"
-       << "Quantity: " << order.getQuantity();
+const std::string EmailNotifier::DEFAULT_RECIPIENT = "User (mocked)";
 
-    simulateSend("Order Placed", ss.str());
+static void printColored(const std::string& text, int colorCode) {
+    std::cout << "\033[" << colorCode << "m" << text << "\033[0m";
 }
 
-void EmailNotifier::sendTradeExecutedNotification(const Trade& trade) {
-    std::stringstream ss;
-    ss << "Trade Executed Successfully\n"
-       << "Trade ID: " << trade.getTradeId() << "\n"
-       << "Buy Order ID: " << trade.getBuyOrderId() << "\n"
-       << "Sell Order ID: " << trade.getSellOrderId() << "\n"
-       << "Symbol: " << trade.getSymbol() << "\n"
-       << "Price: ₹" << trade.getPrice() << "\n"
-       << "Quantity: " << trade.getQuantity();
+static std::string formatTrade(const Fill& fill, const char* symbol, double tickSize) {
+    Instrument instrument;
+    instrument.tickSize = tickSize;
+    std::ostringstream line;
+    line << "Trade ID: " << fill.sequence << ", Buy Order ID: " << fill.buyOrderId << ", Sell Order ID: " << fill.sellOrderId
+         << ", Symbol: " << symbol << ", Price: " << instrument.formatPrice(fill.price) << ", Quantity: " << fill.quantity
+         << ", Timestamp (ns): " << fill.timestamp;
+    return line.str();
+}
+
+static const char* eventLabel(NotificationType type) {
+    switch (type) {
+        case NotificationType::ORDER_PLACED: return "Order Placed";
+        case NotificationType::ORDER_MODIFIED: return "Order Modified";
+        case NotificationType::ORDER_CANCELLED: return "Order Cancelled";
+        default: return "Trade Notification";
+    }
+}
+
+EmailNotifier::EmailNotifier(std::size_t outboxCapacity, std::chrono::microseconds window)
+    : coalesceWindow(window), outbox(outboxCapacity) {
+    notificationLog.open("notifications.log", std::ios::app);
+    worker = std::thread(&EmailNotifier::runWorker, this);
+}
+
+EmailNotifier::~EmailNotifier() {
+    stopping.store(true, std::memory_order_release);
+    worker.join(); // The worker drains the outbox before it exits
+}
+
+void EmailNotifier::sendTradeNotification(const Fill& fill, const Instrument& instrument, const std::string& recipient) {
+    if (!isEnabled()) return;
+    Notification notification;
+    notification.type = NotificationType::TRADE;
+    notification.length = 0;
+    notification.fill = fill;
+    notification.tickSize = instrument.tickSize;
+    copyOrderId(notification.symbol, instrument.symbol);
+    copyOrderId(notification.recipient, recipient);
+    submit(notification);
+}
+
+void EmailNotifier::sendOrderPlaced(const std::string& orderDetails, const std::string& recipient) {
+    sendOrderEvent(NotificationType::ORDER_PLACED, orderDetails, recipient);
+}
+
+void EmailNotifier::sendOrderModified(const std::string& orderDetails, const std::string& recipient) {
+    sendOrderEvent(NotificationType::ORDER_MODIFIED, orderDetails, recipient);
+}
+
+void EmailNotifier::sendOrderCancelled(const std::string& orderDetails, const std::string& recipient) {
+    sendOrderEvent(NotificationType::ORDER_CANCELLED, orderDetails, recipient);
+}
 
-    simulateSend("Trade Executed", ss.str());
+void EmailNotifier::sendOrderEvent(NotificationType type, const std::string& orderDetails, const std::string& recipient) {
+    if (!isEnabled()) return;
+    Notification notification;
+    notification.type = type;
+    if (orderDetails.size() <= NOTIFICATION_TEXT_SIZE) {
+        notification.length = static_cast<std::uint16_t>(orderDetails.size());
+        std::memcpy(notification.text, orderDetails.data(), orderDetails.size());
+    } else {
+        notification.length = static_cast<std::uint16_t>(NOTIFICATION_TEXT_SIZE);
+        std::memcpy(notification.text, orderDetails.data(), NOTIFICATION_TEXT_SIZE - 3);
+        std::memcpy(notification.text + NOTIFICATION_TEXT_SIZE - 3, "...", 3);
+    }
+    copyOrderId(notification.recipient, recipient);
+    submit(notification);
 }
 
-void EmailNotifier::sendOrderCancelledNotification(const Order& order) {
-    std::stringstream ss;
-    ss << "Order Cancelled\n"
-       << "Order ID: " << order.getOrderId() << "\n"
-       << "Symbol: " << order.getSymbol() << "\n"
-       << "Type: " << (order.getType() == BUY ? "BUY" : "SELL") << "\n"
-       << "Price: ₹" << order.getPrice() << "\n"
-       << "Quantity: " << order.getQuantity();
+void EmailNotifier::submit(const Notification& notification) {
+    if (!outbox.tryPush(notification)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // Counted once pushed, so flush() never waits for a notification that was dropped
+    accepted.fetch_add(1, std::memory_order_release);
+}
 
-    simulateSend("Order Cancelled", ss.str());
+void EmailNotifier::flush() {
+    const std::uint64_t target = accepted.load(std::memory_order_acquire);
+    while (sent.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
 }
 
-void EmailNotifier::simulateSend(const std::string& subject, const std::string& message) {
-    std::cout << "\n📧 [Email Notification] " << subject << "\n";
-    std::cout << "-----------------------------------\n";
-    std::cout << message << "\n";
-    std::cout << "-----------------------------------\n";
+void EmailNotifier::runWorker() {
+    std::vector<Notification> burst;
+    burst.reserve(MAX_BURST);
+    std::chrono::steady_clock::time_point burstStart;
+    while (true) {
+        // Read the stop flag first, so an outbox found empty afterwards really is drained
+        bool stop = stopping.load(std::memory_order_acquire);
+        bool started = burst.empty();
+        std::size_t count = outbox.drain([&burst](const Notification& notification) { burst.push_back(notification); },
+                                         MAX_BURST - burst.size());
+        if (count > 0 && started) {
+            burstStart = std::chrono::steady_clock::now();
+        }
+        // The rest of a burst (an order sweeping several levels) is usually right behind, but a steady
+        // stream must not hold the first notification back for longer than the window
+        auto waited = std::chrono::steady_clock::now() - burstStart;
+        if (count > 0 && burst.size() < MAX_BURST && waited < coalesceWindow) {
+            std::this_thread::sleep_for(coalesceWindow - waited);
+            continue;
+        }
+        if (!burst.empty()) {
+            sendDigests(burst);
+            sent.fetch_add(burst.size(), std::memory_order_release);
+            burst.clear();
+            continue;
+        }
+        reportDrops();
+        if (stop) {
+            break;
+        }
+        std::this_thread::sleep_for(WORKER_IDLE_SLEEP);
+    }
 }
 
+void EmailNotifier::sendDigests(const std::vector<Notification>& burst) {
+    // One digest per recipient, in order of each recipient's first notification
+    std::vector<bool> done(burst.size(), false);
+    for (std::size_t first = 0; first < burst.size(); ++first) {
+        if (done[first]) {
+            continue;
+        }
+        const char* recipient = burst[first].recipient;
+        std::vector<std::string> lines;
+        std::size_t trades = 0;
+        for (std::size_t i = first; i < burst.size(); ++i) {
+            const Notification& notification = burst[i];
+            if (done[i] || std::strcmp(notification.recipient, recipient) != 0) {
+                continue;
+            }
+            done[i] = true;
+            if (notification.type == NotificationType::TRADE) {
+                trades++;
+                lines.push_back(formatTrade(notification.fill, notification.symbol, notification.tickSize));
+            } else {
+                lines.push_back(std::string(eventLabel(notification.type)) + ": " + std::string(notification.text, notification.length));
+            }
+            if (notificationLog.is_open()) {
+                notificationLog << (notification.type == NotificationType::TRADE ? "Trade Notification: " : "") << lines.back() << "\n";
+            }
+        }
+
+        std::string subject;
+        if (lines.size() == 1) {
+            subject = trades == 1 ? "Trade Matched!" : eventLabel(burst[first].type);
+        } else if (trades == lines.size()) {
+            subject = std::to_string(trades) + " Trades Matched!";
+        } else {
+            subject = std::to_string(lines.size()) + " Order Updates (" + std::to_string(trades) + " trades)";
+        }
+        printColored("\n--- Mock Email Notification ---\n", 36);
+        std::cout << "To: " << recipient << "\n";
+        std::cout << "Subject: " << subject << "\n";
+        std::cout << "Body:\n";
+        for (const std::string& line : lines) {
+            std::cout << line << "\n";
+        }
+        std::cout << "-------------------------------\n\n";
+        digests.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::cout.flush();
+    notificationLog.flush();
+}
+
+void EmailNotifier::reportDrops() {
+    std::uint64_t totalDrops = dropped.load(std::memory_order_relaxed);
+    if (totalDrops == reportedDrops) {
+        return;
+    }
+    std::string notice = "Notifier dropped " + std::to_string(totalDrops - reportedDrops) + " notifications (outbox full)";
+    if (notificationLog.is_open()) {
+        notificationLog << notice << std::endl;
+    }
+    std::cerr << notice << std::endl;
+    reportedDrops = totalDrops;
+}
@@ -1,50 +1,83 @@
 #ifndef EMAIL_NOTIFIER_H
 #define EMAIL_NOTIFIER_H
 
+#include "Fill.h"
+#include "Instrument.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
 #include <string>
-#include <iostream>
+#include <thread>
+#include <vector>
 
+enum class NotificationType : std::uint8_t { TRADE, ORDER_PLACED, ORDER_MODIFIED, ORDER_CANCELLED };
+
+// Mock email notifications through an outbox. Senders copy a fixed-size record into a bounded ring
+// and return; a worker thread formats, prints and logs them, coalescing each burst into one digest
+// per recipient. A full outbox drops the notification (counted and reported) rather than stall
+// matching. Safe to share between matching threads.
 class EmailNotifier {
 public:
-    void sendTradeNotification(const std::string& tradeDetails) {
-        printColored("\n--- Mock Email Notification ---\n", 36);
-        std::cout << "To: User (mocked)\n";
-        std::cout << "Subject: Trade Matched!\n";
-        std::cout << "Body:\n" << tradeDetails << "\n";
-        std::cout << "-------------------------------\n\n";
-        logNotification("Trade Notification: " + tradeDetails);
-    }
-
-    void sendOrderPlaced(const std::string& orderDetails) {
-        printColored("[Order Placed] ", 32); // Green
-        std::cout << orderDetails << std::endl;
-        logNotification("Order Placed: " + orderDetails);
-    }
-
-    void sendOrderModified(const std::string& orderDetails) {
-        printColored("[Order Modified] ", 34); // Blue
-        std::cout << orderDetails << std::endl;
-        logNotification("Order Modified: " + orderDetails);
-    }
-
-    void sendOrderCancelled(const std::string& orderDetails) {
-        printColored("[Order Cancelled] ", 31); // Red
-        std::cout << orderDetails << std::endl;
-        logNotification("Order Cancelled: " + orderDetails);
-    }
+    explicit EmailNotifier(std::size_t outboxCapacity = 4096,
+                           std::chrono::microseconds coalesceWindow = std::chrono::microseconds(1000));
+    ~EmailNotifier(); // Sends everything accepted before returning
+
+    EmailNotifier(const EmailNotifier&) = delete;
+    EmailNotifier& operator=(const EmailNotifier&) = delete;
+
+    // A disabled notifier sends nothing (e.g. while the journal is replayed)
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Called from the matching loop: copies the fill, nothing is formatted here
+    void sendTradeNotification(const Fill& fill, const Instrument& instrument, const std::string& recipient = DEFAULT_RECIPIENT);
+    void sendOrderPlaced(const std::string& orderDetails, const std::string& recipient = DEFAULT_RECIPIENT);
+    void sendOrderModified(const std::string& orderDetails, const std::string& recipient = DEFAULT_RECIPIENT);
+    void sendOrderCancelled(const std::string& orderDetails, const std::string& recipient = DEFAULT_RECIPIENT);
+
+    // Blocks until every notification accepted so far has been sent
+    void flush();
+
+    std::uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+    // Digests sent; fewer than notifications whenever bursts were coalesced
+    std::uint64_t getDigestCount() const { return digests.load(std::memory_order_relaxed); }
+
+    static const std::string DEFAULT_RECIPIENT;
 
 private:
-    void printColored(const std::string& text, int colorCode) {
-        std::cout << "\033[" << colorCode << "m" << text << "\033[0m";
-    }
-    void logNotification(const std::string& msg) {
-        std::ofstream notifLog("notifications.log", std::ios::app);
-        if (notifLog.is_open()) {
-            notifLog << msg << std::endl;
-        }
-    }
-};
+    // Order details longer than this are cut and end in "..."
+    static const std::size_t NOTIFICATION_TEXT_SIZE = 160;
 
-#endif // EMAIL_NOTIFIER_H
+    struct Notification {
+        NotificationType type;
+        std::uint16_t length;
+        Fill fill;                                  // TRADE
+        double tickSize;                            // TRADE: prices are printed in the instrument's decimals
+        char symbol[MAX_ORDER_ID_LENGTH + 1];       // TRADE
+        char recipient[MAX_ORDER_ID_LENGTH + 1];
+        char text[NOTIFICATION_TEXT_SIZE];          // Order details, formatted by the sender
+    };
 
+    std::atomic<bool> enabled{true};
+    std::chrono::microseconds coalesceWindow;
+    MpscRing<Notification> outbox;
+    std::atomic<std::uint64_t> accepted{0}; // Notifications pushed into the outbox
+    std::atomic<std::uint64_t> sent{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> digests{0};
+    std::uint64_t reportedDrops = 0; // Worker thread only
+    std::ofstream notificationLog;   // Worker thread only
+    std::atomic<bool> stopping{false};
+    std::thread worker;
 
+    void sendOrderEvent(NotificationType type, const std::string& orderDetails, const std::string& recipient);
+    void submit(const Notification& notification);
+    void runWorker();
+    void sendDigests(const std::vector<Notification>& burst);
+    void reportDrops();
+};
+
+#endif // EMAIL_NOTIFIER_H
@@ -0,0 +1,8 @@
+#include "EngineClock.h"
+
+long long EngineClock::toWallNanos(long long engineNanos) {
+    // Offset between the two clocks, captured once on first use
+    static const long long wallOffset =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count() - now();
+    return engineNanos + wallOffset;
+}
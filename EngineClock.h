@@ -0,0 +1,29 @@
+#ifndef ENGINE_CLOCK_H
+#define ENGINE_CLOCK_H
+
+#include <chrono>
+#include <time.h>
+
+// Nanosecond event clock shared by the book, trades and logs. Each inbound event is stamped once
+// and that stamp is reused downstream. Readings are monotonic (CLOCK_MONOTONIC_RAW, served from the
+// vDSO without a syscall on Linux); conversion to wall-clock time only happens at output.
+class EngineClock {
+public:
+    static long long now() {
+#if defined(CLOCK_MONOTONIC_RAW)
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Wall-clock nanoseconds since the Unix epoch for an engine timestamp
+    static long long toWallNanos(long long engineNanos);
+    static long long toWallMillis(long long engineNanos) { return toWallNanos(engineNanos) / 1000000LL; }
+    // Engine timestamp of a wall-clock instant, e.g. one recorded by an earlier process
+    static long long fromWallNanos(long long wallNanos) { return wallNanos - toWallNanos(0); }
+};
+
+#endif // ENGINE_CLOCK_H
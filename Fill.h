@@ -0,0 +1,71 @@
+#ifndef FILL_H
+#define FILL_H
+
+#include "Order.h"
+#include "Instrument.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Longest order ID the engine accepts; IDs are stored inline in fills
+const std::size_t MAX_ORDER_ID_LENGTH = 31;
+
+// One execution as a fixed-size, trivially copyable record, so reporting a fill never allocates
+struct Fill {
+    std::uint64_t sequence; // Engine sequence number; also the trade ID
+    SymbolId symbolId;
+    OrderType aggressorSide;
+    Price price;
+    std::int32_t quantity;
+    long long timestamp;
+    char buyOrderId[MAX_ORDER_ID_LENGTH + 1];
+    char sellOrderId[MAX_ORDER_ID_LENGTH + 1];
+};
+
+inline void copyOrderId(char (&destination)[MAX_ORDER_ID_LENGTH + 1], const std::string& orderId) {
+    std::size_t length = orderId.size() < MAX_ORDER_ID_LENGTH ? orderId.size() : MAX_ORDER_ID_LENGTH;
+    std::memcpy(destination, orderId.data(), length);
+    destination[length] = '\0';
+}
+
+// Receives fills as the matcher produces them
+class FillSink {
+public:
+    virtual ~FillSink() = default;
+    virtual void onFill(const Fill& fill) = 0;
+};
+
+// Reusable fill buffer; clear() keeps the capacity, so a buffer reused across calls stops allocating
+class FillBuffer : public FillSink {
+public:
+    explicit FillBuffer(std::size_t initialCapacity = 64) { fills.reserve(initialCapacity); }
+
+    void onFill(const Fill& fill) override { fills.push_back(fill); }
+    void clear() { fills.clear(); }
+
+    const std::vector<Fill>& getFills() const { return fills; }
+    std::size_t size() const { return fills.size(); }
+    bool empty() const { return fills.empty(); }
+
+private:
+    std::vector<Fill> fills;
+};
+
+// Adapts any callable taking const Fill& (e.g. a lambda) into a FillSink
+template <typename Callback>
+class CallbackFillSink : public FillSink {
+public:
+    explicit CallbackFillSink(Callback cb) : callback(std::move(cb)) {}
+    void onFill(const Fill& fill) override { callback(fill); }
+
+private:
+    Callback callback;
+};
+
+template <typename Callback>
+CallbackFillSink<Callback> makeFillSink(Callback callback) {
+    return CallbackFillSink<Callback>(std::move(callback));
+}
+
+#endif // FILL_H
@@ -0,0 +1,29 @@
+#include "Instrument.h"
+#include <cmath>
+#include <cstdio>
+
+Price Instrument::toTicks(double price) const {
+    return static_cast<Price>(std::llround(price / tickSize));
+}
+
+double Instrument::toDecimal(Price ticks) const {
+    return static_cast<double>(ticks) * tickSize;
+}
+
+std::string Instrument::formatPrice(Price ticks) const {
+    // Print as many decimals as the tick size needs (0.01 -> 2, 0.0005 -> 4)
+    int decimals = 0;
+    double scaled = tickSize;
+    while (decimals < 8 && std::fabs(scaled - std::round(scaled)) > 1e-9) {
+        scaled *= 10;
+        decimals++;
+    }
+    char buffer[64];
+    std::snprintf(buffer, sizeof(buffer), "%.*f", decimals, toDecimal(ticks));
+    return buffer;
+}
+
+bool Instrument::isOnTick(double price) const {
+    double ticks = price / tickSize;
+    return std::fabs(ticks - std::round(ticks)) < 1e-6;
+}
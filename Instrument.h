@@ -0,0 +1,26 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <cstdint>
+#include <string>
+
+// Prices inside the engine are integer counts of the instrument's tick size
+using Price = std::int64_t;
+// Dense per-engine symbol number handed out by SymbolDirectory
+using SymbolId = std::uint32_t;
+
+// Per-symbol trading parameters. Decimal prices only exist at the edges (CLI, TradeLogger, bindings).
+struct Instrument {
+    SymbolId id = 0;
+    std::string symbol;
+    double tickSize = 0.01;
+    int lotSize = 1;
+
+    Price toTicks(double price) const;
+    double toDecimal(Price ticks) const;
+    std::string formatPrice(Price ticks) const;
+    bool isOnTick(double price) const;
+    bool isValidQuantity(int quantity) const { return quantity > 0 && quantity % lotSize == 0; }
+};
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,209 @@
+#include "IoUring.h"
+
+#ifdef ENGINE_HAS_IO_URING
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+void* mapRing(int fd, std::size_t bytes, off_t offset) {
+    void* address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return address == MAP_FAILED ? nullptr : address;
+}
+
+} // namespace
+
+IoUring::~IoUring() {
+    release();
+}
+
+bool IoUring::init(unsigned entries, unsigned completionEntries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    if (completionEntries > 0) {
+        params.flags |= IORING_SETUP_CQSIZE;
+        params.cq_entries = completionEntries;
+    }
+    // Completions are only reaped by the thread that submits, so the kernel need not interrupt it
+    params.flags |= IORING_SETUP_COOP_TASKRUN;
+    ringFd = ioUringSetup(entries, &params);
+    if (ringFd < 0 && errno == EINVAL) {
+        params.flags &= ~IORING_SETUP_COOP_TASKRUN; // Kernels before 5.19
+        ringFd = ioUringSetup(entries, &params);
+    }
+    if (ringFd < 0) {
+        error = std::string("io_uring_setup failed: ") + std::strerror(errno);
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)) {
+        error = "io_uring is too old (needs single mmap and no-drop completions)";
+        release();
+        return false;
+    }
+
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqRingBytes = cqRingBytes = sqRingBytes > cqRingBytes ? sqRingBytes : cqRingBytes;
+    sqRing = cqRing = mapRing(ringFd, sqRingBytes, IORING_OFF_SQ_RING);
+    sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(mapRing(ringFd, sqesBytes, IORING_OFF_SQES));
+    if (sqRing == nullptr || sqes == nullptr) {
+        error = std::string("Unable to map the io_uring rings: ") + std::strerror(errno);
+        release();
+        return false;
+    }
+
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries = params.sq_entries;
+    // Submission slot i always holds entry i, so the indirection array is filled once
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries; ++i) {
+        array[i] = i;
+    }
+    sqLocalTail = *sqTail;
+    sqSubmitted = sqLocalTail;
+
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+void IoUring::release() {
+    if (sqes != nullptr) {
+        ::munmap(sqes, sqesBytes);
+        sqes = nullptr;
+    }
+    if (sqRing != nullptr) {
+        ::munmap(sqRing, sqRingBytes);
+        sqRing = cqRing = nullptr;
+    }
+    if (ringFd >= 0) {
+        ::close(ringFd);
+        ringFd = -1;
+    }
+}
+
+io_uring_sqe* IoUring::getSqe() {
+    if (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries && !submit()) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes[sqLocalTail & sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqLocalTail++;
+    return sqe;
+}
+
+bool IoUring::submit(unsigned waitFor) {
+    __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqLocalTail - sqSubmitted;
+    if (toSubmit == 0 && waitFor == 0) {
+        return true;
+    }
+    while (true) {
+        enterCount++;
+        int submitted = ioUringEnter(ringFd, toSubmit, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0);
+        if (submitted >= 0) {
+            sqSubmitted += static_cast<unsigned>(submitted);
+            return true;
+        }
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            error = std::string("io_uring_enter failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (errno != EINTR) {
+            // Too many completions are waiting to be reaped; let the caller reap them first
+            return true;
+        }
+    }
+}
+
+bool IoUring::registerBuffers(const iovec* buffers, unsigned count) {
+    if (ioUringRegister(ringFd, IORING_REGISTER_BUFFERS, buffers, count) != 0) {
+        error = std::string("Unable to register io_uring buffers: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+IoUringBufferRing::~IoUringBufferRing() {
+    if (entries != nullptr) {
+        if (ring != nullptr && ring->isOpen()) {
+            io_uring_buf_reg registration;
+            std::memset(&registration, 0, sizeof(registration));
+            registration.bgid = group;
+            ioUringRegister(ring->getFd(), IORING_UNREGISTER_PBUF_RING, &registration, 1);
+        }
+        ::munmap(entries, entriesBytes);
+    }
+    if (buffers != nullptr) {
+        ::munmap(buffers, buffersBytes);
+    }
+}
+
+bool IoUringBufferRing::init(IoUring& uring, std::uint16_t bufferGroup, unsigned bufferCount, std::size_t bytes) {
+    ring = &uring;
+    group = bufferGroup;
+    count = bufferCount;
+    bufferBytes = bytes;
+    entriesBytes = count * sizeof(io_uring_buf);
+    void* ringMemory = ::mmap(nullptr, entriesBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    buffersBytes = count * bufferBytes;
+    void* bufferMemory = ::mmap(nullptr, buffersBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    entries = ringMemory == MAP_FAILED ? nullptr : static_cast<io_uring_buf_ring*>(ringMemory);
+    buffers = bufferMemory == MAP_FAILED ? nullptr : static_cast<char*>(bufferMemory);
+    if (entries == nullptr || buffers == nullptr) {
+        error = "Unable to allocate io_uring receive buffers";
+        return false;
+    }
+
+    io_uring_buf_reg registration;
+    std::memset(&registration, 0, sizeof(registration));
+    registration.ring_addr = reinterpret_cast<std::uint64_t>(entries);
+    registration.ring_entries = count;
+    registration.bgid = group;
+    if (ioUringRegister(ring->getFd(), IORING_REGISTER_PBUF_RING, &registration, 1) != 0) {
+        error = std::string("Unable to register an io_uring buffer ring: ") + std::strerror(errno);
+        ::munmap(entries, entriesBytes);
+        entries = nullptr;
+        return false;
+    }
+    for (unsigned id = 0; id < count; ++id) {
+        recycle(id);
+    }
+    return true;
+}
+
+void IoUringBufferRing::recycle(unsigned id) {
+    // Entry i is at offset 16 * i from the ring's base (compiled as C++, the header's bufs member is
+    // padded past the empty struct __DECLARE_FLEX_ARRAY puts in front of it, so it is not used)
+    io_uring_buf& entry = reinterpret_cast<io_uring_buf*>(entries)[tail & (count - 1)];
+    entry.addr = reinterpret_cast<std::uint64_t>(buffers + id * bufferBytes);
+    entry.len = static_cast<std::uint32_t>(bufferBytes);
+    entry.bid = static_cast<std::uint16_t>(id);
+    tail++;
+    // The ring's tail shares storage with the first entry's resv field
+    __atomic_store_n(&entries->tail, tail, __ATOMIC_RELEASE);
+}
+
+#endif // ENGINE_HAS_IO_URING
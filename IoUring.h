@@ -0,0 +1,124 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ENGINE_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+// Minimal io_uring ring over the raw system calls (no liburing). One thread owns it: it fills
+// submission entries, submits them and reaps the completions. Callers keep every buffer an entry
+// points at alive until its completion has been reaped.
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // Sets up a ring with at least entries submission slots and completionEntries completion slots
+    // (0 = twice entries); false (see getError) where the kernel lacks io_uring or it is disabled
+    bool init(unsigned entries, unsigned completionEntries = 0);
+    bool isOpen() const { return ringFd >= 0; }
+
+    // Next free submission entry, zeroed; submits what is queued first if the ring is full
+    io_uring_sqe* getSqe();
+    // Submits the queued entries and waits until at least waitFor completions are ready, in one
+    // system call. Returns false (see getError) if the kernel refused.
+    bool submit(unsigned waitFor = 0);
+
+    // Calls handler(const io_uring_cqe&) for every completion ready; returns how many there were
+    template <typename Handler>
+    unsigned reap(Handler&& handler) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0;
+        for (; head != tail; ++head, ++count) {
+            handler(cqes[head & cqMask]);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+    // Registers fixed buffers for IORING_OP_READ_FIXED / WRITE_FIXED (buf_index is their position)
+    bool registerBuffers(const iovec* buffers, unsigned count);
+
+    // io_uring_enter calls made so far
+    std::uint64_t getEnterCount() const { return enterCount; }
+    int getFd() const { return ringFd; }
+    const std::string& getError() const { return error; }
+
+private:
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    std::size_t sqRingBytes = 0;
+    std::size_t cqRingBytes = 0;
+    io_uring_sqe* sqes = nullptr;
+    std::size_t sqesBytes = 0;
+    unsigned* sqHead = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned sqMask = 0;
+    unsigned sqEntries = 0;
+    unsigned sqLocalTail = 0; // Entries handed out but not yet published to the kernel
+    unsigned sqSubmitted = 0; // Entries published but not yet submitted with io_uring_enter
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    std::uint64_t enterCount = 0;
+    std::string error;
+
+    void release();
+};
+
+// Receive buffers registered with the kernel as a provided-buffer ring: a multishot receive with
+// IOSQE_BUFFER_SELECT and this group picks one per completion, whose ID comes back in the cqe flags.
+// Hand each buffer back with recycle() once its data is consumed.
+class IoUringBufferRing {
+public:
+    IoUringBufferRing() = default;
+    ~IoUringBufferRing();
+
+    IoUringBufferRing(const IoUringBufferRing&) = delete;
+    IoUringBufferRing& operator=(const IoUringBufferRing&) = delete;
+
+    // count must be a power of two; bufferBytes a multiple of 8 keeps every buffer 8-aligned
+    bool init(IoUring& ring, std::uint16_t group, unsigned count, std::size_t bufferBytes);
+
+    std::uint16_t getGroup() const { return group; }
+    std::size_t getBufferBytes() const { return bufferBytes; }
+    // Buffer the kernel filled for a completion (flags carry IORING_CQE_F_BUFFER)
+    static unsigned bufferId(std::uint32_t cqeFlags) { return cqeFlags >> IORING_CQE_BUFFER_SHIFT; }
+    const char* data(unsigned id) const { return buffers + id * bufferBytes; }
+    void recycle(unsigned id);
+
+    const std::string& getError() const { return error; }
+
+private:
+    IoUring* ring = nullptr;
+    io_uring_buf_ring* entries = nullptr;
+    std::size_t entriesBytes = 0;
+    char* buffers = nullptr;
+    std::size_t buffersBytes = 0;
+    std::size_t bufferBytes = 0;
+    unsigned count = 0;
+    std::uint16_t group = 0;
+    std::uint16_t tail = 0;
+    std::string error;
+};
+
+#else
+
+// Placeholders, so classes that hold a ring compile where io_uring does not exist
+class IoUring {};
+class IoUringBufferRing {};
+
+#endif // __linux__ && <linux/io_uring.h>
+
+#endif // IO_URING_H
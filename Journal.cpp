@@ -0,0 +1,452 @@
+#include "Journal.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Records a reader pulls from the file per read call
+const std::size_t READ_BLOCK_RECORDS = 4096;
+
+// Slicing-by-8 tables: entries[k] advances the CRC over a byte followed by k zero bytes,
+// so eight bytes are folded in per step instead of one
+struct Crc32Table {
+    std::uint32_t entries[8][256];
+
+    Crc32Table() {
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+            }
+            entries[0][i] = value;
+        }
+        for (int k = 1; k < 8; ++k) {
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xFFu];
+            }
+        }
+    }
+};
+
+std::uint32_t loadLittleEndian32(const unsigned char* bytes) {
+    return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 |
+           static_cast<std::uint32_t>(bytes[2]) << 16 | static_cast<std::uint32_t>(bytes[3]) << 24;
+}
+
+// Unused slot of a preallocated segment
+bool isEmptyRecord(const JournalRecord& record) {
+    return record.crc == 0 && record.sequence == 0;
+}
+
+} // namespace
+
+std::uint32_t journalCrc32(const void* data, std::size_t length, std::uint32_t previous) {
+    static const Crc32Table table;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    const auto& t = table.entries;
+    std::uint32_t crc = previous ^ 0xFFFFFFFFu;
+    for (; length >= 8; bytes += 8, length -= 8) {
+        std::uint32_t low = crc ^ loadLittleEndian32(bytes);
+        std::uint32_t high = loadLittleEndian32(bytes + 4);
+        crc = t[7][low & 0xFFu] ^ t[6][(low >> 8) & 0xFFu] ^ t[5][(low >> 16) & 0xFFu] ^ t[4][low >> 24] ^
+              t[3][high & 0xFFu] ^ t[2][(high >> 8) & 0xFFu] ^ t[1][(high >> 16) & 0xFFu] ^ t[0][high >> 24];
+    }
+    for (; length > 0; ++bytes, --length) {
+        crc = t[0][(crc ^ *bytes) & 0xFFu] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+std::uint32_t journalRecordCrc(const JournalRecord& record) {
+    const char* bytes = reinterpret_cast<const char*>(&record);
+    return journalCrc32(bytes + sizeof(record.crc), sizeof(record) - sizeof(record.crc));
+}
+
+std::string journalSegmentPath(const std::string& basePath, std::uint64_t number) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(number));
+    return basePath + suffix;
+}
+
+std::vector<std::pair<std::uint64_t, std::string>> listJournalSegments(const std::string& basePath) {
+    std::vector<std::pair<std::uint64_t, std::string>> segments;
+    std::filesystem::path base(basePath);
+    std::filesystem::path directory = base.has_parent_path() ? base.parent_path() : std::filesystem::path(".");
+    std::string prefix = base.filename().string() + ".";
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        std::string digits = name.substr(prefix.size());
+        if (digits.find_first_not_of("0123456789") != std::string::npos) {
+            continue;
+        }
+        segments.emplace_back(std::stoull(digits), it->path().string());
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+std::size_t truncateJournal(const std::string& basePath, std::uint64_t coveredSequence) {
+    auto segments = listJournalSegments(basePath);
+    std::size_t deleted = 0;
+    // Sequences only grow from one segment to the next, so everything in a segment comes before the
+    // first sequence of the one after it
+    for (std::size_t i = 0; i + 1 < segments.size(); ++i) {
+        JournalHeader next{};
+        std::FILE* file = std::fopen(segments[i + 1].second.c_str(), "rb");
+        bool readable = file != nullptr && std::fread(&next, sizeof(next), 1, file) == 1 &&
+                        std::memcmp(next.magic, JOURNAL_MAGIC, sizeof(next.magic)) == 0;
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+        if (!readable || next.firstSequence == 0 || next.firstSequence > coveredSequence + 1) {
+            break;
+        }
+        std::error_code ec;
+        if (!std::filesystem::remove(segments[i].second, ec)) {
+            break;
+        }
+        deleted++;
+    }
+    return deleted;
+}
+
+Journal::Journal(const std::string& journalPath, const JournalOptions& journalOptions)
+    : path(journalPath), options(journalOptions), buffer(journalOptions.bufferRecords > 0 ? journalOptions.bufferRecords : 1),
+      lastFlush(std::chrono::steady_clock::now()) {
+    if (open() && options.io == JournalIo::IO_URING) {
+        openRing();
+    }
+}
+
+Journal::~Journal() {
+    if (file != nullptr) {
+        flush();
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+}
+
+bool Journal::open() {
+    std::error_code ec;
+    std::uintmax_t size = std::filesystem::file_size(path, ec);
+    bool existing = !ec && size >= sizeof(JournalHeader);
+
+    if (existing) {
+        std::uint64_t validBytes = 0;
+        {
+            JournalReader reader(path);
+            if (!reader.isOpen()) {
+                error = "Error: " + path + " is not a journal: " + reader.getError();
+                return false;
+            }
+            JournalRecord record;
+            while (reader.next(record)) {
+            }
+            lastSequence = reader.getLastSequence();
+            validBytes = reader.getValidBytes();
+        }
+        // Anything after the last good record is a write that never completed
+        if (validBytes != size) {
+            std::filesystem::resize_file(path, validBytes, ec);
+            if (ec) {
+                error = "Error: Unable to truncate damaged tail of " + path + ": " + ec.message();
+                return false;
+            }
+        }
+        file = std::fopen(path.c_str(), "ab");
+    } else {
+        file = std::fopen(path.c_str(), "wb");
+    }
+    if (file == nullptr) {
+        error = "Error: Unable to open " + path + " for writing.";
+        return false;
+    }
+    // Records are already batched in our own buffer; stdio buffering would only add a copy
+    std::setvbuf(file, nullptr, _IONBF, 0);
+
+    if (!existing) {
+        JournalHeader header{};
+        std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+        header.version = JOURNAL_VERSION;
+        header.recordSize = sizeof(JournalRecord);
+        header.createdWallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        header.firstSequence = 1;
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            error = "Error: Unable to write journal header to " + path + ".";
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::uint64_t Journal::append(JournalRecord& record) {
+    if (file == nullptr) {
+        return 0;
+    }
+    record.sequence = ++lastSequence;
+    record.crc = journalRecordCrc(record);
+    buffer[buffered++] = record;
+
+    bool due = buffered == buffer.size();
+    switch (options.flushPolicy) {
+        case JournalFlushPolicy::PER_EVENT:
+            due = true;
+            break;
+        case JournalFlushPolicy::PER_BATCH:
+            due = due || buffered >= options.batchRecords;
+            break;
+        case JournalFlushPolicy::INTERVAL:
+            due = due || std::chrono::steady_clock::now() - lastFlush >= options.flushInterval;
+            break;
+    }
+    if (due && !flush()) {
+        return 0;
+    }
+    return record.sequence;
+}
+
+bool Journal::endBatch() {
+    if (file == nullptr) {
+        return false;
+    }
+    if (options.flushPolicy == JournalFlushPolicy::PER_BATCH ||
+        (options.flushPolicy == JournalFlushPolicy::INTERVAL && std::chrono::steady_clock::now() - lastFlush >= options.flushInterval)) {
+        return flush();
+    }
+    return true;
+}
+
+bool Journal::flushIfDue() {
+    if (file == nullptr || options.flushPolicy != JournalFlushPolicy::INTERVAL || buffered == 0 ||
+        std::chrono::steady_clock::now() - lastFlush < options.flushInterval) {
+        return file != nullptr;
+    }
+    return flush();
+}
+
+bool Journal::waitForCommit(std::uint64_t sequence) {
+    return sequence <= lastSequence - buffered || flush();
+}
+
+bool Journal::flush() {
+    if (file == nullptr) {
+        return false;
+    }
+    lastFlush = std::chrono::steady_clock::now();
+    if (buffered == 0) {
+        return true;
+    }
+    if (!writeBuffer(buffered * sizeof(JournalRecord))) {
+        // The file may now end in a partial record; stop writing and let the next open cut it off
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    buffered = 0;
+    flushCount++;
+    return true;
+}
+
+bool Journal::openRing() {
+#ifdef ENGINE_HAS_IO_URING
+    ring = std::make_unique<IoUring>();
+    iovec registered{buffer.data(), buffer.size() * sizeof(JournalRecord)};
+    // The buffer never moves, so it is registered once and every flush is a fixed-buffer write
+    if (ring->init(4) && ring->registerBuffers(&registered, 1)) {
+        io = JournalIo::IO_URING;
+        return true;
+    }
+    ring.reset();
+#endif
+    return false;
+}
+
+bool Journal::writeBuffer(std::size_t bytes) {
+#ifdef ENGINE_HAS_IO_URING
+    if (ring) {
+        std::uint64_t entersBefore = ring->getEnterCount();
+        io_uring_sqe* write = ring->getSqe();
+        write->opcode = IORING_OP_WRITE_FIXED;
+        write->fd = fileno(file);
+        write->addr = reinterpret_cast<std::uint64_t>(buffer.data());
+        write->len = static_cast<std::uint32_t>(bytes);
+        write->off = static_cast<std::uint64_t>(-1); // The file is opened for append
+        write->buf_index = 0;
+        write->user_data = 1;
+        unsigned expected = 1;
+        if (options.syncOnFlush) {
+            // Linked: the sync only starts once the write has completed in full
+            write->flags = IOSQE_IO_LINK;
+            io_uring_sqe* sync = ring->getSqe();
+            sync->opcode = IORING_OP_FSYNC;
+            sync->fd = fileno(file);
+            sync->fsync_flags = IORING_FSYNC_DATASYNC;
+            sync->user_data = 2;
+            expected = 2;
+        }
+        std::int32_t written = -ECANCELED, synced = 0;
+        unsigned completed = 0;
+        bool submitted = true;
+        while (completed < expected && (submitted = ring->submit(expected - completed))) {
+            completed += ring->reap([&](const io_uring_cqe& cqe) {
+                (cqe.user_data == 1 ? written : synced) = cqe.res;
+            });
+        }
+        syscalls += ring->getEnterCount() - entersBefore;
+        if (!submitted || written != static_cast<std::int32_t>(bytes) || synced < 0) {
+            int failure = !submitted ? 0 : written < 0 ? -written : synced < 0 ? -synced : 0;
+            error = "Error: Write to journal " + path + " failed" + (failure != 0 ? std::string(": ") + std::strerror(failure) : "") + ".";
+            return false;
+        }
+        return true;
+    }
+#endif
+    syscalls++;
+    if (std::fwrite(buffer.data(), 1, bytes, file) != bytes) {
+        error = "Error: Write to journal " + path + " failed.";
+        return false;
+    }
+    if (options.syncOnFlush) {
+        syscalls++;
+#ifdef _WIN32
+        int result = _commit(_fileno(file));
+#elif defined(__APPLE__)
+        int result = ::fsync(fileno(file));
+#else
+        int result = ::fdatasync(fileno(file));
+#endif
+        if (result != 0) {
+            error = "Error: Unable to sync journal " + path + ": " + std::strerror(errno);
+            return false;
+        }
+    }
+    return true;
+}
+
+JournalReader::JournalReader(const std::string& path) {
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(path, ec)) {
+        files.push_back(path);
+    } else {
+        for (const auto& segment : listJournalSegments(path)) {
+            files.push_back(segment.second);
+        }
+    }
+    if (files.empty()) {
+        error = "Unable to open " + path + " for reading.";
+        return;
+    }
+    openFile(0);
+}
+
+JournalReader::~JournalReader() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+bool JournalReader::openFile(std::size_t index) {
+    for (; index < files.size(); ++index) {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+        file = std::fopen(files[index].c_str(), "rb");
+        if (file == nullptr) {
+            error = "Unable to open " + files[index] + " for reading.";
+            return false;
+        }
+        if (std::fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0) {
+            error = "Missing journal header in " + files[index] + ".";
+            break;
+        }
+        if (header.version != JOURNAL_VERSION || header.recordSize != sizeof(JournalRecord)) {
+            error = "Unsupported journal version " + std::to_string(header.version) + " in " + files[index] + ".";
+            break;
+        }
+        fillBlock();
+        bool hasRecords = blockCount > 0 && !isEmptyRecord(block[0]);
+        if (!hasRecords && index + 1 < files.size()) {
+            continue; // A spare segment mapped ahead by a run that stopped before using it
+        }
+        if (validBytes == 0) {
+            // First file read; earlier segments may have been truncated away
+            lastSequence = header.firstSequence > 0 ? header.firstSequence - 1 : 0;
+        }
+        if (hasRecords && header.firstSequence != lastSequence + 1) {
+            error = "Sequence gap: expected " + std::to_string(lastSequence + 1) + ", " + files[index] + " starts at " + std::to_string(header.firstSequence) + ".";
+            break;
+        }
+        fileIndex = index;
+        validBytes = sizeof(header);
+        return true;
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    return false;
+}
+
+void JournalReader::fillBlock() {
+    if (block.empty()) {
+        block.resize(READ_BLOCK_RECORDS);
+    }
+    std::size_t bytes = std::fread(block.data(), 1, block.size() * sizeof(JournalRecord), file);
+    blockCount = bytes / sizeof(JournalRecord);
+    blockNext = 0;
+    tornBytes = bytes % sizeof(JournalRecord);
+}
+
+bool JournalReader::next(JournalRecord& record) {
+    while (file != nullptr && !damaged) {
+        if (blockNext == blockCount && tornBytes == 0) {
+            fillBlock();
+        }
+        bool atEnd = blockNext == blockCount && tornBytes == 0;
+        if (atEnd || (blockNext < blockCount && isEmptyRecord(block[blockNext]))) {
+            // End of this file; carry on with the next segment
+            if (fileIndex + 1 >= files.size()) {
+                return false;
+            }
+            if (!openFile(fileIndex + 1)) {
+                damaged = true;
+            }
+            continue;
+        }
+        if (blockNext == blockCount) {
+            error = "Torn record after sequence " + std::to_string(lastSequence) + ".";
+        } else {
+            record = block[blockNext++];
+            if (record.crc != journalRecordCrc(record)) {
+                error = "CRC mismatch after sequence " + std::to_string(lastSequence) + ".";
+            } else if (record.sequence != lastSequence + 1) {
+                error = "Sequence gap: expected " + std::to_string(lastSequence + 1) + ", found " + std::to_string(record.sequence) + ".";
+            } else {
+                lastSequence = record.sequence;
+                validBytes += sizeof(record);
+                return true;
+            }
+        }
+        std::string recordError = error;
+        if (fileIndex + 1 >= files.size() || !openFile(fileIndex + 1)) {
+            error = recordError;
+            damaged = true;
+        }
+    }
+    return false;
+}
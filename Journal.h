@@ -0,0 +1,233 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "Instrument.h"
+#include "Fill.h"
+#include "IoUring.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+enum class JournalRecordType : std::uint8_t {
+    SYMBOL = 1, // Binds symbolId to a name, tick size and lot size for the records after it
+    ORDER = 2,
+    TRADE = 3,
+    CANCEL = 4,
+    MODIFY = 5  // orderId's new price and quantity
+};
+
+// One journal entry. Fixed layout, so a record is written and read back with a single copy.
+struct JournalRecord {
+    std::uint32_t crc;          // CRC-32 of every byte after this field
+    JournalRecordType type;
+    std::uint8_t side;          // OrderType of ORDER / CANCEL / MODIFY
+    std::uint16_t reserved;
+    std::uint64_t sequence;     // Stamped by the journal: 1, 2, 3... without gaps across reopens
+    long long engineNanos;      // EngineClock stamp of the event
+    long long wallNanos;        // The same instant as wall-clock time, for readers in other processes
+    Price price;
+    double tickSize;            // SYMBOL only
+    std::uint64_t tradeId;      // TRADE only
+    SymbolId symbolId;
+    std::int32_t quantity;      // Lot size for SYMBOL
+    char orderId[MAX_ORDER_ID_LENGTH + 1];     // Order ID, buy order ID for TRADE, name for SYMBOL
+    char sellOrderId[MAX_ORDER_ID_LENGTH + 1]; // TRADE only
+};
+
+static_assert(sizeof(JournalRecord) == 128, "Journal record layout is part of the file format");
+static_assert(std::is_trivially_copyable<JournalRecord>::value, "Journal records are written as raw bytes");
+
+// Start of every journal file
+struct JournalHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    long long createdWallNanos;
+    std::uint64_t firstSequence; // Sequence of the file's first record
+};
+
+static_assert(sizeof(JournalHeader) == 32, "Journal header layout is part of the file format");
+
+const char JOURNAL_MAGIC[8] = {'V', 'C', 'J', 'R', 'N', 'L', '\0', '\0'};
+const std::uint32_t JOURNAL_VERSION = 1;
+
+enum class JournalBackend {
+    BUFFERED, // Journal: one file written through a buffer
+    MAPPED    // MappedJournal: preallocated, memory-mapped segment files with a group committer
+};
+
+// When buffered records reach the file (BUFFERED)
+enum class JournalFlushPolicy {
+    PER_EVENT, // Every append is written before it returns
+    PER_BATCH, // At endBatch(), or once batchRecords are buffered
+    INTERVAL   // Once flushInterval has passed since the last write: on append, endBatch() or flushIfDue()
+};
+
+// What a MAPPED journal does before it counts records as committed
+enum class JournalSyncMode {
+    NONE,     // Nothing: records in the mapping survive a process crash but not a power loss
+    MSYNC,    // msync(MS_SYNC) of the pages holding the new records
+    FDATASYNC // fdatasync of the segment file
+};
+
+// How a BUFFERED journal writes its buffer
+enum class JournalIo {
+    WRITE,   // write(), then fdatasync() if syncOnFlush
+    IO_URING // The buffer is registered with a ring; a write and a linked fdatasync go in one io_uring_enter
+};
+
+struct JournalOptions {
+    JournalBackend backend = JournalBackend::BUFFERED;
+
+    // BUFFERED
+    JournalFlushPolicy flushPolicy = JournalFlushPolicy::PER_BATCH;
+    std::size_t batchRecords = 256;
+    std::chrono::microseconds flushInterval{1000};
+    std::size_t bufferRecords = 1024; // A full buffer is written whatever the policy
+    bool syncOnFlush = false;         // fdatasync after every flush, so a commit survives a power loss
+    JournalIo io = JournalIo::WRITE;  // IO_URING falls back to WRITE where it is unavailable
+
+    // MAPPED
+    std::size_t segmentBytes = 64 * 1024 * 1024; // A new segment is started once this is full
+    JournalSyncMode syncMode = JournalSyncMode::FDATASYNC;
+    std::chrono::microseconds commitInterval{200}; // Longest the committer idles before looking for new records
+};
+
+// Pass the CRC of the preceding bytes as previous to checksum data in pieces
+std::uint32_t journalCrc32(const void* data, std::size_t length, std::uint32_t previous = 0);
+// CRC of a record covers everything after its crc field
+std::uint32_t journalRecordCrc(const JournalRecord& record);
+
+// Segment files of a MAPPED journal are named <basePath>.000001, <basePath>.000002, ...
+std::string journalSegmentPath(const std::string& basePath, std::uint64_t number);
+// Existing segments of basePath as (number, path), in order
+std::vector<std::pair<std::uint64_t, std::string>> listJournalSegments(const std::string& basePath);
+// Deletes the oldest segments whose records all have sequences <= coveredSequence (e.g. covered by a
+// snapshot); the newest segment is always kept. Returns the number of segments deleted.
+std::size_t truncateJournal(const std::string& basePath, std::uint64_t coveredSequence);
+
+// Where TradeLogger (and anything else journaling) sends records
+class JournalWriter {
+public:
+    virtual ~JournalWriter() = default;
+
+    virtual bool isOpen() const = 0;
+    // Stamps the sequence and CRC into the record and hands it to the journal; 0 if it could not
+    virtual std::uint64_t append(JournalRecord& record) = 0;
+    // Marks the end of a group of related records (e.g. an order and its fills)
+    virtual bool endBatch() = 0;
+    // Returns once every record up to sequence is as durable as the journal is configured to make it
+    virtual bool waitForCommit(std::uint64_t sequence) = 0;
+    // Writes records a time-based policy has held long enough; a no-op for backends that commit on their own
+    virtual bool flushIfDue() { return true; }
+
+    virtual std::uint64_t getLastSequence() const = 0;
+    // System calls made on the committing path so far, where the backend counts them
+    virtual std::uint64_t getSyscallCount() const { return 0; }
+    virtual const std::string& getPath() const = 0;
+    virtual const std::string& getError() const = 0;
+};
+
+// Append-only binary journal. The file stays open, records are copied into a preallocated buffer
+// and written in one call per flush. Not thread-safe; callers serialise access.
+class Journal : public JournalWriter {
+public:
+    // Opens an existing journal and continues its sequence (a damaged tail is cut off), or creates a new one
+    explicit Journal(const std::string& path, const JournalOptions& options = JournalOptions());
+    ~Journal(); // Writes whatever is still buffered
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    bool isOpen() const override { return file != nullptr; }
+
+    std::uint64_t append(JournalRecord& record) override;
+    bool endBatch() override;
+    // Hands buffered records to the operating system, and syncs them if syncOnFlush
+    bool waitForCommit(std::uint64_t sequence) override;
+    // INTERVAL: flushes once flushInterval has passed since the last write, so records buffered before
+    // the caller went quiet still reach the file in time. Call it at least every flushInterval.
+    bool flushIfDue() override;
+    bool flush();
+
+    std::uint64_t getLastSequence() const override { return lastSequence; }
+    std::uint64_t getFlushCount() const { return flushCount; }
+    // System calls made writing and syncing records
+    std::uint64_t getSyscallCount() const override { return syscalls; }
+    // What flushes go through; WRITE after a fallback from IO_URING
+    JournalIo getIo() const { return io; }
+    const std::string& getPath() const override { return path; }
+    const std::string& getError() const override { return error; }
+
+private:
+    std::string path;
+    JournalOptions options;
+    std::FILE* file = nullptr;
+    std::vector<JournalRecord> buffer;
+    std::size_t buffered = 0;
+    std::uint64_t lastSequence = 0;
+    std::uint64_t flushCount = 0;
+    std::chrono::steady_clock::time_point lastFlush;
+    std::string error;
+    JournalIo io = JournalIo::WRITE;
+    std::unique_ptr<IoUring> ring;
+    std::uint64_t syscalls = 0;
+
+    bool open();
+    bool openRing();
+    bool writeBuffer(std::size_t bytes);
+};
+
+// Reads a journal front to back, stopping at the end or at the first record that does not verify.
+// Without a file at path it reads the segments of a MAPPED journal one after another. A segment
+// ends at its first unused (all zero) slot, or at a bad record when the next segment carries on
+// from the last good one (a run that crashed mid-write, followed by the run that recovered).
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path);
+    ~JournalReader();
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    // False if there is no journal at path
+    bool isOpen() const { return file != nullptr; }
+    // Header of the file being read
+    const JournalHeader& getHeader() const { return header; }
+
+    bool next(JournalRecord& record);
+
+    // Set once next() stopped on a torn record, a CRC mismatch or a sequence gap rather than at the end
+    bool isDamaged() const { return damaged; }
+    // Bytes of header and records verified so far in the file being read
+    std::uint64_t getValidBytes() const { return validBytes; }
+    std::uint64_t getLastSequence() const { return lastSequence; }
+    std::size_t getFileCount() const { return files.size(); }
+    // Position of the file being read among getFileCount()
+    std::size_t getFileIndex() const { return fileIndex; }
+    const std::string& getError() const { return error; }
+
+private:
+    std::vector<std::string> files;
+    std::size_t fileIndex = 0;
+    std::FILE* file = nullptr;
+    JournalHeader header{};
+    std::vector<JournalRecord> block; // Records read from the file but not yet returned
+    std::size_t blockCount = 0;
+    std::size_t blockNext = 0;
+    std::size_t tornBytes = 0; // Bytes after the last whole record at the end of the file
+    bool damaged = false;
+    std::uint64_t validBytes = 0;
+    std::uint64_t lastSequence = 0;
+    std::string error;
+
+    bool openFile(std::size_t index);
+    void fillBlock();
+};
+
+#endif // JOURNAL_H
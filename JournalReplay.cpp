@@ -0,0 +1,197 @@
+#include "JournalReplay.h"
+#include "EngineClock.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Sequences replayed fills against the TRADE records that follow each command in the journal
+class ReplayFillChecker : public FillSink {
+public:
+    void onFill(const Fill& fill) override { fills.push_back(fill); }
+
+    // Called before each command; fills the journal never recorded (e.g. a crash in between) go unchecked
+    void reset() {
+        fills.clear();
+        next = 0;
+    }
+
+    bool matches(const JournalRecord& trade, SymbolId symbolId) {
+        if (next >= fills.size()) {
+            return false;
+        }
+        const Fill& fill = fills[next++];
+        return fill.sequence == trade.tradeId && fill.symbolId == symbolId && fill.price == trade.price &&
+               fill.quantity == trade.quantity && std::strcmp(fill.buyOrderId, trade.orderId) == 0 &&
+               std::strcmp(fill.sellOrderId, trade.sellOrderId) == 0;
+    }
+
+private:
+    std::vector<Fill> fills;
+    std::size_t next = 0;
+};
+
+// Restores the engine's side effects however replay ends
+class SideEffectsOff {
+public:
+    explicit SideEffectsOff(MatchingEngine& matchingEngine) : engine(matchingEngine) { engine.setSideEffectsEnabled(false); }
+    ~SideEffectsOff() { engine.setSideEffectsEnabled(true); }
+
+private:
+    MatchingEngine& engine;
+};
+
+} // namespace
+
+std::string ReplayStats::toString() const {
+    char buffer[512];
+    std::string restored;
+    if (!snapshotPath.empty()) {
+        std::snprintf(buffer, sizeof(buffer), "Restored %llu orders from %s; ", static_cast<unsigned long long>(snapshotOrders), snapshotPath.c_str());
+        restored = buffer;
+    }
+    if (snapshotsRejected > 0) {
+        restored += std::to_string(snapshotsRejected) + " newer snapshot(s) did not verify; ";
+    }
+    std::snprintf(buffer, sizeof(buffer),
+                  "Replayed %llu journal records (%llu orders, %llu modifies, %llu cancels, %llu rejected) in %.3f s, "
+                  "%.0f records/s; %llu trades verified, %llu mismatched",
+                  static_cast<unsigned long long>(records), static_cast<unsigned long long>(orders),
+                  static_cast<unsigned long long>(modifies), static_cast<unsigned long long>(cancels),
+                  static_cast<unsigned long long>(rejected), seconds, getRecordsPerSecond(),
+                  static_cast<unsigned long long>(tradesVerified), static_cast<unsigned long long>(tradeMismatches));
+    return damaged ? restored + buffer + "; stopped early: " + error : restored + buffer;
+}
+
+ReplayStats replayJournal(const std::string& path, MatchingEngine& engine, const EngineSnapshot* snapshot) {
+    ReplayStats stats;
+    JournalReader reader(path);
+    if (!reader.isOpen()) {
+        return stats; // Nothing journaled yet
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    SideEffectsOff quiet(engine);
+    ReplayFillChecker checker;
+    std::vector<SymbolId> symbolIds; // Journal SymbolId -> engine SymbolId, from the SYMBOL records
+    std::uint64_t covered = 0;       // Records up to here are already in the books
+    if (snapshot != nullptr) {
+        // The snapshot's symbol table stands in for SYMBOL records that may have been truncated away
+        covered = snapshot->getJournalSequence();
+        for (const SnapshotSymbol& entry : snapshot->getSymbols()) {
+            if (entry.symbolId >= symbolIds.size()) {
+                symbolIds.resize(entry.symbolId + 1, INVALID_SYMBOL_ID);
+            }
+            symbolIds[entry.symbolId] = engine.getSymbols().find(entry.symbol);
+        }
+    }
+    std::string orderId;
+    orderId.reserve(MAX_ORDER_ID_LENGTH);
+
+    JournalRecord record;
+    bool first = true;
+    while (reader.next(record)) {
+        if (first && record.sequence > covered + 1) {
+            stats.damaged = true;
+            stats.error = "Journal resumes at sequence " + std::to_string(record.sequence) + " but the books only cover up to " +
+                          std::to_string(covered) + "; the records in between were truncated.";
+            break;
+        }
+        first = false;
+        if (record.sequence <= covered) {
+            stats.skipped++;
+            continue;
+        }
+        stats.records++;
+        if (record.type == JournalRecordType::SYMBOL) {
+            SymbolId symbolId = engine.internSymbol(record.orderId);
+            const Instrument& instrument = engine.getSymbols().getInstrument(symbolId);
+            if (instrument.tickSize != record.tickSize || instrument.lotSize != record.quantity) {
+                engine.setInstrument(record.orderId, record.tickSize, record.quantity);
+            }
+            if (record.symbolId >= symbolIds.size()) {
+                symbolIds.resize(record.symbolId + 1, INVALID_SYMBOL_ID);
+            }
+            symbolIds[record.symbolId] = symbolId;
+            continue;
+        }
+        SymbolId symbolId = record.symbolId < symbolIds.size() ? symbolIds[record.symbolId] : INVALID_SYMBOL_ID;
+
+        bool accepted = true;
+        switch (record.type) {
+            case JournalRecordType::ORDER: {
+                checker.reset();
+                stats.orders++;
+                Order order(record.orderId, symbolId, static_cast<OrderType>(record.side), record.price, record.quantity);
+                order.timestamp = EngineClock::fromWallNanos(record.wallNanos);
+                accepted = symbolId != INVALID_SYMBOL_ID && engine.placeOrder(std::move(order), checker);
+                break;
+            }
+            case JournalRecordType::MODIFY:
+                checker.reset();
+                stats.modifies++;
+                orderId.assign(record.orderId);
+                accepted = engine.modifyOrder(orderId, record.price, record.quantity, checker);
+                break;
+            case JournalRecordType::CANCEL:
+                checker.reset();
+                stats.cancels++;
+                orderId.assign(record.orderId);
+                accepted = engine.cancelOrder(orderId);
+                break;
+            case JournalRecordType::TRADE:
+                if (checker.matches(record, symbolId)) {
+                    stats.tradesVerified++;
+                } else {
+                    stats.tradeMismatches++;
+                }
+                break;
+            default:
+                break;
+        }
+        if (!accepted) {
+            stats.rejected++;
+        }
+    }
+
+    stats.lastSequence = reader.getLastSequence();
+    if (!stats.damaged) {
+        stats.damaged = reader.isDamaged();
+        stats.error = reader.getError();
+    }
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    return stats;
+}
+
+ReplayStats recoverEngine(const std::string& snapshotBase, const std::string& journalPath, MatchingEngine& engine) {
+    auto snapshots = listSnapshots(snapshotBase);
+    EngineSnapshot snapshot;
+    std::uint64_t rejected = 0;
+    for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+        if (!snapshot.read(it->second)) {
+            rejected++;
+            continue;
+        }
+        bool restored;
+        {
+            SideEffectsOff quiet(engine);
+            restored = engine.restoreSnapshot(snapshot);
+        }
+        ReplayStats stats;
+        if (restored) {
+            stats = replayJournal(journalPath, engine, &snapshot);
+        } else {
+            stats.damaged = true;
+            stats.error = "Could not restore the orders in " + it->second + ".";
+        }
+        stats.snapshotPath = it->second;
+        stats.snapshotOrders = snapshot.getOrders().size();
+        stats.snapshotsRejected = rejected;
+        return stats;
+    }
+    ReplayStats stats = replayJournal(journalPath, engine);
+    stats.snapshotsRejected = rejected;
+    return stats;
+}
@@ -0,0 +1,42 @@
+#ifndef JOURNAL_REPLAY_H
+#define JOURNAL_REPLAY_H
+
+#include "Journal.h"
+#include "MatchingEngine.h"
+#include "Snapshot.h"
+#include <cstdint>
+#include <string>
+
+struct ReplayStats {
+    std::string snapshotPath;            // Snapshot the books were restored from, empty if none
+    std::uint64_t snapshotOrders = 0;
+    std::uint64_t snapshotsRejected = 0; // Newer snapshots skipped because they did not verify
+    std::uint64_t records = 0;           // Journal records replayed after the snapshot
+    std::uint64_t orders = 0;
+    std::uint64_t modifies = 0;
+    std::uint64_t cancels = 0;
+    std::uint64_t rejected = 0;        // Commands the engine refused again, as it did when they were journaled
+    std::uint64_t tradesVerified = 0;  // Journaled trades the replay reproduced exactly
+    std::uint64_t tradeMismatches = 0; // Journaled trades the replay did not reproduce
+    std::uint64_t skipped = 0;         // Journal records the snapshot already covered
+    std::uint64_t lastSequence = 0;    // Last journal sequence read
+    bool damaged = false;              // Replay stopped at a record that did not verify
+    std::string error;
+    double seconds = 0;
+
+    double getRecordsPerSecond() const { return seconds > 0 ? static_cast<double>(records) / seconds : 0; }
+    std::string toString() const;
+};
+
+// Rebuilds an engine's books from a journal by feeding its ORDER, MODIFY and CANCEL records back
+// through the engine in journal order; matching is deterministic, so books and sequence numbers
+// come out as they were. TRADE records are not applied but checked against the fills the replay
+// produces. The engine's logging and notifications are off while it runs. Call on a fresh engine,
+// or on one just restored from snapshot, in which case only the records after it are applied.
+ReplayStats replayJournal(const std::string& path, MatchingEngine& engine, const EngineSnapshot* snapshot = nullptr);
+
+// Restores the newest snapshot under snapshotBase that verifies, falling back to older ones, then
+// replays the journal after it; with no usable snapshot the whole journal is replayed.
+ReplayStats recoverEngine(const std::string& snapshotBase, const std::string& journalPath, MatchingEngine& engine);
+
+#endif // JOURNAL_REPLAY_H
@@ -0,0 +1,83 @@
+#include "LogFormat.h"
+
+// Indexed by LogFormat; keep in the same order as the enum
+static const char* const FORMAT_TEXT[] = {
+    "{}",
+    "Attempting to add order: Order ID: {}, Symbol: {}, Type: {}, Price (ticks): {}, Quantity: {}, Timestamp (ns): {}",
+    "Placing order: Order ID: {}, Symbol: {}, Type: {}, Price (ticks): {}, Quantity: {}, Timestamp (ns): {}",
+    "Error: Order ID {} is longer than {} characters.",
+    "Error: Order with ID {} already exists.",
+    "Error: Unknown symbol ID {} for order {}.",
+    "Error: Quantity {} is not a multiple of the lot size for {}.",
+    "Error: Price (ticks) {} of order {} is not positive.",
+    "Modifying order ID: {}",
+    "Attempting to modify order ID: {}",
+    "Error: Order ID {} not found for modification.",
+    "Order {} modified to: Order ID: {}, Symbol: {}, Type: {}, Price (ticks): {}, Quantity: {}, Timestamp (ns): {}",
+    "Cancelling order ID: {}",
+    "Attempting to cancel order ID: {}",
+    "Error: Order ID {} not found for cancellation.",
+    "Order {} cancelled.",
+    "Trade executed: Trade ID: {}, Buy Order ID: {}, Sell Order ID: {}, Symbol: {}, Price (ticks): {}, Quantity: {}, Timestamp (ns): {}",
+};
+
+static_assert(sizeof(FORMAT_TEXT) / sizeof(FORMAT_TEXT[0]) == static_cast<std::size_t>(LogFormat::COUNT),
+              "Every LogFormat needs a format string");
+
+const char* getLogFormatText(LogFormat format) {
+    std::size_t index = static_cast<std::size_t>(format);
+    return index < static_cast<std::size_t>(LogFormat::COUNT) ? FORMAT_TEXT[index] : "Unknown log format";
+}
+
+// Appends the next argument and returns the offset after it, or length if the payload is exhausted
+static std::size_t appendArg(std::string& out, const char* payload, std::size_t offset, std::size_t length) {
+    if (offset >= length) {
+        return length;
+    }
+    LogArgType type = static_cast<LogArgType>(payload[offset++]);
+    switch (type) {
+        case LogArgType::INT: {
+            if (offset + sizeof(std::int64_t) > length) {
+                return length;
+            }
+            std::int64_t value;
+            std::memcpy(&value, payload + offset, sizeof(value));
+            out += std::to_string(value);
+            return offset + sizeof(value);
+        }
+        case LogArgType::SIDE:
+            if (offset >= length) {
+                return length;
+            }
+            out += static_cast<OrderType>(payload[offset]) == BUY ? "BUY" : "SELL";
+            return offset + 1;
+        case LogArgType::TEXT: {
+            if (offset >= length) {
+                return length;
+            }
+            std::size_t textLength = static_cast<unsigned char>(payload[offset++]);
+            if (offset + textLength > length) {
+                textLength = length - offset;
+            }
+            out.append(payload + offset, textLength);
+            return offset + textLength;
+        }
+    }
+    return length;
+}
+
+void appendLogRecord(std::string& out, LogFormat format, const char* payload, std::size_t length) {
+    if (format == LogFormat::TEXT) {
+        out.append(payload, length);
+        return;
+    }
+    std::size_t offset = 0;
+    for (const char* text = getLogFormatText(format); *text != '\0'; ++text) {
+        if (text[0] == '{' && text[1] == '}') {
+            offset = appendArg(out, payload, offset, length);
+            ++text;
+        } else {
+            out += *text;
+        }
+    }
+}
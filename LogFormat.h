@@ -0,0 +1,121 @@
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include "Order.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Log levels as plain macros so they can be compared in #if
+#define ENGINE_LOG_LEVEL_DEBUG 1
+#define ENGINE_LOG_LEVEL_INFO 2
+#define ENGINE_LOG_LEVEL_WARN 3
+#define ENGINE_LOG_LEVEL_OFF 4
+
+// Lowest level compiled in; statements below it are removed by the preprocessor, arguments included
+#ifndef ENGINE_LOG_LEVEL
+#define ENGINE_LOG_LEVEL ENGINE_LOG_LEVEL_INFO
+#endif
+
+// Structured log statements. Call sites record a format ID and raw arguments; the text is only
+// produced when the record is written (on the writer thread for an asynchronous Logger).
+// A disabled statement only names eventNanos inside sizeof, which is never evaluated.
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_DEBUG
+#define ENGINE_LOG_DEBUG(logger, format, eventNanos, ...) (logger).record((format), (eventNanos), __VA_ARGS__)
+#else
+#define ENGINE_LOG_DEBUG(logger, format, eventNanos, ...) do { (void)sizeof(eventNanos); } while (0)
+#endif
+
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_INFO
+#define ENGINE_LOG_INFO(logger, format, eventNanos, ...) (logger).record((format), (eventNanos), __VA_ARGS__)
+#else
+#define ENGINE_LOG_INFO(logger, format, eventNanos, ...) do { (void)sizeof(eventNanos); } while (0)
+#endif
+
+#if ENGINE_LOG_LEVEL <= ENGINE_LOG_LEVEL_WARN
+#define ENGINE_LOG_WARN(logger, format, eventNanos, ...) (logger).record((format), (eventNanos), __VA_ARGS__)
+#else
+#define ENGINE_LOG_WARN(logger, format, eventNanos, ...) do { (void)sizeof(eventNanos); } while (0)
+#endif
+
+// One entry per message shape; the text lives in LogFormat.cpp. TEXT is an already formatted message.
+enum class LogFormat : std::uint16_t {
+    TEXT,
+    ORDER_RECEIVED,
+    ORDER_PLACING,
+    ORDER_ID_TOO_LONG,
+    ORDER_DUPLICATE,
+    ORDER_UNKNOWN_SYMBOL,
+    ORDER_BAD_QUANTITY,
+    ORDER_BAD_PRICE,
+    ORDER_MODIFY_REQUESTED,
+    ORDER_MODIFY_ATTEMPT,
+    ORDER_MODIFY_NOT_FOUND,
+    ORDER_MODIFIED,
+    ORDER_CANCEL_REQUESTED,
+    ORDER_CANCEL_ATTEMPT,
+    ORDER_CANCEL_NOT_FOUND,
+    ORDER_CANCELLED,
+    TRADE_EXECUTED,
+    COUNT
+};
+
+const char* getLogFormatText(LogFormat format);
+
+enum class LogArgType : std::uint8_t { INT, SIDE, TEXT };
+
+// Packs arguments into a record's payload as [type][value]; text is stored as [length][bytes]
+class LogArgWriter {
+public:
+    LogArgWriter(char* buffer, std::size_t capacity) : buffer(buffer), capacity(capacity) {}
+
+    void put(long long value) { putInt(static_cast<std::int64_t>(value)); }
+    void put(long value) { putInt(static_cast<std::int64_t>(value)); }
+    void put(int value) { putInt(value); }
+    void put(unsigned long long value) { putInt(static_cast<std::int64_t>(value)); }
+    void put(unsigned long value) { putInt(static_cast<std::int64_t>(value)); }
+    void put(unsigned int value) { putInt(value); }
+    void put(OrderType side) {
+        if (size + 2 <= capacity) {
+            buffer[size++] = static_cast<char>(LogArgType::SIDE);
+            buffer[size++] = static_cast<char>(side);
+        }
+    }
+    void put(const std::string& text) { putText(text.data(), text.size()); }
+    void put(const char* text) { putText(text, std::strlen(text)); }
+
+    std::size_t getSize() const { return size; }
+
+private:
+    char* buffer;
+    std::size_t capacity;
+    std::size_t size = 0;
+
+    void putInt(std::int64_t value) {
+        if (size + 1 + sizeof(value) <= capacity) {
+            buffer[size++] = static_cast<char>(LogArgType::INT);
+            std::memcpy(buffer + size, &value, sizeof(value));
+            size += sizeof(value);
+        }
+    }
+
+    // Text that does not fit is cut to the space left
+    void putText(const char* text, std::size_t length) {
+        if (size + 2 > capacity) {
+            return;
+        }
+        std::size_t room = capacity - size - 2;
+        if (length > room) length = room;
+        if (length > 255) length = 255;
+        buffer[size++] = static_cast<char>(LogArgType::TEXT);
+        buffer[size++] = static_cast<char>(static_cast<unsigned char>(length));
+        std::memcpy(buffer + size, text, length);
+        size += length;
+    }
+};
+
+// Produces the message text of a record: each "{}" in the format takes the next argument
+void appendLogRecord(std::string& out, LogFormat format, const char* payload, std::size_t length);
+
+#endif // LOG_FORMAT_H
@@ -1,35 +1,189 @@
-#include <sstream>
+#include <ctime>
+#include <cstring>
 #include "Logger.h"
+#include "EngineClock.h"
+
+// Records the writer formats before it flushes and looks at the ring again
+static const std::size_t WRITER_BATCH = 512;
+// How long an idle writer sleeps between polls
+static const std::chrono::microseconds WRITER_IDLE_SLEEP(200);
 
 Logger::Logger(const std::string& filename) {
+    open(filename);
+}
+
+Logger::Logger(const std::string& filename, std::size_t ringCapacity, LogOverflowPolicy policy)
+    : ring(std::make_unique<MpscRing<LogRecord>>(ringCapacity)), overflowPolicy(policy) {
+    open(filename);
+    writer = std::thread(&Logger::runWriter, this);
+}
+
+Logger::~Logger() {
+    if (writer.joinable()) {
+        stopping.store(true, std::memory_order_release);
+        writer.join(); // The writer drains the ring before it exits
+    }
+    if (logFile.is_open()) {
+        logFile.close();
+    }
+}
+
+void Logger::open(const std::string& filename) {
     logFile.open(filename, std::ios_base::app);
     if (!logFile.is_open()) {
         std::cerr << "Error: Could not open log file " << filename << std::endl;
     }
 }
 
-Logger::~Logger() {
-    if (logFile.is_open()) {
-        logFile.close();
+void Logger::log(const std::string& message, long long eventNanos) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (ring) {
+        enqueue(message, eventNanos, false);
+    } else if (logFile.is_open()) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        logFile << getTimestamp(eventNanos) << " - " << message << std::endl;
     }
 }
 
-void Logger::log(const std::string& message) {
-    if (logFile.is_open()) {
-        logFile << getTimestamp() << " - " << message << std::endl;
+void Logger::consoleLog(const std::string& message, long long eventNanos) {
+    if (!enabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+    if (ring) {
+        enqueue(message, eventNanos, true);
+    } else {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        std::cout << getTimestamp(eventNanos) << " - " << message << std::endl;
     }
 }
 
-void Logger::consoleLog(const std::string& message) {
-    std::cout << getTimestamp() << " - " << message << std::endl;
+void Logger::flush() {
+    if (!ring) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        logFile.flush();
+        std::cout.flush();
+        return;
+    }
+    const std::uint64_t target = accepted.load(std::memory_order_acquire);
+    while (written.load(std::memory_order_acquire) < target) {
+        std::this_thread::yield();
+    }
 }
 
-std::string Logger::getTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto in_time_t = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+void Logger::enqueue(const std::string& message, long long eventNanos, bool console) {
+    LogRecord entry;
+    // Stamp on the caller's thread; the writer may format much later
+    entry.eventNanos = eventNanos != 0 ? eventNanos : EngineClock::now();
+    entry.format = LogFormat::TEXT;
+    entry.console = console;
+    if (message.size() <= RECORD_TEXT_SIZE) {
+        entry.length = static_cast<std::uint16_t>(message.size());
+        std::memcpy(entry.text, message.data(), message.size());
+    } else {
+        entry.length = static_cast<std::uint16_t>(RECORD_TEXT_SIZE);
+        std::memcpy(entry.text, message.data(), RECORD_TEXT_SIZE - 3);
+        std::memcpy(entry.text + RECORD_TEXT_SIZE - 3, "...", 3);
+    }
+    submit(entry);
 }
 
+void Logger::submit(const LogRecord& entry) {
+    if (!ring) {
+        std::lock_guard<std::mutex> lock(syncMutex);
+        write(entry);
+        logFile.flush();
+        std::cout.flush();
+        return;
+    }
+    while (!ring->tryPush(entry)) {
+        if (overflowPolicy != LogOverflowPolicy::BLOCK) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+    }
+    // Counted once pushed, so flush() never waits for a record that was dropped
+    accepted.fetch_add(1, std::memory_order_release);
+}
+
+void Logger::write(const LogRecord& entry) {
+    if (entry.format == LogFormat::TEXT) {
+        write(entry.text, entry.length, entry.eventNanos, entry.console);
+        return;
+    }
+    formatBuffer.clear();
+    appendLogRecord(formatBuffer, entry.format, entry.text, entry.length);
+    write(formatBuffer.data(), formatBuffer.size(), entry.eventNanos, entry.console);
+}
+
+void Logger::write(const char* message, std::size_t length, long long eventNanos, bool console) {
+    const char* timestamp = getTimestamp(eventNanos);
+    if (console) {
+        std::cout << timestamp << " - ";
+        std::cout.write(message, static_cast<std::streamsize>(length));
+        std::cout << '\n';
+    } else if (logFile.is_open()) {
+        logFile << timestamp << " - ";
+        logFile.write(message, static_cast<std::streamsize>(length));
+        logFile << '\n';
+    }
+}
+
+std::size_t Logger::writeBatch() {
+    std::size_t count = ring->drain([this](const LogRecord& entry) { write(entry); }, WRITER_BATCH);
 
+    bool reported = false;
+    if (overflowPolicy == LogOverflowPolicy::COUNT) {
+        std::uint64_t totalDrops = dropped.load(std::memory_order_relaxed);
+        if (totalDrops != reportedDrops) {
+            std::string notice = "Logger dropped " + std::to_string(totalDrops - reportedDrops) + " messages (ring full)";
+            write(notice.data(), notice.size(), EngineClock::now(), false);
+            reportedDrops = totalDrops;
+            reported = true;
+        }
+    }
+    if (count == 0 && !reported) {
+        return 0;
+    }
+    // One flush per batch instead of one per message
+    logFile.flush();
+    std::cout.flush();
+    written.fetch_add(count, std::memory_order_release);
+    return count;
+}
+
+void Logger::runWriter() {
+    while (true) {
+        // Read the stop flag first, so a ring found empty afterwards really is drained
+        bool stop = stopping.load(std::memory_order_acquire);
+        if (writeBatch() > 0) {
+            continue;
+        }
+        if (stop) {
+            break;
+        }
+        std::this_thread::sleep_for(WRITER_IDLE_SLEEP);
+    }
+}
+
+const char* Logger::getTimestamp(long long eventNanos) {
+    if (eventNanos == 0) {
+        eventNanos = EngineClock::now();
+    }
+    // Wall-clock conversion happens here, at output; the formatted text only changes once a second
+    std::time_t second = static_cast<std::time_t>(EngineClock::toWallNanos(eventNanos) / 1000000000LL);
+    if (second != cachedSecond) {
+        // Reentrant localtime: loggers of different matching threads format concurrently
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &second);
+#else
+        localtime_r(&second, &local);
+#endif
+        std::strftime(cachedTimestamp, sizeof(cachedTimestamp), "%Y-%m-%d %H:%M:%S", &local);
+        cachedSecond = second;
+    }
+    return cachedTimestamp;
+}
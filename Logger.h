@@ -1,25 +1,109 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include "RingBuffer.h"
+#include "LogFormat.h"
+#include "EngineClock.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <fstream>
 #include <iostream>
 #include <chrono>
 #include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// What an asynchronous logger does when its ring is full
+enum class LogOverflowPolicy {
+    DROP,  // Discard the message; only getDroppedCount() shows it
+    BLOCK, // Wait for the writer thread to make room
+    COUNT  // Discard the message and write a "dropped N messages" line once the writer catches up
+};
 
 class Logger {
 public:
+    // Synchronous logger: every call formats and writes on the caller's thread
     Logger(const std::string& filename = "logs.txt");
+    // Asynchronous logger: calls copy the message into a preallocated ring and return; a background
+    // thread formats, writes and flushes in batches. Everything accepted is written before destruction.
+    Logger(const std::string& filename, std::size_t ringCapacity, LogOverflowPolicy policy = LogOverflowPolicy::COUNT);
     ~Logger();
 
-    void log(const std::string& message);
-    void consoleLog(const std::string& message);
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // eventNanos is the EngineClock stamp of the event being logged; 0 means "now"
+    void log(const std::string& message, long long eventNanos = 0);
+    void consoleLog(const std::string& message, long long eventNanos = 0);
+
+    // Structured console message: only the format ID and raw arguments are captured here, and the
+    // text is produced when the record is written. Call through the ENGINE_LOG_* macros.
+    template <typename... Args>
+    void record(LogFormat format, long long eventNanos, const Args&... args) {
+        if (!enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        LogRecord entry;
+        entry.eventNanos = eventNanos != 0 ? eventNanos : EngineClock::now();
+        entry.format = format;
+        entry.console = true;
+        LogArgWriter writer(entry.text, RECORD_TEXT_SIZE);
+        (writer.put(args), ...);
+        entry.length = static_cast<std::uint16_t>(writer.getSize());
+        submit(entry);
+    }
+
+    // Blocks until every message accepted so far has been written and flushed
+    void flush();
+
+    // A disabled logger drops every message on the caller's thread (e.g. while the journal is replayed)
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    bool isAsync() const { return ring != nullptr; }
+    std::uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
 
 private:
+    // Longest message (or packed arguments) a record holds; longer text is cut and ends in "..."
+    static const std::size_t RECORD_TEXT_SIZE = 232;
+
+    struct LogRecord {
+        long long eventNanos;
+        LogFormat format;
+        std::uint16_t length;
+        bool console;
+        char text[RECORD_TEXT_SIZE]; // Message for LogFormat::TEXT, packed arguments otherwise
+    };
+
     std::ofstream logFile;
-    std::string getTimestamp();
-};
+    std::atomic<bool> enabled{true};
+    long long cachedSecond = -1;
+    char cachedTimestamp[32] = {0};
+    // Synchronous mode: callers on different threads share the timestamp cache, formatBuffer and the streams
+    std::mutex syncMutex;
 
-#endif // LOGGER_H
+    // Asynchronous mode only
+    std::unique_ptr<MpscRing<LogRecord>> ring;
+    LogOverflowPolicy overflowPolicy = LogOverflowPolicy::COUNT;
+    std::atomic<std::uint64_t> accepted{0}; // Records pushed into the ring
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::uint64_t reportedDrops = 0; // Writer thread only
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+    std::string formatBuffer; // Used by whichever thread writes: the caller (sync) or the writer (async)
 
+    void open(const std::string& filename);
+    void enqueue(const std::string& message, long long eventNanos, bool console);
+    void submit(const LogRecord& entry);
+    void write(const LogRecord& entry);
+    void write(const char* message, std::size_t length, long long eventNanos, bool console);
+    void runWriter();
+    std::size_t writeBatch();
 
+    const char* getTimestamp(long long eventNanos);
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,346 @@
+#include "MappedJournal.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+
+namespace {
+
+// The sequence field is written last, with release ordering, and marks the slot complete
+const std::size_t SEQUENCE_OFFSET = offsetof(JournalRecord, sequence);
+const std::size_t AFTER_SEQUENCE = SEQUENCE_OFFSET + sizeof(std::uint64_t);
+
+std::string describeErrno(const std::string& what, const std::string& path) {
+    return "Error: " + what + " " + path + ": " + std::strerror(errno);
+}
+
+// Makes a newly created segment's directory entry durable
+void syncDirectory(const std::string& path) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+MappedJournal::MappedJournal(const std::string& journalBasePath, const JournalOptions& journalOptions)
+    : basePath(journalBasePath), options(journalOptions) {
+    recordsPerSegment = options.segmentBytes > sizeof(JournalHeader) ? (options.segmentBytes - sizeof(JournalHeader)) / sizeof(JournalRecord) : 0;
+    if (recordsPerSegment == 0) {
+        recordsPerSegment = 1;
+    }
+    segmentBytes = sizeof(JournalHeader) + recordsPerSegment * sizeof(JournalRecord);
+
+    std::error_code ec;
+    if (std::filesystem::is_regular_file(basePath, ec)) {
+        fail("Error: " + basePath + " is a buffered journal, not a segment base path.");
+        return;
+    }
+    auto existing = listJournalSegments(basePath);
+    if (!existing.empty()) {
+        JournalReader reader(basePath);
+        JournalRecord record;
+        while (reader.next(record)) {
+        }
+        // A bad record is only acceptable as the torn tail of the newest segment
+        if (!reader.isOpen() || (reader.isDamaged() && reader.getFileIndex() + 1 < reader.getFileCount())) {
+            fail("Error: Journal " + basePath + " is damaged: " + reader.getError());
+            return;
+        }
+        firstSequence = reader.getLastSequence() + 1;
+        firstSegmentNumber = existing.back().first + 1;
+    }
+    nextSequence.store(firstSequence, std::memory_order_relaxed);
+    committedSequence.store(firstSequence - 1, std::memory_order_relaxed);
+
+    // The first segment plus one spare, so writers never wait for the committer at startup
+    for (std::uint64_t index = 0; index < 2; ++index) {
+        if (!mapSegment(index)) {
+            return;
+        }
+        mappedSegments.store(index + 1, std::memory_order_release);
+    }
+    opened = true;
+    committer = std::thread(&MappedJournal::runCommitter, this);
+}
+
+MappedJournal::~MappedJournal() {
+    if (committer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(commitMutex);
+            stopping.store(true, std::memory_order_release);
+            commitRequested = true;
+        }
+        wakeCommitter.notify_one();
+        committer.join(); // Commits everything appended before it exits
+    }
+    std::uint64_t done = committedSequence.load(std::memory_order_acquire);
+    for (std::uint64_t index = retiredSegments; index < mappedSegments.load(std::memory_order_relaxed); ++index) {
+        std::uint64_t segmentFirst = firstSequence + index * recordsPerSegment;
+        std::uint64_t used = done >= segmentFirst ? std::min(recordsPerSegment, done - segmentFirst + 1) : 0;
+        retireSegment(index, used);
+    }
+}
+
+std::uint64_t MappedJournal::append(JournalRecord& record) {
+    if (!isOpen()) {
+        return 0;
+    }
+    std::uint64_t sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    std::uint64_t index = (sequence - firstSequence) / recordsPerSegment;
+    if (mappedSegments.load(std::memory_order_acquire) <= index) {
+        // Writers got ahead of the spare segment; have the committer map the next one now
+        endBatch();
+        while (mappedSegments.load(std::memory_order_acquire) <= index) {
+            if (failed.load(std::memory_order_acquire)) {
+                return 0;
+            }
+            std::this_thread::yield();
+        }
+    }
+    record.sequence = sequence;
+    record.crc = journalRecordCrc(record);
+
+    char* slot = reinterpret_cast<char*>(slotFor(sequence));
+    const char* source = reinterpret_cast<const char*>(&record);
+    std::memcpy(slot, source, SEQUENCE_OFFSET);
+    std::memcpy(slot + AFTER_SEQUENCE, source + AFTER_SEQUENCE, sizeof(JournalRecord) - AFTER_SEQUENCE);
+    // The slot lives in shared file memory rather than in a std::atomic, hence the builtin
+    __atomic_store_n(&slotFor(sequence)->sequence, sequence, __ATOMIC_RELEASE);
+    return sequence;
+}
+
+bool MappedJournal::endBatch() {
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        commitRequested = true;
+    }
+    wakeCommitter.notify_one();
+    return isOpen();
+}
+
+bool MappedJournal::waitForCommit(std::uint64_t sequence) {
+    std::uint64_t last = getLastSequence();
+    if (sequence > last) {
+        sequence = last;
+    }
+    if (committedSequence.load(std::memory_order_acquire) >= sequence) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(commitMutex);
+    commitRequested = true;
+    wakeCommitter.notify_one();
+    committed.wait(lock, [&] {
+        return committedSequence.load(std::memory_order_acquire) >= sequence || failed.load(std::memory_order_acquire);
+    });
+    return committedSequence.load(std::memory_order_acquire) >= sequence;
+}
+
+JournalRecord* MappedJournal::slotFor(std::uint64_t sequence) const {
+    std::uint64_t index = (sequence - firstSequence) / recordsPerSegment;
+    const Segment& segment = segments[index % SEGMENT_SLOTS];
+    return reinterpret_cast<JournalRecord*>(segment.base + sizeof(JournalHeader)) + (sequence - segment.firstSequence);
+}
+
+bool MappedJournal::mapSegment(std::uint64_t index) {
+    Segment& segment = segments[index % SEGMENT_SLOTS];
+    segment.firstSequence = firstSequence + index * recordsPerSegment;
+    segment.path = journalSegmentPath(basePath, firstSegmentNumber + index);
+
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (segment.fd < 0) {
+        fail(describeErrno("Unable to create journal segment", segment.path));
+        return false;
+    }
+    // Allocate the blocks up front so writes never extend the file
+    int allocated = EINVAL;
+#ifdef __linux__
+    allocated = ::posix_fallocate(segment.fd, 0, static_cast<off_t>(segmentBytes));
+#endif
+    if (allocated != 0 && ::ftruncate(segment.fd, static_cast<off_t>(segmentBytes)) != 0) {
+        fail(describeErrno("Unable to size journal segment", segment.path));
+        retireSegment(index, 0);
+        return false;
+    }
+    void* mapping = ::mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+    if (mapping == MAP_FAILED) {
+        fail(describeErrno("Unable to map journal segment", segment.path));
+        retireSegment(index, 0);
+        return false;
+    }
+    segment.base = static_cast<char*>(mapping);
+
+    JournalHeader header{};
+    std::memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    header.recordSize = sizeof(JournalRecord);
+    header.createdWallNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    header.firstSequence = segment.firstSequence;
+    std::memcpy(segment.base, &header, sizeof(header));
+
+    if (options.syncMode != JournalSyncMode::NONE) {
+        syncDirectory(segment.path);
+    }
+    return true;
+}
+
+void MappedJournal::retireSegment(std::uint64_t index, std::uint64_t usedRecords) {
+    Segment& segment = segments[index % SEGMENT_SLOTS];
+    if (segment.base != nullptr) {
+        ::munmap(segment.base, segmentBytes);
+        segment.base = nullptr;
+    }
+    if (segment.fd < 0) {
+        return;
+    }
+    if (usedRecords == 0) {
+        ::unlink(segment.path.c_str()); // A spare nobody wrote to
+    } else if (usedRecords < recordsPerSegment) {
+        // Last segment of the run: drop the unused preallocated tail
+        if (::ftruncate(segment.fd, static_cast<off_t>(sizeof(JournalHeader) + usedRecords * sizeof(JournalRecord))) == 0 &&
+            options.syncMode != JournalSyncMode::NONE) {
+            ::fsync(segment.fd);
+        }
+    }
+    ::close(segment.fd);
+    segment.fd = -1;
+}
+
+bool MappedJournal::sync(std::uint64_t from, std::uint64_t to) {
+    if (options.syncMode == JournalSyncMode::NONE) {
+        return true;
+    }
+    static const std::uint64_t pageSize = static_cast<std::uint64_t>(::sysconf(_SC_PAGESIZE));
+    while (from <= to) {
+        std::uint64_t index = (from - firstSequence) / recordsPerSegment;
+        const Segment& segment = segments[index % SEGMENT_SLOTS];
+        std::uint64_t segmentLast = segment.firstSequence + recordsPerSegment - 1;
+        std::uint64_t last = to < segmentLast ? to : segmentLast;
+
+        int result = 0;
+        if (options.syncMode == JournalSyncMode::MSYNC) {
+            std::uint64_t begin = sizeof(JournalHeader) + (from - segment.firstSequence) * sizeof(JournalRecord);
+            std::uint64_t end = sizeof(JournalHeader) + (last - segment.firstSequence + 1) * sizeof(JournalRecord);
+            begin -= begin % pageSize;
+            result = ::msync(segment.base + begin, end - begin, MS_SYNC);
+        } else {
+#ifdef __APPLE__
+            result = ::fsync(segment.fd);
+#else
+            result = ::fdatasync(segment.fd);
+#endif
+        }
+        if (result != 0) {
+            fail(describeErrno("Unable to sync journal segment", segment.path));
+            return false;
+        }
+        from = last + 1;
+    }
+    return true;
+}
+
+bool MappedJournal::commitOnce() {
+    std::uint64_t done = committedSequence.load(std::memory_order_relaxed);
+    std::uint64_t reserved = nextSequence.load(std::memory_order_acquire) - 1;
+    std::uint64_t mapped = mappedSegments.load(std::memory_order_relaxed);
+
+    // Longest run of completed slots after the committed sequence
+    std::uint64_t target = done;
+    while (target < reserved && (target + 1 - firstSequence) / recordsPerSegment < mapped &&
+           __atomic_load_n(&slotFor(target + 1)->sequence, __ATOMIC_ACQUIRE) == target + 1) {
+        ++target;
+    }
+
+    bool progress = false;
+    if (target > done) {
+        if (!sync(done + 1, target)) {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(commitMutex);
+            committedSequence.store(target, std::memory_order_release);
+        }
+        commitCount.fetch_add(1, std::memory_order_relaxed);
+        committed.notify_all();
+        done = target;
+        progress = true;
+    }
+
+    // Full, committed segments are no longer written by anyone
+    while (retiredSegments < mapped && done >= firstSequence + (retiredSegments + 1) * recordsPerSegment - 1) {
+        retireSegment(retiredSegments, recordsPerSegment);
+        retiredSegments++;
+    }
+
+    // Keep one spare segment mapped past the newest reservation
+    std::uint64_t newest = reserved >= firstSequence ? (reserved - firstSequence) / recordsPerSegment : 0;
+    while (mapped < newest + 2 && mapped < retiredSegments + SEGMENT_SLOTS) {
+        if (!mapSegment(mapped)) {
+            return false;
+        }
+        mappedSegments.store(++mapped, std::memory_order_release);
+        progress = true;
+    }
+    return progress;
+}
+
+void MappedJournal::runCommitter() {
+    while (true) {
+        // Read the stop flag first, so finding nothing to commit afterwards means everything is committed
+        bool stop = stopping.load(std::memory_order_acquire);
+        if (commitOnce()) {
+            continue;
+        }
+        if (stop || failed.load(std::memory_order_acquire)) {
+            break;
+        }
+        std::unique_lock<std::mutex> lock(commitMutex);
+        wakeCommitter.wait_for(lock, options.commitInterval, [&] {
+            return commitRequested || stopping.load(std::memory_order_relaxed);
+        });
+        commitRequested = false;
+    }
+}
+
+void MappedJournal::fail(const std::string& message) {
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        if (!failed.load(std::memory_order_relaxed)) {
+            error = message;
+            failed.store(true, std::memory_order_release);
+        }
+    }
+    committed.notify_all();
+}
+
+#else
+
+MappedJournal::MappedJournal(const std::string& journalBasePath, const JournalOptions& journalOptions)
+    : basePath(journalBasePath), options(journalOptions) {
+    fail("Error: Memory-mapped journals are not supported on this platform.");
+}
+
+MappedJournal::~MappedJournal() {}
+
+std::uint64_t MappedJournal::append(JournalRecord&) { return 0; }
+bool MappedJournal::endBatch() { return false; }
+bool MappedJournal::waitForCommit(std::uint64_t) { return false; }
+
+void MappedJournal::fail(const std::string& message) {
+    error = message;
+    failed.store(true, std::memory_order_release);
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef MAPPED_JOURNAL_H
+#define MAPPED_JOURNAL_H
+
+#include "Journal.h"
+#include "RingBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Journal over preallocated, memory-mapped segment files (<basePath>.000001, ...). Writers on any
+// thread reserve a slot with one atomic increment of the sequence and copy the record into the
+// mapping; a background committer finds the contiguous prefix of completed records, syncs it
+// according to JournalSyncMode once for the whole group, and advances the committed sequence.
+// Full segments are retired and new ones mapped ahead of the writers. POSIX only.
+class MappedJournal : public JournalWriter {
+public:
+    // Always starts a new segment; the sequence continues from the segments already on disk
+    explicit MappedJournal(const std::string& basePath, const JournalOptions& options = JournalOptions());
+    ~MappedJournal(); // Commits everything appended and trims the last segment to its records
+
+    MappedJournal(const MappedJournal&) = delete;
+    MappedJournal& operator=(const MappedJournal&) = delete;
+
+    bool isOpen() const override { return opened && !failed.load(std::memory_order_acquire); }
+
+    // Thread-safe
+    std::uint64_t append(JournalRecord& record) override;
+    // Wakes the committer instead of waiting for its next interval
+    bool endBatch() override;
+    bool waitForCommit(std::uint64_t sequence) override;
+
+    std::uint64_t getLastSequence() const override { return nextSequence.load(std::memory_order_acquire) - 1; }
+    std::uint64_t getCommittedSequence() const { return committedSequence.load(std::memory_order_acquire); }
+    // Group commits so far; appended records / commits is the average group size
+    std::uint64_t getCommitCount() const { return commitCount.load(std::memory_order_relaxed); }
+    const std::string& getPath() const override { return basePath; }
+    // Only meaningful once isOpen() is false
+    const std::string& getError() const override { return error; }
+
+private:
+    // Segments mapped at once: the oldest uncommitted one plus those mapped ahead of the writers
+    static const std::size_t SEGMENT_SLOTS = 4;
+
+    struct Segment {
+        std::uint64_t firstSequence = 0;
+        std::string path;
+        int fd = -1;
+        char* base = nullptr;
+    };
+
+    std::string basePath;
+    JournalOptions options;
+    std::size_t segmentBytes = 0;
+    std::uint64_t recordsPerSegment = 0;
+    std::uint64_t firstSequence = 1;      // First sequence of this run
+    std::uint64_t firstSegmentNumber = 1; // File number of this run's first segment
+    bool opened = false;
+
+    // Indexed by this run's segment index % SEGMENT_SLOTS; written by the committer only
+    Segment segments[SEGMENT_SLOTS];
+    std::uint64_t retiredSegments = 0;                    // Committer only
+    std::atomic<std::uint64_t> mappedSegments{0};         // Run segments [0, mappedSegments) have been mapped
+
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> nextSequence{1};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::uint64_t> committedSequence{0};
+    std::atomic<std::uint64_t> commitCount{0};
+    std::atomic<bool> failed{false};
+    std::atomic<bool> stopping{false};
+
+    std::mutex commitMutex;
+    std::condition_variable wakeCommitter;
+    std::condition_variable committed;
+    bool commitRequested = false; // Guarded by commitMutex
+    std::thread committer;
+    std::string error; // Written before failed is set
+
+    bool mapSegment(std::uint64_t index);
+    void retireSegment(std::uint64_t index, std::uint64_t usedRecords);
+    JournalRecord* slotFor(std::uint64_t sequence) const;
+    bool sync(std::uint64_t from, std::uint64_t to);
+    bool commitOnce();
+    void runCommitter();
+    void fail(const std::string& message);
+};
+
+#endif // MAPPED_JOURNAL_H
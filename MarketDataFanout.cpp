@@ -0,0 +1,391 @@
+#include "MarketDataFanout.h"
+#include <algorithm>
+#include <chrono>
+
+MarketDataSubscriber::MarketDataSubscriber(MarketDataFanout& owner, const MarketDataFanoutOptions& fanoutOptions)
+    : fanout(owner), options(fanoutOptions) {}
+
+std::size_t MarketDataSubscriber::poll(std::vector<FanoutUpdate>& out, std::size_t maxUpdates, int timeoutMillis) {
+    std::size_t appended = 0;
+    SymbolId reset = INVALID_SYMBOL_ID;
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        auto waiting = [this] { return head != NONE || overrun; };
+        if (timeoutMillis < 0) {
+            ready.wait(lock, waiting);
+        } else if (timeoutMillis > 0) {
+            ready.wait_for(lock, std::chrono::milliseconds(timeoutMillis), waiting);
+        }
+        while (head != NONE && appended < maxUpdates) {
+            std::uint32_t node = head;
+            FanoutUpdate update = nodes[node].update;
+            unlink(node);
+            release(node);
+            if (update.type == FanoutUpdateType::BOOK_RESET) {
+                // Ends the batch: the book is read from the fan-out without this lock held
+                resetPending[update.symbolId] = false;
+                levelEntries--;
+                reset = update.symbolId;
+                break;
+            }
+            if (update.type == FanoutUpdateType::LEVEL) {
+                pendingLevels.erase(LevelKey{update.symbolId, update.side, update.price});
+                levelEntries--;
+            } else {
+                tradeEntries--;
+            }
+            out.push_back(update);
+            appended++;
+        }
+        stats.delivered += appended;
+    }
+    if (reset != INVALID_SYMBOL_ID) {
+        // Updates queued from here on may repeat what the book already shows; each carries a level's
+        // whole state, so applying one again changes nothing
+        std::size_t count = fanout.appendBook(reset, out);
+        appended += count;
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.delivered += count;
+    }
+    return appended;
+}
+
+bool MarketDataSubscriber::isOverrun() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return overrun;
+}
+
+SubscriberStats MarketDataSubscriber::getStats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
+
+void MarketDataSubscriber::pushLevel(const FanoutUpdate& update) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (overrun) {
+            return;
+        }
+        stats.queued++;
+        wake = head == NONE;
+        auto pending = pendingLevels.find(LevelKey{update.symbolId, update.side, update.price});
+        if (pending != pendingLevels.end()) {
+            // Only the latest state is kept, behind every trade it came after
+            std::uint32_t node = pending->second;
+            nodes[node].update = update;
+            if (node != tail) {
+                unlink(node);
+                linkBack(node);
+            }
+            stats.conflated++;
+            return;
+        }
+        if (update.symbolId < resetPending.size() && resetPending[update.symbolId]) {
+            stats.conflated++; // The queued book is read when delivered, so it includes this
+            return;
+        }
+        if (levelEntries >= options.maxPendingLevels) {
+            resetLocked(update.symbolId);
+            stats.resets++;
+        } else {
+            pendingLevels.emplace(LevelKey{update.symbolId, update.side, update.price}, append(update));
+            levelEntries++;
+        }
+    }
+    if (wake) {
+        ready.notify_one();
+    }
+}
+
+void MarketDataSubscriber::pushTrade(const FanoutUpdate& update) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (overrun) {
+            return;
+        }
+        stats.queued++;
+        wake = head == NONE;
+        if (tradeEntries >= options.maxPendingTrades) {
+            // Dropping a trade would go unnoticed and waiting would stall every other subscriber
+            overrun = true;
+            nodes.clear();
+            freeNodes.clear();
+            head = NONE;
+            tail = NONE;
+            pendingLevels.clear();
+            resetPending.clear();
+            levelEntries = 0;
+            tradeEntries = 0;
+            wake = true;
+        } else {
+            append(update);
+            tradeEntries++;
+        }
+    }
+    if (wake) {
+        ready.notify_one();
+    }
+}
+
+void MarketDataSubscriber::pushReset(SymbolId symbolId) {
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (overrun) {
+            return;
+        }
+        wake = head == NONE;
+        resetLocked(symbolId);
+    }
+    if (wake) {
+        ready.notify_one();
+    }
+}
+
+void MarketDataSubscriber::purge(SymbolId symbolId) {
+    std::lock_guard<std::mutex> lock(mtx);
+    purgeLocked(symbolId);
+}
+
+std::uint32_t MarketDataSubscriber::append(const FanoutUpdate& update) {
+    std::uint32_t node;
+    if (!freeNodes.empty()) {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        node = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    nodes[node].update = update;
+    linkBack(node);
+    return node;
+}
+
+void MarketDataSubscriber::linkBack(std::uint32_t node) {
+    nodes[node].prev = tail;
+    nodes[node].next = NONE;
+    if (tail != NONE) {
+        nodes[tail].next = node;
+    } else {
+        head = node;
+    }
+    tail = node;
+}
+
+void MarketDataSubscriber::unlink(std::uint32_t node) {
+    const Node& entry = nodes[node];
+    if (entry.prev != NONE) {
+        nodes[entry.prev].next = entry.next;
+    } else {
+        head = entry.next;
+    }
+    if (entry.next != NONE) {
+        nodes[entry.next].prev = entry.prev;
+    } else {
+        tail = entry.prev;
+    }
+}
+
+void MarketDataSubscriber::release(std::uint32_t node) {
+    freeNodes.push_back(node);
+}
+
+void MarketDataSubscriber::resetLocked(SymbolId symbolId) {
+    if (symbolId < resetPending.size() && resetPending[symbolId]) {
+        return; // The queued book is read when delivered
+    }
+    purgeLocked(symbolId);
+    if (symbolId >= resetPending.size()) {
+        resetPending.resize(symbolId + 1, false);
+    }
+    FanoutUpdate update{};
+    update.type = FanoutUpdateType::BOOK_RESET;
+    update.symbolId = symbolId;
+    append(update);
+    resetPending[symbolId] = true;
+    levelEntries++;
+}
+
+void MarketDataSubscriber::purgeLocked(SymbolId symbolId) {
+    // Trades stay: they are never dropped while the subscriber keeps up
+    std::uint32_t node = head;
+    while (node != NONE) {
+        std::uint32_t next = nodes[node].next;
+        const FanoutUpdate& update = nodes[node].update;
+        if (update.symbolId == symbolId && update.type != FanoutUpdateType::TRADE) {
+            if (update.type == FanoutUpdateType::LEVEL) {
+                pendingLevels.erase(LevelKey{update.symbolId, update.side, update.price});
+            } else {
+                resetPending[symbolId] = false;
+            }
+            levelEntries--;
+            unlink(node);
+            release(node);
+        }
+        node = next;
+    }
+}
+
+MarketDataFanout::MarketDataFanout(const MarketDataFanoutOptions& fanoutOptions) : options(fanoutOptions) {}
+
+std::shared_ptr<MarketDataSubscriber> MarketDataFanout::addSubscriber() {
+    auto subscriber = std::make_shared<MarketDataSubscriber>(*this, options);
+    std::lock_guard<std::mutex> lock(mtx);
+    subscribers.push_back(subscriber);
+    return subscriber;
+}
+
+void MarketDataFanout::removeSubscriber(const std::shared_ptr<MarketDataSubscriber>& subscriber) {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& entry : topics) {
+        std::vector<MarketDataSubscriber*>& list = entry.second->subscribers;
+        list.erase(std::remove(list.begin(), list.end(), subscriber.get()), list.end());
+    }
+    subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+}
+
+void MarketDataFanout::subscribe(MarketDataSubscriber& subscriber, const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::unique_ptr<Topic>& slot = topics[symbol];
+    if (!slot) {
+        slot = std::make_unique<Topic>();
+        slot->symbol = symbol;
+    }
+    Topic& topic = *slot;
+    if (std::find(topic.subscribers.begin(), topic.subscribers.end(), &subscriber) != topic.subscribers.end()) {
+        return;
+    }
+    topic.subscribers.push_back(&subscriber);
+    if (topic.symbolId != INVALID_SYMBOL_ID) {
+        subscriber.pushReset(topic.symbolId);
+    }
+}
+
+void MarketDataFanout::unsubscribe(MarketDataSubscriber& subscriber, const std::string& symbol) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto found = topics.find(symbol);
+    if (found == topics.end()) {
+        return;
+    }
+    Topic& topic = *found->second;
+    topic.subscribers.erase(std::remove(topic.subscribers.begin(), topic.subscribers.end(), &subscriber), topic.subscribers.end());
+    if (topic.symbolId != INVALID_SYMBOL_ID) {
+        subscriber.purge(topic.symbolId);
+    }
+}
+
+std::string MarketDataFanout::getSymbol(SymbolId symbolId) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return symbolId < topicsById.size() && topicsById[symbolId] != nullptr ? topicsById[symbolId]->symbol : std::string();
+}
+
+std::size_t MarketDataFanout::getSubscriberCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return subscribers.size();
+}
+
+void MarketDataFanout::onBookReset(const MarketDataBook& book) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Topic* topic = topicFor(book);
+    if (topic == nullptr) {
+        return;
+    }
+    topic->bids = book.bids;
+    topic->asks = book.asks;
+    for (MarketDataSubscriber* subscriber : topic->subscribers) {
+        subscriber->pushReset(topic->symbolId);
+    }
+}
+
+void MarketDataFanout::onLevel(const MarketDataBook& book, const MarketDataLevel& level) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Topic* topic = topicFor(book);
+    if (topic == nullptr) {
+        return;
+    }
+    FanoutUpdate update{};
+    update.type = FanoutUpdateType::LEVEL;
+    update.side = level.side;
+    update.symbolId = level.symbolId;
+    update.price = level.price;
+    auto& levels = level.side == MARKET_DATA_SIDE_BID ? topic->bids : topic->asks;
+    if (level.header.type == MarketDataMessageType::DELETE_LEVEL) {
+        levels.erase(level.price);
+    } else {
+        levels[level.price] = DepthLevel{level.price, level.quantity, level.orderCount};
+        update.quantity = level.quantity;
+        update.orderCount = level.orderCount;
+    }
+    for (MarketDataSubscriber* subscriber : topic->subscribers) {
+        subscriber->pushLevel(update);
+    }
+}
+
+void MarketDataFanout::onTrade(const MarketDataBook& book, const MarketDataTrade& trade) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Topic* topic = topicFor(book);
+    if (topic == nullptr || topic->subscribers.empty()) {
+        return;
+    }
+    FanoutUpdate update{};
+    update.type = FanoutUpdateType::TRADE;
+    update.side = trade.aggressorSide;
+    update.symbolId = trade.symbolId;
+    update.price = trade.price;
+    update.quantity = trade.quantity;
+    update.tradeId = trade.tradeId;
+    for (MarketDataSubscriber* subscriber : topic->subscribers) {
+        subscriber->pushTrade(update);
+    }
+}
+
+MarketDataFanout::Topic* MarketDataFanout::topicFor(const MarketDataBook& book) {
+    if (book.symbolId < topicsById.size() && topicsById[book.symbolId] != nullptr) {
+        return topicsById[book.symbolId];
+    }
+    if (book.symbol.empty()) {
+        return nullptr; // The feed sends a symbol's name before its first update, so this is not expected
+    }
+    std::unique_ptr<Topic>& slot = topics[book.symbol];
+    if (!slot) {
+        slot = std::make_unique<Topic>();
+        slot->symbol = book.symbol;
+    }
+    slot->symbolId = book.symbolId;
+    if (book.symbolId >= topicsById.size()) {
+        topicsById.resize(book.symbolId + 1, nullptr);
+    }
+    topicsById[book.symbolId] = slot.get();
+    return slot.get();
+}
+
+std::size_t MarketDataFanout::appendBook(SymbolId symbolId, std::vector<FanoutUpdate>& out) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (symbolId >= topicsById.size() || topicsById[symbolId] == nullptr) {
+        return 0;
+    }
+    const Topic& topic = *topicsById[symbolId];
+    std::size_t first = out.size();
+    FanoutUpdate update{};
+    update.type = FanoutUpdateType::BOOK_RESET;
+    update.symbolId = symbolId;
+    out.push_back(update);
+    update.type = FanoutUpdateType::LEVEL;
+    update.side = MARKET_DATA_SIDE_BID;
+    for (auto level = topic.bids.rbegin(); level != topic.bids.rend(); ++level) {
+        update.price = level->first;
+        update.quantity = level->second.totalQuantity;
+        update.orderCount = level->second.orderCount;
+        out.push_back(update);
+    }
+    update.side = MARKET_DATA_SIDE_ASK;
+    for (const auto& level : topic.asks) {
+        update.price = level.first;
+        update.quantity = level.second.totalQuantity;
+        update.orderCount = level.second.orderCount;
+        out.push_back(update);
+    }
+    return out.size() - first;
+}
@@ -0,0 +1,176 @@
+#ifndef MARKET_DATA_FANOUT_H
+#define MARKET_DATA_FANOUT_H
+
+#include "MarketDataReceiver.h"
+#include "SymbolDirectory.h"
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class MarketDataFanout;
+
+enum class FanoutUpdateType : std::uint8_t {
+    BOOK_RESET, // Forget the symbol's book; the LEVEL updates that follow rebuild it
+    LEVEL,      // Latest state of one level; a quantity of 0 means it is gone
+    TRADE
+};
+
+// One update as a subscriber receives it
+struct FanoutUpdate {
+    FanoutUpdateType type;
+    std::uint8_t side;        // LEVEL: MARKET_DATA_SIDE_BID or ASK. TRADE: the aggressor's.
+    SymbolId symbolId;        // MarketDataFanout::getSymbol() names it
+    Price price;
+    std::int32_t quantity;
+    std::int32_t orderCount;  // LEVEL
+    std::uint64_t tradeId;    // TRADE
+};
+
+struct MarketDataFanoutOptions {
+    std::size_t maxPendingLevels = 4096;  // Distinct levels a subscriber may have queued; past it a book is resent whole
+    std::size_t maxPendingTrades = 65536; // Trades a subscriber may have queued; past it the subscriber is cut off
+};
+
+struct SubscriberStats {
+    std::uint64_t queued = 0;    // Updates handed to this subscriber
+    std::uint64_t delivered = 0; // Returned by poll(), book snapshots included
+    std::uint64_t conflated = 0; // Level updates merged into one already queued
+    std::uint64_t resets = 0;    // Books queued whole because too many levels were pending
+};
+
+// One consumer's queue. Level updates for a level already queued replace it and move to the back,
+// so a reader that falls behind sees each level's latest state rather than every step; if too many
+// distinct levels pile up, the symbol's queued levels are replaced by one book snapshot. Trades are
+// never conflated or dropped: a subscriber whose queued trades reach maxPendingTrades is cut off
+// instead (isOverrun()), since the producer never waits for a reader.
+class MarketDataSubscriber {
+public:
+    MarketDataSubscriber(MarketDataFanout& fanout, const MarketDataFanoutOptions& options);
+
+    MarketDataSubscriber(const MarketDataSubscriber&) = delete;
+    MarketDataSubscriber& operator=(const MarketDataSubscriber&) = delete;
+
+    // Consumer thread: appends up to maxUpdates queued updates to out, waiting up to timeoutMillis for
+    // the first; returns how many it appended. A book snapshot is returned whole, even past maxUpdates.
+    std::size_t poll(std::vector<FanoutUpdate>& out, std::size_t maxUpdates, int timeoutMillis);
+    // Nothing more is queued for an overrun subscriber; drop its client and remove it
+    bool isOverrun() const;
+    SubscriberStats getStats() const;
+
+private:
+    friend class MarketDataFanout;
+
+    static const std::uint32_t NONE = ~0U;
+
+    struct Node {
+        FanoutUpdate update;
+        std::uint32_t prev;
+        std::uint32_t next;
+    };
+
+    struct LevelKey {
+        SymbolId symbolId;
+        std::uint8_t side;
+        Price price;
+        bool operator==(const LevelKey& other) const {
+            return symbolId == other.symbolId && side == other.side && price == other.price;
+        }
+    };
+
+    struct LevelKeyHash {
+        std::size_t operator()(const LevelKey& key) const {
+            return std::hash<std::uint64_t>()(static_cast<std::uint64_t>(key.price) * 0x9E3779B97F4A7C15ULL ^
+                                              (static_cast<std::uint64_t>(key.symbolId) << 1 | (key.side == MARKET_DATA_SIDE_BID)));
+        }
+    };
+
+    MarketDataFanout& fanout;
+    MarketDataFanoutOptions options;
+    mutable std::mutex mtx;
+    std::condition_variable ready;
+    // Queue in delivery order, as a list over reusable nodes
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> freeNodes;
+    std::uint32_t head = NONE;
+    std::uint32_t tail = NONE;
+    std::unordered_map<LevelKey, std::uint32_t, LevelKeyHash> pendingLevels; // Node of each queued level
+    std::vector<bool> resetPending; // By SymbolId: a BOOK_RESET is queued
+    std::size_t levelEntries = 0;   // Queued levels and resets
+    std::size_t tradeEntries = 0;
+    bool overrun = false;
+    SubscriberStats stats;
+
+    // Producer side, called by MarketDataFanout with this subscriber's lock not held
+    void pushLevel(const FanoutUpdate& update);
+    void pushTrade(const FanoutUpdate& update);
+    void pushReset(SymbolId symbolId);
+    void purge(SymbolId symbolId);
+
+    // With mtx held
+    std::uint32_t append(const FanoutUpdate& update);
+    void linkBack(std::uint32_t node);
+    void unlink(std::uint32_t node);
+    void release(std::uint32_t node);
+    void resetLocked(SymbolId symbolId);
+    void purgeLocked(SymbolId symbolId);
+};
+
+// Fans a MarketDataReceiver's updates out to subscribers by symbol (a topic per symbol). The receiver's
+// thread is the producer: it only ever takes a subscriber's lock long enough to queue one update, so
+// a slow reader costs itself conflation and snapshots while fast readers get every update.
+// The fan-out keeps each topic's current depth to answer new subscriptions and resets.
+//
+// Subscribers are added, subscribed and removed from any thread; each is polled by its own consumer.
+// The fan-out must outlive every poll() of its subscribers.
+class MarketDataFanout : public MarketDataHandler {
+public:
+    explicit MarketDataFanout(const MarketDataFanoutOptions& options = MarketDataFanoutOptions());
+
+    MarketDataFanout(const MarketDataFanout&) = delete;
+    MarketDataFanout& operator=(const MarketDataFanout&) = delete;
+
+    std::shared_ptr<MarketDataSubscriber> addSubscriber();
+    // Unsubscribes it from everything; whatever it still has queued can be polled
+    void removeSubscriber(const std::shared_ptr<MarketDataSubscriber>& subscriber);
+    // Queues the symbol's current book for the subscriber, then its updates. Symbols the feed has not
+    // carried yet are fine: updates start with their first one.
+    void subscribe(MarketDataSubscriber& subscriber, const std::string& symbol);
+    void unsubscribe(MarketDataSubscriber& subscriber, const std::string& symbol);
+
+    // Name of a symbol ID that updates carry; empty if unknown
+    std::string getSymbol(SymbolId symbolId) const;
+    std::size_t getSubscriberCount() const;
+
+    // MarketDataHandler, on the receiver's thread
+    void onBookReset(const MarketDataBook& book) override;
+    void onLevel(const MarketDataBook& book, const MarketDataLevel& level) override;
+    void onTrade(const MarketDataBook& book, const MarketDataTrade& trade) override;
+
+private:
+    friend class MarketDataSubscriber;
+
+    struct Topic {
+        std::string symbol;
+        SymbolId symbolId = INVALID_SYMBOL_ID; // Until the feed carries the symbol
+        std::map<Price, DepthLevel> bids;      // Ascending; best bid is the last
+        std::map<Price, DepthLevel> asks;
+        std::vector<MarketDataSubscriber*> subscribers;
+    };
+
+    MarketDataFanoutOptions options;
+    mutable std::mutex mtx;
+    std::unordered_map<std::string, std::unique_ptr<Topic>> topics; // By symbol
+    std::vector<Topic*> topicsById;                                 // By SymbolId, once the feed names it
+    std::vector<std::shared_ptr<MarketDataSubscriber>> subscribers;
+
+    Topic* topicFor(const MarketDataBook& book); // With mtx held; null for a book the feed has not named
+    // Appends the symbol's BOOK_RESET and current levels to out; returns how many
+    std::size_t appendBook(SymbolId symbolId, std::vector<FanoutUpdate>& out) const;
+};
+
+#endif // MARKET_DATA_FANOUT_H
@@ -0,0 +1,129 @@
+#ifndef MARKET_DATA_PROTOCOL_H
+#define MARKET_DATA_PROTOCOL_H
+
+#include "Instrument.h"
+#include <cstdint>
+#include <type_traits>
+
+// UDP multicast market data published by MarketDataPublisher, on two channels of one group:
+//  - incremental: every change to a book's aggregated depth (ADD / MODIFY / DELETE_LEVEL) and every
+//    TRADE, numbered by a feed sequence without gaps, several messages per datagram. A SYMBOL message
+//    names a symbol before its first update.
+//  - snapshot: the depth of every book, sent again and again. Each book is tagged with the last feed
+//    sequence it reflects, so a receiver that joins late or loses a datagram rebuilds from it and
+//    applies the buffered incrementals after that sequence.
+// A datagram is a MarketDataPacket followed by whole messages. Messages are fixed-size little-endian
+// structs that start with a MarketDataHeader; sizes are multiples of 8. Prices are integer ticks.
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "Market data is sent in host byte order, which must be little-endian");
+#endif
+
+const std::uint8_t MARKET_DATA_VERSION = 1;
+
+// Longest symbol a SYMBOL message carries
+const std::size_t MARKET_DATA_SYMBOL_LENGTH = 16;
+
+enum class MarketDataChannel : std::uint8_t {
+    INCREMENTAL = 1,
+    SNAPSHOT = 2
+};
+
+enum class MarketDataMessageType : std::uint8_t {
+    ADD_LEVEL = 1,      // A price level appeared
+    MODIFY_LEVEL = 2,   // Its quantity or order count changed
+    DELETE_LEVEL = 3,   // Its last order left (quantity and order count are 0)
+    TRADE = 4,
+    SYMBOL = 5,         // Both channels: the name and tick size behind a symbol ID
+    SNAPSHOT_BEGIN = 6, // Snapshot channel: a new cycle over every book
+    SNAPSHOT_BOOK = 7,  // Snapshot channel: one book; its levels follow as SNAPSHOT_LEVEL messages
+    SNAPSHOT_LEVEL = 8
+};
+
+// Side byte of level and trade messages
+const std::uint8_t MARKET_DATA_SIDE_BID = 'B';
+const std::uint8_t MARKET_DATA_SIDE_ASK = 'S';
+
+struct MarketDataPacket {
+    std::uint64_t sequence;     // Incremental: feed sequence of the first message. Snapshot: packet number.
+    std::uint16_t messageCount;
+    std::uint16_t length;       // Of the whole datagram
+    MarketDataChannel channel;
+    std::uint8_t version;
+    std::uint8_t reserved[2];
+};
+
+struct MarketDataHeader {
+    std::uint16_t length; // Of the whole message; must match the size of its type
+    MarketDataMessageType type;
+    std::uint8_t reserved;
+};
+
+// ADD_LEVEL, MODIFY_LEVEL, DELETE_LEVEL and SNAPSHOT_LEVEL
+struct MarketDataLevel {
+    MarketDataHeader header;
+    SymbolId symbolId;
+    Price price;
+    std::int32_t quantity;   // Total resting at the price
+    std::int32_t orderCount;
+    std::uint8_t side;       // BID or ASK
+    std::uint8_t reserved[7];
+};
+
+struct MarketDataTrade {
+    MarketDataHeader header;
+    SymbolId symbolId;
+    Price price;
+    std::int32_t quantity;
+    std::uint8_t aggressorSide; // BID if the incoming order bought
+    std::uint8_t reserved[3];
+    std::uint64_t tradeId;      // Engine sequence of the fill, as in the gateway's FILL
+};
+
+struct MarketDataSymbol {
+    MarketDataHeader header;
+    SymbolId symbolId;
+    double tickSize;
+    char symbol[MARKET_DATA_SYMBOL_LENGTH]; // NUL-padded; cut if longer
+};
+
+struct MarketDataSnapshotBegin {
+    MarketDataHeader header;
+    std::uint32_t bookCount;
+    std::uint64_t sequence; // Feed sequence when the cycle started; no book reflects less
+};
+
+struct MarketDataSnapshotBook {
+    MarketDataHeader header;
+    SymbolId symbolId;
+    std::uint64_t lastSequence; // Every incremental up to this one is reflected in the levels
+    std::uint32_t bidCount;     // Levels that follow, best first: bids, then asks
+    std::uint32_t askCount;
+};
+
+static_assert(sizeof(MarketDataPacket) == 16, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataHeader) == 4, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataLevel) == 32, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataTrade) == 32, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataSymbol) == 32, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataSnapshotBegin) == 16, "Market data layout is part of the protocol");
+static_assert(sizeof(MarketDataSnapshotBook) == 24, "Market data layout is part of the protocol");
+static_assert(std::is_trivially_copyable<MarketDataLevel>::value && std::is_trivially_copyable<MarketDataTrade>::value,
+              "Market data messages are sent as raw bytes");
+
+// Size of a message of the given type; 0 for a type the protocol does not have
+inline std::size_t marketDataMessageSize(MarketDataMessageType type) {
+    switch (type) {
+        case MarketDataMessageType::ADD_LEVEL:
+        case MarketDataMessageType::MODIFY_LEVEL:
+        case MarketDataMessageType::DELETE_LEVEL:
+        case MarketDataMessageType::SNAPSHOT_LEVEL: return sizeof(MarketDataLevel);
+        case MarketDataMessageType::TRADE: return sizeof(MarketDataTrade);
+        case MarketDataMessageType::SYMBOL: return sizeof(MarketDataSymbol);
+        case MarketDataMessageType::SNAPSHOT_BEGIN: return sizeof(MarketDataSnapshotBegin);
+        case MarketDataMessageType::SNAPSHOT_BOOK: return sizeof(MarketDataSnapshotBook);
+        default: return 0;
+    }
+}
+
+#endif // MARKET_DATA_PROTOCOL_H
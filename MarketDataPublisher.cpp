@@ -0,0 +1,410 @@
+#include "MarketDataPublisher.h"
+#include "MatchingEngine.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Datagrams handed to one sendmmsg call
+const std::size_t SEND_BATCH = 64;
+// Largest UDP payload over IPv4
+const std::size_t MAX_UDP_PAYLOAD = 65507;
+
+std::uint8_t marketDataSide(OrderType side) {
+    return side == BUY ? MARKET_DATA_SIDE_BID : MARKET_DATA_SIDE_ASK;
+}
+
+MarketDataHeader marketDataHeader(MarketDataMessageType type) {
+    MarketDataHeader header{};
+    header.length = static_cast<std::uint16_t>(marketDataMessageSize(type));
+    header.type = type;
+    return header;
+}
+
+void startPacket(char* datagram, MarketDataChannel channel, std::uint64_t sequence) {
+    MarketDataPacket* packet = reinterpret_cast<MarketDataPacket*>(datagram);
+    std::memset(packet, 0, sizeof(MarketDataPacket));
+    packet->sequence = sequence;
+    packet->length = sizeof(MarketDataPacket);
+    packet->channel = channel;
+    packet->version = MARKET_DATA_VERSION;
+}
+
+void appendToPacket(char* datagram, const void* message, std::size_t length) {
+    MarketDataPacket* packet = reinterpret_cast<MarketDataPacket*>(datagram);
+    std::memcpy(datagram + packet->length, message, length);
+    packet->length = static_cast<std::uint16_t>(packet->length + length);
+    packet->messageCount++;
+}
+
+} // namespace
+
+MarketDataPublisher::MarketDataPublisher(const MarketDataOptions& marketDataOptions) : options(marketDataOptions) {
+    // Whole 8-byte units keep every message in the buffer aligned; the largest message must fit
+    options.maxDatagramBytes = std::min(options.maxDatagramBytes, MAX_UDP_PAYLOAD) & ~std::size_t(7);
+    options.maxDatagramBytes = std::max(options.maxDatagramBytes, sizeof(MarketDataPacket) + sizeof(MarketDataSymbol));
+    datagrams.resize(options.maxDatagramBytes * SEND_BATCH);
+}
+
+MarketDataPublisher::~MarketDataPublisher() {
+    detach();
+    stopSnapshots();
+#ifdef __linux__
+    if (incrementalFd >= 0) {
+        ::close(incrementalFd);
+    }
+    if (snapshotFd >= 0) {
+        ::close(snapshotFd);
+    }
+#endif
+}
+
+void MarketDataPublisher::attach(MatchingEngine& matchingEngine) {
+    detach();
+    engine = &matchingEngine;
+    const SymbolDirectory& symbols = engine->getSymbols();
+    BookDepth depth;
+    for (SymbolId symbolId = 0; symbolId < symbols.size(); ++symbolId) {
+        if (!engine->getDepth(symbols.getName(symbolId), std::numeric_limits<std::size_t>::max(), depth)) {
+            continue; // No book yet; its first change defines it
+        }
+        defineSymbol(symbols.getInstrument(symbolId));
+        for (int side = BUY; side <= SELL; ++side) {
+            for (const DepthLevel& level : side == BUY ? depth.bids : depth.asks) {
+                MarketDataLevel message{};
+                message.header = marketDataHeader(MarketDataMessageType::ADD_LEVEL);
+                message.symbolId = symbolId;
+                message.price = level.price;
+                message.quantity = level.totalQuantity;
+                message.orderCount = level.orderCount;
+                message.side = marketDataSide(static_cast<OrderType>(side));
+                append(&message, sizeof(message));
+            }
+        }
+    }
+    engine->setMarketDataListener(this);
+}
+
+void MarketDataPublisher::detach() {
+    if (engine != nullptr) {
+        engine->setMarketDataListener(nullptr);
+        engine = nullptr;
+    }
+}
+
+void MarketDataPublisher::onLevelChanged(const OrderBook& book, OrderType side, const PriceLevel& level, LevelChange change) {
+    const Instrument& instrument = book.getInstrument();
+    if (instrument.id >= symbolsSent.size() || !symbolsSent[instrument.id]) {
+        defineSymbol(instrument);
+    }
+    MarketDataLevel message{};
+    message.header = marketDataHeader(change == LevelChange::ADDED ? MarketDataMessageType::ADD_LEVEL
+                                      : change == LevelChange::MODIFIED ? MarketDataMessageType::MODIFY_LEVEL
+                                                                        : MarketDataMessageType::DELETE_LEVEL);
+    message.symbolId = instrument.id;
+    message.price = level.price;
+    if (change != LevelChange::DELETED) {
+        message.quantity = level.totalQuantity;
+        message.orderCount = level.orderCount;
+    }
+    message.side = marketDataSide(side);
+    append(&message, sizeof(message));
+}
+
+void MarketDataPublisher::onTrade(const OrderBook& book, const Fill& fill) {
+    const Instrument& instrument = book.getInstrument();
+    if (instrument.id >= symbolsSent.size() || !symbolsSent[instrument.id]) {
+        defineSymbol(instrument);
+    }
+    MarketDataTrade message{};
+    message.header = marketDataHeader(MarketDataMessageType::TRADE);
+    message.symbolId = instrument.id;
+    message.price = fill.price;
+    message.quantity = fill.quantity;
+    message.aggressorSide = marketDataSide(fill.aggressorSide);
+    message.tradeId = fill.sequence;
+    append(&message, sizeof(message));
+}
+
+void MarketDataPublisher::defineSymbol(const Instrument& instrument) {
+    if (instrument.id >= symbolsSent.size()) {
+        symbolsSent.resize(instrument.id + 1, false);
+    }
+    symbolsSent[instrument.id] = true;
+    MarketDataSymbol message{};
+    message.header = marketDataHeader(MarketDataMessageType::SYMBOL);
+    message.symbolId = instrument.id;
+    message.tickSize = instrument.tickSize;
+    std::memcpy(message.symbol, instrument.symbol.data(), std::min(instrument.symbol.size(), MARKET_DATA_SYMBOL_LENGTH));
+    append(&message, sizeof(message));
+}
+
+void MarketDataPublisher::append(const void* message, std::size_t length) {
+    if (datagramCount == 0 || currentLength + length > options.maxDatagramBytes) {
+        if ((datagramCount + 1) * options.maxDatagramBytes > datagrams.size()) {
+            datagrams.resize(datagrams.size() * 2); // A burst larger than any before; kept for the next one
+        }
+        startPacket(datagrams.data() + datagramCount * options.maxDatagramBytes, MarketDataChannel::INCREMENTAL, nextSequence);
+        datagramCount++;
+        currentLength = sizeof(MarketDataPacket);
+    }
+    appendToPacket(datagrams.data() + (datagramCount - 1) * options.maxDatagramBytes, message, length);
+    currentLength += length;
+    nextSequence++;
+}
+
+void MarketDataPublisher::applyToImages() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (std::size_t i = 0; i < datagramCount; ++i) {
+        const char* datagram = datagrams.data() + i * options.maxDatagramBytes;
+        const MarketDataPacket* packet = reinterpret_cast<const MarketDataPacket*>(datagram);
+        const char* message = datagram + sizeof(MarketDataPacket);
+        for (std::uint16_t m = 0; m < packet->messageCount; ++m) {
+            const MarketDataHeader* header = reinterpret_cast<const MarketDataHeader*>(message);
+            if (header->type == MarketDataMessageType::SYMBOL) {
+                const MarketDataSymbol* symbol = reinterpret_cast<const MarketDataSymbol*>(message);
+                if (symbol->symbolId >= books.size()) {
+                    books.resize(symbol->symbolId + 1);
+                }
+                BookImage& image = books[symbol->symbolId];
+                image.defined = true;
+                image.symbol.assign(symbol->symbol, strnlen(symbol->symbol, MARKET_DATA_SYMBOL_LENGTH));
+                image.tickSize = symbol->tickSize;
+            } else if (header->type != MarketDataMessageType::TRADE) {
+                const MarketDataLevel* level = reinterpret_cast<const MarketDataLevel*>(message);
+                BookImage& image = books[level->symbolId]; // Defined by an earlier SYMBOL
+                auto& levels = level->side == MARKET_DATA_SIDE_BID ? image.bids : image.asks;
+                if (header->type == MarketDataMessageType::DELETE_LEVEL) {
+                    levels.erase(level->price);
+                } else {
+                    MarketDataLevel& entry = levels[level->price];
+                    entry = *level;
+                    entry.header = marketDataHeader(MarketDataMessageType::SNAPSHOT_LEVEL);
+                }
+            }
+            stats.messages++;
+            message += header->length;
+        }
+    }
+    publishedSequence = nextSequence - 1;
+}
+
+MarketDataStats MarketDataPublisher::getStats() const {
+    MarketDataStats current = stats;
+    std::lock_guard<std::mutex> lock(mtx);
+    current.snapshotCycles = snapshotCycles;
+    current.snapshotDatagrams = snapshotDatagrams;
+    return current;
+}
+
+void MarketDataPublisher::runSnapshots() {
+    std::vector<char> packet(options.maxDatagramBytes);
+    std::uint64_t packetNumber = 1;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopping) {
+        lock.unlock();
+        sendSnapshotCycle(packet, packetNumber);
+        lock.lock();
+        wake.wait_for(lock, std::chrono::milliseconds(options.snapshotIntervalMillis), [this] { return stopping; });
+    }
+}
+
+void MarketDataPublisher::stopSnapshots() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (snapshotThread.joinable()) {
+        snapshotThread.join();
+    }
+}
+
+#ifdef __linux__
+
+namespace {
+
+// A UDP socket whose datagrams go to group:port out of the given interface
+int openChannel(const MarketDataOptions& options, std::uint16_t port, std::string& error) {
+    in_addr interfaceAddress{};
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    if (::inet_pton(AF_INET, options.interfaceAddress.c_str(), &interfaceAddress) != 1 ||
+        ::inet_pton(AF_INET, options.group.c_str(), &group.sin_addr) != 1) {
+        error = "Error: Invalid market data address " + options.group + " on " + options.interfaceAddress;
+        return -1;
+    }
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("Error: Unable to create a market data socket: ") + std::strerror(errno);
+        return -1;
+    }
+    unsigned char ttl = static_cast<unsigned char>(options.ttl);
+    unsigned char loop = 1; // Receivers on this host, the loopback tests included, see the feed
+    // Connected, so sendmmsg needs no address per datagram
+    if (::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interfaceAddress, sizeof(interfaceAddress)) != 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) != 0 ||
+        ::connect(fd, reinterpret_cast<sockaddr*>(&group), sizeof(group)) != 0) {
+        error = "Error: Unable to publish to " + options.group + ":" + std::to_string(port) + ": " + std::strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+bool MarketDataPublisher::start() {
+    incrementalFd = openChannel(options, options.incrementalPort, error);
+    if (incrementalFd < 0) {
+        return false;
+    }
+    snapshotFd = openChannel(options, options.snapshotPort, error);
+    if (snapshotFd < 0) {
+        return false;
+    }
+    snapshotThread = std::thread(&MarketDataPublisher::runSnapshots, this);
+    return true;
+}
+
+std::size_t MarketDataPublisher::flush() {
+    if (datagramCount == 0) {
+        return 0;
+    }
+    // Images first: a snapshot may then reflect datagrams still on their way, never miss one
+    applyToImages();
+
+    mmsghdr headers[SEND_BATCH];
+    iovec vectors[SEND_BATCH];
+    std::size_t sent = 0;
+    while (sent < datagramCount && incrementalFd >= 0) {
+        std::size_t batch = std::min(SEND_BATCH, datagramCount - sent);
+        for (std::size_t i = 0; i < batch; ++i) {
+            char* datagram = datagrams.data() + (sent + i) * options.maxDatagramBytes;
+            vectors[i].iov_base = datagram;
+            vectors[i].iov_len = reinterpret_cast<const MarketDataPacket*>(datagram)->length;
+            std::memset(&headers[i], 0, sizeof(mmsghdr));
+            headers[i].msg_hdr.msg_iov = &vectors[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+        int result = ::sendmmsg(incrementalFd, headers, static_cast<unsigned>(batch), 0);
+        stats.sendCalls++;
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            // Receivers see the gap and recover from the snapshot channel
+            error = std::string("Error: Market data send failed: ") + std::strerror(errno);
+            stats.sendErrors++;
+            result = 1;
+        }
+        sent += static_cast<std::size_t>(result);
+    }
+    stats.datagrams += datagramCount;
+    std::size_t flushed = datagramCount;
+    datagramCount = 0;
+    currentLength = 0;
+    return flushed;
+}
+
+void MarketDataPublisher::sendSnapshotCycle(std::vector<char>& packet, std::uint64_t& packetNumber) {
+    std::uint64_t datagramsSent = 0;
+    auto send = [&]() {
+        if (::send(snapshotFd, packet.data(), reinterpret_cast<const MarketDataPacket*>(packet.data())->length, 0) >= 0) {
+            datagramsSent++;
+        }
+        startPacket(packet.data(), MarketDataChannel::SNAPSHOT, ++packetNumber);
+    };
+    auto add = [&](const void* message, std::size_t length) {
+        if (reinterpret_cast<const MarketDataPacket*>(packet.data())->length + length > packet.size()) {
+            send();
+        }
+        appendToPacket(packet.data(), message, length);
+    };
+    startPacket(packet.data(), MarketDataChannel::SNAPSHOT, packetNumber);
+
+    // Books defined after the cycle starts wait for the next one; their SYMBOL is on the incremental channel
+    MarketDataSnapshotBegin begin{};
+    begin.header = marketDataHeader(MarketDataMessageType::SNAPSHOT_BEGIN);
+    std::vector<SymbolId> symbolIds;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (SymbolId symbolId = 0; symbolId < books.size(); ++symbolId) {
+            if (books[symbolId].defined) {
+                symbolIds.push_back(symbolId);
+            }
+        }
+        begin.sequence = publishedSequence;
+    }
+    begin.bookCount = static_cast<std::uint32_t>(symbolIds.size());
+    add(&begin, sizeof(begin));
+
+    // One book at a time is copied under the lock, so the matching thread never waits for a send
+    std::vector<char> book;
+    for (SymbolId symbolId : symbolIds) {
+        book.clear();
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            const BookImage& image = books[symbolId];
+            MarketDataSymbol symbol{};
+            symbol.header = marketDataHeader(MarketDataMessageType::SYMBOL);
+            symbol.symbolId = symbolId;
+            symbol.tickSize = image.tickSize;
+            std::memcpy(symbol.symbol, image.symbol.data(), std::min(image.symbol.size(), MARKET_DATA_SYMBOL_LENGTH));
+            MarketDataSnapshotBook header{};
+            header.header = marketDataHeader(MarketDataMessageType::SNAPSHOT_BOOK);
+            header.symbolId = symbolId;
+            header.lastSequence = publishedSequence;
+            header.bidCount = static_cast<std::uint32_t>(image.bids.size());
+            header.askCount = static_cast<std::uint32_t>(image.asks.size());
+            book.reserve(sizeof(symbol) + sizeof(header) + (image.bids.size() + image.asks.size()) * sizeof(MarketDataLevel));
+            book.insert(book.end(), reinterpret_cast<const char*>(&symbol), reinterpret_cast<const char*>(&symbol + 1));
+            book.insert(book.end(), reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+            for (auto it = image.bids.rbegin(); it != image.bids.rend(); ++it) {
+                book.insert(book.end(), reinterpret_cast<const char*>(&it->second), reinterpret_cast<const char*>(&it->second + 1));
+            }
+            for (const auto& [price, level] : image.asks) {
+                book.insert(book.end(), reinterpret_cast<const char*>(&level), reinterpret_cast<const char*>(&level + 1));
+            }
+        }
+        for (std::size_t offset = 0; offset < book.size();) {
+            std::size_t length = reinterpret_cast<const MarketDataHeader*>(book.data() + offset)->length;
+            add(book.data() + offset, length);
+            offset += length;
+        }
+    }
+    send();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    snapshotCycles++;
+    snapshotDatagrams += datagramsSent;
+}
+
+#else
+
+bool MarketDataPublisher::start() {
+    error = "Error: The market data publisher is only available on Linux";
+    return false;
+}
+
+std::size_t MarketDataPublisher::flush() {
+    applyToImages();
+    datagramCount = 0;
+    currentLength = 0;
+    return 0;
+}
+
+void MarketDataPublisher::sendSnapshotCycle(std::vector<char>&, std::uint64_t&) {}
+
+#endif // __linux__
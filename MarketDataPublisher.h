@@ -0,0 +1,119 @@
+#ifndef MARKET_DATA_PUBLISHER_H
+#define MARKET_DATA_PUBLISHER_H
+
+#include "MarketDataProtocol.h"
+#include "OrderBook.h"
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MatchingEngine;
+
+// Where the feed goes; MarketDataReceiver takes the same options
+struct MarketDataOptions {
+    std::string group = "239.255.42.1";         // Multicast group of both channels
+    std::uint16_t incrementalPort = 31001;
+    std::uint16_t snapshotPort = 31002;
+    std::string interfaceAddress = "127.0.0.1"; // Sent and joined on this interface; loopback keeps the feed on this host
+    int ttl = 1;                                // Routers a datagram may cross
+
+    // Publisher
+    std::size_t maxDatagramBytes = 1400;        // Below a typical Ethernet MTU, so datagrams are never fragmented
+    int snapshotIntervalMillis = 250;           // Pause between two snapshot cycles
+
+    // Receiver
+    int receiveBufferBytes = 4 * 1024 * 1024;   // Socket buffer per channel; absorbs bursts while the reader is busy
+    unsigned dropOneIn = 0;                     // Testing: discards one incremental datagram in this many, forcing recoveries
+};
+
+// Counters of the incremental channel (matching thread) and of the snapshot thread
+struct MarketDataStats {
+    std::uint64_t messages = 0;        // Incremental messages sent
+    std::uint64_t datagrams = 0;
+    std::uint64_t sendCalls = 0;       // sendmmsg system calls
+    std::uint64_t sendErrors = 0;      // Datagrams the kernel refused; receivers recover them from snapshots
+    std::uint64_t snapshotCycles = 0;
+    std::uint64_t snapshotDatagrams = 0;
+};
+
+// Publishes an engine's book changes and trades on UDP multicast (Linux only). As a MarketDataListener
+// it turns every change into an incremental message numbered by the feed sequence and packs them into
+// datagrams; flush() sends what is queued with one system call. It also keeps its own copy of every
+// book's depth, which a background thread sends on the snapshot channel every snapshotIntervalMillis.
+//
+// Everything but the snapshot thread runs on the engine's matching thread: attach(), the listener
+// calls and flush(). Call flush() after each batch of requests (OrderGateway does, once per wakeup,
+// after its journal commit); changes are not sent before it.
+class MarketDataPublisher : public MarketDataListener {
+public:
+    explicit MarketDataPublisher(const MarketDataOptions& options = MarketDataOptions());
+    ~MarketDataPublisher() override; // Detaches from the engine and stops the snapshot thread
+
+    MarketDataPublisher(const MarketDataPublisher&) = delete;
+    MarketDataPublisher& operator=(const MarketDataPublisher&) = delete;
+
+    // Opens both channels and starts the snapshot thread; false (see getError) if a socket cannot be set up
+    bool start();
+    // Publishes the engine's current books as ADD_LEVEL messages, then follows its changes
+    void attach(MatchingEngine& engine);
+    void detach();
+
+    // Sends every datagram queued since the last call; returns how many went out
+    std::size_t flush();
+
+    void onLevelChanged(const OrderBook& book, OrderType side, const PriceLevel& level, LevelChange change) override;
+    void onTrade(const OrderBook& book, const Fill& fill) override;
+
+    // Matching thread: the feed sequence the next incremental message gets, and the counters
+    std::uint64_t getNextSequence() const { return nextSequence; }
+    std::uint64_t getSendCalls() const { return stats.sendCalls; }
+    MarketDataStats getStats() const;
+    const std::string& getError() const { return error; }
+
+private:
+    // Depth as the feed has published it; the snapshot thread sends this, never the engine's books
+    struct BookImage {
+        bool defined = false;
+        std::string symbol;
+        double tickSize = 0;
+        std::map<Price, MarketDataLevel> bids; // Ascending; best bid is the last
+        std::map<Price, MarketDataLevel> asks;
+    };
+
+    MarketDataOptions options;
+    MatchingEngine* engine = nullptr;
+    int incrementalFd = -1;
+    int snapshotFd = -1;
+    std::string error;
+
+    // Matching thread: datagrams being filled, maxDatagramBytes apart in one buffer
+    std::vector<char> datagrams;
+    std::size_t datagramCount = 0;  // Including the one being filled
+    std::size_t currentLength = 0;  // Of the one being filled
+    std::uint64_t nextSequence = 1;
+    std::vector<bool> symbolsSent;  // By SymbolId: SYMBOL message already sent
+    MarketDataStats stats;
+
+    // Shared with the snapshot thread
+    mutable std::mutex mtx;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::vector<BookImage> books;        // By SymbolId
+    std::uint64_t publishedSequence = 0; // Last incremental the images reflect
+    std::uint64_t snapshotCycles = 0;
+    std::uint64_t snapshotDatagrams = 0;
+    std::thread snapshotThread;
+
+    void append(const void* message, std::size_t length);
+    void defineSymbol(const Instrument& instrument);
+    void applyToImages(); // Brings the images up to the messages about to be sent
+    void runSnapshots();
+    void sendSnapshotCycle(std::vector<char>& packet, std::uint64_t& packetNumber);
+    void stopSnapshots();
+};
+
+#endif // MARKET_DATA_PUBLISHER_H
@@ -0,0 +1,397 @@
+#include "MarketDataReceiver.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Datagrams read by one recvmmsg call, each into a slot that fits the largest UDP payload
+const std::size_t RECEIVE_BATCH = 16;
+const std::size_t RECEIVE_SLOT_BYTES = 64 * 1024;
+
+} // namespace
+
+MarketDataReceiver::MarketDataReceiver(const MarketDataOptions& marketDataOptions, MarketDataHandler* marketDataHandler)
+    : options(marketDataOptions), handler(marketDataHandler) {}
+
+MarketDataReceiver::~MarketDataReceiver() {
+#ifdef __linux__
+    if (incrementalFd >= 0) {
+        ::close(incrementalFd);
+    }
+    if (snapshotFd >= 0) {
+        ::close(snapshotFd);
+    }
+#endif
+}
+
+void MarketDataReceiver::process(const char* data, std::size_t length) {
+    if (length < sizeof(MarketDataPacket)) {
+        return;
+    }
+    const MarketDataPacket* packet = reinterpret_cast<const MarketDataPacket*>(data);
+    if (packet->version != MARKET_DATA_VERSION || packet->length != length) {
+        return;
+    }
+    // Every message must be whole and of its type's size before any of them is applied
+    const char* messages = data + sizeof(MarketDataPacket);
+    const char* end = data + length;
+    const char* message = messages;
+    for (std::uint16_t i = 0; i < packet->messageCount; ++i) {
+        if (end - message < static_cast<std::ptrdiff_t>(sizeof(MarketDataHeader))) {
+            return;
+        }
+        const MarketDataHeader* header = reinterpret_cast<const MarketDataHeader*>(message);
+        if (header->length == 0 || header->length != marketDataMessageSize(header->type) || end - message < header->length) {
+            return;
+        }
+        message += header->length;
+    }
+    if (message != end) {
+        return;
+    }
+
+    if (packet->channel == MarketDataChannel::INCREMENTAL) {
+        handleIncremental(*packet, data, length);
+    } else if (packet->channel == MarketDataChannel::SNAPSHOT) {
+        handleSnapshot(*packet, messages, end);
+    }
+}
+
+void MarketDataReceiver::handleIncremental(const MarketDataPacket& packet, const char* data, std::size_t length) {
+    stats.datagrams++;
+    if (options.dropOneIn > 0 && ++incrementalCount % options.dropOneIn == 0) {
+        stats.dropped++;
+        return;
+    }
+    const std::uint64_t end = packet.sequence + packet.messageCount;
+    if (synced) {
+        if (end <= nextSequence) {
+            return; // Already applied
+        }
+        if (packet.sequence <= nextSequence) {
+            apply(data, nextSequence);
+            nextSequence = end;
+            return;
+        }
+        stats.gaps++;
+        synced = false;
+        buffered.clear();
+    }
+
+    if (!buffered.empty() && packet.sequence != bufferedEnd) {
+        if (end <= bufferedEnd) {
+            return;
+        }
+        buffered.clear(); // A hole: nothing before it can be replayed
+    }
+    if (buffered.empty()) {
+        bufferedFirst = packet.sequence;
+    }
+    buffered.emplace_back(data, data + length);
+    bufferedEnd = end;
+    tryRecover();
+}
+
+void MarketDataReceiver::handleSnapshot(const MarketDataPacket& packet, const char* messages, const char* end) {
+    stats.snapshotDatagrams++;
+    if (synced) {
+        return;
+    }
+    if (cycleActive && packet.sequence != nextSnapshotPacket) {
+        cycleActive = false; // A datagram of this cycle was lost; wait for the next one
+    }
+    nextSnapshotPacket = packet.sequence + 1;
+
+    for (const char* message = messages; message < end; message += reinterpret_cast<const MarketDataHeader*>(message)->length) {
+        MarketDataMessageType type = reinterpret_cast<const MarketDataHeader*>(message)->type;
+        if (type == MarketDataMessageType::SNAPSHOT_BEGIN) {
+            const MarketDataSnapshotBegin* begin = reinterpret_cast<const MarketDataSnapshotBegin*>(message);
+            staged.clear();
+            cycleSequence = begin->sequence;
+            cycleBooks = begin->bookCount;
+            completeBooks = 0;
+            cycleActive = true;
+            cycleComplete = false;
+        } else if (!cycleActive) {
+            continue;
+        } else if (type == MarketDataMessageType::SYMBOL) {
+            stagedSymbol = *reinterpret_cast<const MarketDataSymbol*>(message);
+        } else if (type == MarketDataMessageType::SNAPSHOT_BOOK) {
+            const MarketDataSnapshotBook* header = reinterpret_cast<const MarketDataSnapshotBook*>(message);
+            StagedBook& entry = staged.emplace_back();
+            entry.book.symbolId = header->symbolId;
+            if (stagedSymbol.symbolId == header->symbolId) {
+                entry.book.symbol.assign(stagedSymbol.symbol, strnlen(stagedSymbol.symbol, MARKET_DATA_SYMBOL_LENGTH));
+                entry.book.tickSize = stagedSymbol.tickSize;
+            }
+            entry.lastSequence = header->lastSequence;
+            entry.levelsLeft = header->bidCount + header->askCount;
+            if (entry.levelsLeft == 0) {
+                completeBooks++;
+            }
+        } else if (type == MarketDataMessageType::SNAPSHOT_LEVEL && !staged.empty() && staged.back().levelsLeft > 0) {
+            const MarketDataLevel* level = reinterpret_cast<const MarketDataLevel*>(message);
+            StagedBook& entry = staged.back();
+            auto& levels = level->side == MARKET_DATA_SIDE_BID ? entry.book.bids : entry.book.asks;
+            levels[level->price] = DepthLevel{level->price, level->quantity, level->orderCount};
+            if (--entry.levelsLeft == 0) {
+                completeBooks++;
+            }
+        }
+        if (cycleActive && completeBooks == cycleBooks) {
+            cycleActive = false;
+            cycleComplete = true;
+        }
+    }
+    tryRecover();
+}
+
+void MarketDataReceiver::tryRecover() {
+    if (!cycleComplete) {
+        return;
+    }
+    std::uint64_t highest = cycleSequence;
+    for (const StagedBook& entry : staged) {
+        highest = std::max(highest, entry.lastSequence);
+    }
+    // Every incremental after the cycle's start is needed, up to the newest book's at least: books
+    // defined since the cycle started are not in it, and only the incrementals carry their name and
+    // first levels. Each staged book skips what it already reflects.
+    if (buffered.empty() ? highest != cycleSequence : bufferedEnd <= highest) {
+        return; // Still on their way
+    }
+    if (!buffered.empty() && bufferedFirst > cycleSequence + 1) {
+        cycleComplete = false; // The buffer starts after this cycle; the next one will do
+        return;
+    }
+
+    books.clear();
+    reflected.clear();
+    for (StagedBook& entry : staged) {
+        SymbolId symbolId = entry.book.symbolId;
+        if (symbolId >= books.size()) {
+            books.resize(symbolId + 1);
+            reflected.resize(symbolId + 1, 0);
+        }
+        books[symbolId] = std::make_unique<MarketDataBook>(std::move(entry.book));
+        reflected[symbolId] = entry.lastSequence;
+        if (handler != nullptr) {
+            handler->onBookReset(*books[symbolId]);
+        }
+    }
+    for (const std::vector<char>& datagram : buffered) {
+        apply(datagram.data(), 0);
+    }
+    nextSequence = buffered.empty() ? highest + 1 : bufferedEnd;
+    reflected.clear();
+    buffered.clear();
+    staged.clear();
+    cycleComplete = false;
+    synced = true;
+    stats.recoveries++;
+}
+
+void MarketDataReceiver::apply(const char* data, std::uint64_t from) {
+    const MarketDataPacket* packet = reinterpret_cast<const MarketDataPacket*>(data);
+    const char* message = data + sizeof(MarketDataPacket);
+    std::uint64_t sequence = packet->sequence;
+    for (std::uint16_t i = 0; i < packet->messageCount; ++i, ++sequence, message += reinterpret_cast<const MarketDataHeader*>(message)->length) {
+        if (sequence < from) {
+            continue;
+        }
+        MarketDataMessageType type = reinterpret_cast<const MarketDataHeader*>(message)->type;
+        if (type == MarketDataMessageType::SYMBOL) {
+            const MarketDataSymbol* symbol = reinterpret_cast<const MarketDataSymbol*>(message);
+            MarketDataBook& target = book(symbol->symbolId);
+            target.symbol.assign(symbol->symbol, strnlen(symbol->symbol, MARKET_DATA_SYMBOL_LENGTH));
+            target.tickSize = symbol->tickSize;
+            continue;
+        }
+        // Level and trade messages both start with the symbol ID
+        SymbolId symbolId = reinterpret_cast<const MarketDataLevel*>(message)->symbolId;
+        if (symbolId < reflected.size() && sequence <= reflected[symbolId]) {
+            continue; // The snapshot already has it
+        }
+        MarketDataBook& target = book(symbolId);
+        stats.messages++;
+        if (type == MarketDataMessageType::TRADE) {
+            if (handler != nullptr) {
+                handler->onTrade(target, *reinterpret_cast<const MarketDataTrade*>(message));
+            }
+            continue;
+        }
+        const MarketDataLevel* level = reinterpret_cast<const MarketDataLevel*>(message);
+        auto& levels = level->side == MARKET_DATA_SIDE_BID ? target.bids : target.asks;
+        if (type == MarketDataMessageType::DELETE_LEVEL) {
+            levels.erase(level->price);
+        } else {
+            levels[level->price] = DepthLevel{level->price, level->quantity, level->orderCount};
+        }
+        if (handler != nullptr) {
+            handler->onLevel(target, *level);
+        }
+    }
+}
+
+MarketDataBook& MarketDataReceiver::book(SymbolId symbolId) {
+    if (symbolId >= books.size()) {
+        books.resize(symbolId + 1);
+    }
+    if (!books[symbolId]) {
+        books[symbolId] = std::make_unique<MarketDataBook>();
+        books[symbolId]->symbolId = symbolId;
+    }
+    return *books[symbolId];
+}
+
+const MarketDataBook* MarketDataReceiver::findBook(SymbolId symbolId) const {
+    return symbolId < books.size() ? books[symbolId].get() : nullptr;
+}
+
+const MarketDataBook* MarketDataReceiver::findBook(const std::string& symbol) const {
+    for (const auto& entry : books) {
+        if (entry && entry->symbol == symbol) {
+            return entry.get();
+        }
+    }
+    return nullptr;
+}
+
+bool MarketDataReceiver::getDepth(SymbolId symbolId, std::size_t maxLevels, BookDepth& depth) const {
+    depth.symbolId = symbolId;
+    depth.sequence = nextSequence > 0 ? nextSequence - 1 : 0;
+    depth.bids.clear();
+    depth.asks.clear();
+    const MarketDataBook* entry = findBook(symbolId);
+    if (entry == nullptr) {
+        return false;
+    }
+    for (auto it = entry->bids.rbegin(); it != entry->bids.rend() && depth.bids.size() < maxLevels; ++it) {
+        depth.bids.push_back(it->second);
+    }
+    for (auto it = entry->asks.begin(); it != entry->asks.end() && depth.asks.size() < maxLevels; ++it) {
+        depth.asks.push_back(it->second);
+    }
+    return true;
+}
+
+#ifdef __linux__
+
+namespace {
+
+// A UDP socket that receives group:port, joined on the given interface
+int joinChannel(const MarketDataOptions& options, std::uint16_t port, std::string& error) {
+    ip_mreq membership{};
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    if (::inet_pton(AF_INET, options.group.c_str(), &group.sin_addr) != 1 ||
+        ::inet_pton(AF_INET, options.interfaceAddress.c_str(), &membership.imr_interface) != 1) {
+        error = "Error: Invalid market data address " + options.group + " on " + options.interfaceAddress;
+        return -1;
+    }
+    membership.imr_multiaddr = group.sin_addr;
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        error = std::string("Error: Unable to create a market data socket: ") + std::strerror(errno);
+        return -1;
+    }
+    int reuse = 1; // Every receiver on the host binds the same port and gets its own copy
+    int bufferBytes = options.receiveBufferBytes;
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes)) != 0 ||
+        ::bind(fd, reinterpret_cast<sockaddr*>(&group), sizeof(group)) != 0 ||
+        ::setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+        error = "Error: Unable to join " + options.group + ":" + std::to_string(port) + ": " + std::strerror(errno);
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+bool MarketDataReceiver::start() {
+    incrementalFd = joinChannel(options, options.incrementalPort, error);
+    if (incrementalFd < 0) {
+        return false;
+    }
+    snapshotFd = joinChannel(options, options.snapshotPort, error);
+    if (snapshotFd < 0) {
+        return false;
+    }
+    receiveBuffer.resize(RECEIVE_BATCH * RECEIVE_SLOT_BYTES);
+    return true;
+}
+
+bool MarketDataReceiver::poll(int timeoutMillis) {
+    pollfd fds[2] = {{incrementalFd, POLLIN, 0}, {snapshotFd, POLLIN, 0}};
+    int ready = ::poll(fds, 2, timeoutMillis);
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        error = std::string("Error: Market data poll failed: ") + std::strerror(errno);
+        return false;
+    }
+    // Incrementals first: recovery waits on them, and they are what an overflowing socket buffer loses
+    if ((fds[0].revents & POLLIN) && !receive(incrementalFd)) {
+        return false;
+    }
+    if ((fds[1].revents & POLLIN) && !receive(snapshotFd)) {
+        return false;
+    }
+    return true;
+}
+
+bool MarketDataReceiver::receive(int fd) {
+    mmsghdr headers[RECEIVE_BATCH];
+    iovec vectors[RECEIVE_BATCH];
+    for (std::size_t i = 0; i < RECEIVE_BATCH; ++i) {
+        vectors[i].iov_base = receiveBuffer.data() + i * RECEIVE_SLOT_BYTES;
+        vectors[i].iov_len = RECEIVE_SLOT_BYTES;
+        std::memset(&headers[i], 0, sizeof(mmsghdr));
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+    }
+    // One batch per call; poll() comes back for the rest, so neither channel starves the other
+    int count = ::recvmmsg(fd, headers, RECEIVE_BATCH, MSG_DONTWAIT, nullptr);
+    if (count < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return true;
+        }
+        error = std::string("Error: Market data receive failed: ") + std::strerror(errno);
+        return false;
+    }
+    for (int i = 0; i < count; ++i) {
+        if (!(headers[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            process(receiveBuffer.data() + i * RECEIVE_SLOT_BYTES, headers[i].msg_len);
+        }
+    }
+    return true;
+}
+
+#else
+
+bool MarketDataReceiver::start() {
+    error = "Error: The market data receiver is only available on Linux";
+    return false;
+}
+
+bool MarketDataReceiver::poll(int) {
+    return false;
+}
+
+bool MarketDataReceiver::receive(int) {
+    return false;
+}
+
+#endif // __linux__
@@ -0,0 +1,117 @@
+#ifndef MARKET_DATA_RECEIVER_H
+#define MARKET_DATA_RECEIVER_H
+
+#include "MarketDataPublisher.h"
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One book as rebuilt from the feed
+struct MarketDataBook {
+    SymbolId symbolId = 0;
+    std::string symbol;
+    double tickSize = 0;
+    std::map<Price, DepthLevel> bids; // Ascending; best bid is the last
+    std::map<Price, DepthLevel> asks;
+};
+
+// What a MarketDataReceiver applies, on the thread calling poll(). Nothing is reported while the
+// receiver is recovering; trades published during a gap are lost, as snapshots only carry depth.
+class MarketDataHandler {
+public:
+    virtual ~MarketDataHandler() = default;
+    // The book was replaced from a snapshot (on joining, or after a gap); updates continue from it
+    virtual void onBookReset(const MarketDataBook& book) = 0;
+    // ADD_LEVEL, MODIFY_LEVEL or DELETE_LEVEL, already applied to book
+    virtual void onLevel(const MarketDataBook& book, const MarketDataLevel& level) = 0;
+    virtual void onTrade(const MarketDataBook& book, const MarketDataTrade& trade) = 0;
+};
+
+struct MarketDataReceiverStats {
+    std::uint64_t datagrams = 0;         // Incremental datagrams read
+    std::uint64_t messages = 0;          // Incremental messages applied
+    std::uint64_t gaps = 0;              // Times an incremental datagram went missing
+    std::uint64_t recoveries = 0;        // Times the books were rebuilt from a snapshot cycle
+    std::uint64_t snapshotDatagrams = 0;
+    std::uint64_t dropped = 0;           // Discarded on purpose (MarketDataOptions::dropOneIn)
+};
+
+// Joins both channels of a MarketDataPublisher feed and rebuilds its books (Linux only). A receiver
+// starts out recovering: it buffers incrementals until a complete snapshot cycle arrives, installs
+// the books and applies the buffered messages each book does not reflect yet. From then on it applies
+// incrementals in sequence, and a missing datagram sends it back to recovering.
+class MarketDataReceiver {
+public:
+    explicit MarketDataReceiver(const MarketDataOptions& options = MarketDataOptions(), MarketDataHandler* handler = nullptr);
+    ~MarketDataReceiver();
+
+    MarketDataReceiver(const MarketDataReceiver&) = delete;
+    MarketDataReceiver& operator=(const MarketDataReceiver&) = delete;
+
+    // Joins the group on both ports; false (see getError) if a socket cannot be set up
+    bool start();
+    // Handles every datagram waiting on either channel, waiting up to timeoutMillis (-1: no limit) for
+    // the first; false (see getError) on a socket error
+    bool poll(int timeoutMillis);
+    // Handles one datagram read some other way (a capture, a test)
+    void process(const char* data, std::size_t length);
+
+    bool isSynced() const { return synced; }
+    // Feed sequence of the next incremental expected while in sync
+    std::uint64_t getNextSequence() const { return nextSequence; }
+    const MarketDataBook* findBook(SymbolId symbolId) const;
+    const MarketDataBook* findBook(const std::string& symbol) const;
+    // Top maxLevels per side, best first; false if the feed has no such book
+    bool getDepth(SymbolId symbolId, std::size_t maxLevels, BookDepth& depth) const;
+    const MarketDataReceiverStats& getStats() const { return stats; }
+    const std::string& getError() const { return error; }
+
+private:
+    struct StagedBook {
+        MarketDataBook book;
+        std::uint64_t lastSequence = 0;
+        std::uint32_t levelsLeft = 0;
+    };
+
+    MarketDataOptions options;
+    MarketDataHandler* handler;
+    int incrementalFd = -1;
+    int snapshotFd = -1;
+    std::vector<char> receiveBuffer;
+    std::string error;
+    MarketDataReceiverStats stats;
+
+    bool synced = false;
+    std::uint64_t nextSequence = 0;
+    std::vector<std::unique_ptr<MarketDataBook>> books; // By SymbolId
+
+    // Recovering: incrementals since the last gap, back to back with no hole
+    std::deque<std::vector<char>> buffered;
+    std::uint64_t bufferedFirst = 0;
+    std::uint64_t bufferedEnd = 0; // One past the last buffered sequence
+    std::uint64_t incrementalCount = 0;
+    std::vector<std::uint64_t> reflected; // While replaying the buffer: last sequence each installed book reflects
+
+    // Recovering: the snapshot cycle being collected, complete once every book and level arrived
+    std::vector<StagedBook> staged;
+    MarketDataSymbol stagedSymbol{};
+    std::uint64_t cycleSequence = 0;
+    std::uint32_t cycleBooks = 0;
+    std::uint32_t completeBooks = 0;
+    std::uint64_t nextSnapshotPacket = 0;
+    bool cycleActive = false;
+    bool cycleComplete = false;
+
+    bool receive(int fd);
+    void handleIncremental(const MarketDataPacket& packet, const char* data, std::size_t length);
+    void handleSnapshot(const MarketDataPacket& packet, const char* messages, const char* end);
+    void tryRecover();
+    // Applies the messages of an incremental datagram numbered from on, skipping what a book reflects
+    void apply(const char* data, std::uint64_t from);
+    MarketDataBook& book(SymbolId symbolId);
+};
+
+#endif // MARKET_DATA_RECEIVER_H
@@ -1,70 +1,261 @@
 
 #include "MatchingEngine.h"
+#include "EngineClock.h"
 #include <iostream>
 
-MatchingEngine::MatchingEngine(Logger& log, EmailNotifier& notifier)
-    : logger(log), emailNotifier(notifier) {}
+MatchingEngine::MatchingEngine(Logger& log, EmailNotifier& notifier, std::size_t orderCapacity)
+    : logger(log), emailNotifier(notifier), bookPools(orderCapacity), orderIndexNodes(orderCapacity),
+      orderIndex(orderCapacity, std::hash<std::string_view>(), std::equal_to<std::string_view>(),
+                 PoolAllocator<OrderIdMap<OrderLocation>::value_type>(orderIndexNodes)) {}
 
-OrderBook* MatchingEngine::getOrderBook(const std::string& symbol) {
-    if (orderBooks.find(symbol) == orderBooks.end()) {
-        logger.consoleLog("Creating new order book for symbol: " + symbol);
-        orderBooks[symbol] = std::make_unique<OrderBook>(symbol, logger, emailNotifier);
+OrderBook* MatchingEngine::getOrderBook(SymbolId symbolId) {
+    if (symbolId >= orderBooks.size()) {
+        orderBooks.resize(symbols.size());
     }
-    return orderBooks[symbol].get();
+    if (!orderBooks[symbolId]) {
+        logger.consoleLog("Creating new order book for symbol: " + symbols.getName(symbolId));
+        orderBooks[symbolId] = std::make_unique<OrderBook>(symbols.getInstrument(symbolId), logger, emailNotifier, static_cast<OrderBookListener*>(this), &bookPools, &sequencer);
+        orderBooks[symbolId]->setMarketDataListener(marketDataListener);
+    }
+    return orderBooks[symbolId].get();
 }
 
-std::vector<Trade> MatchingEngine::placeOrder(const Order& order) {
-    logger.consoleLog("Placing order: " + order.toString());
-    OrderBook* ob = getOrderBook(order.getSymbol());
-    return ob->addOrder(order);
+const OrderBook* MatchingEngine::findOrderBook(SymbolId symbolId) const {
+    return symbolId < orderBooks.size() ? orderBooks[symbolId].get() : nullptr;
 }
 
-std::vector<Trade> MatchingEngine::modifyOrder(const std::string& orderId, double newPrice, int newQuantity) {
-    logger.consoleLog("Modifying order ID: " + orderId);
-    // Find the order in any order book
-    for (auto const& [symbol, orderBook] : orderBooks) {
-        std::vector<Order> ordersInBook = orderBook->getAllOrders();
-        for (const auto& order : ordersInBook) {
-            if (order.getOrderId() == orderId) {
-                return orderBook->modifyOrder(orderId, newPrice, newQuantity);
-            }
-        }
+SymbolId MatchingEngine::internSymbol(const std::string& symbol) {
+    return symbols.intern(symbol);
+}
+
+std::vector<Trade> MatchingEngine::placeOrder(Order order) {
+    FillBuffer fills;
+    placeOrder(std::move(order), fills);
+    return toTrades(fills);
+}
+
+bool MatchingEngine::placeOrder(Order order, FillSink& sink) {
+    if (!symbols.contains(order.getSymbolId())) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_UNKNOWN_SYMBOL, 0, order.getSymbolId(), order.getOrderId());
+        return false;
+    }
+    const Instrument& instrument = symbols.getInstrument(order.getSymbolId());
+    ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_PLACING, order.getTimestamp(), order.getOrderId(), instrument.symbol, order.getType(),
+                     order.getPrice(), order.getQuantity(), order.getTimestamp());
+    if (hasOrder(order.getOrderId())) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_DUPLICATE, 0, order.getOrderId());
+        return false;
+    }
+    if (!instrument.isValidQuantity(order.getQuantity())) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_BAD_QUANTITY, 0, order.getQuantity(), instrument.symbol);
+        return false;
+    }
+    if (order.getPrice() <= 0) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_BAD_PRICE, 0, order.getPrice(), order.getOrderId());
+        return false;
+    }
+    OrderBook* ob = getOrderBook(order.getSymbolId());
+    return ob->addOrder(std::move(order), sink);
+}
+
+std::vector<Trade> MatchingEngine::modifyOrder(const std::string& orderId, Price newPrice, int newQuantity) {
+    FillBuffer fills;
+    modifyOrder(orderId, newPrice, newQuantity, fills);
+    return toTrades(fills);
+}
+
+bool MatchingEngine::modifyOrder(const std::string& orderId, Price newPrice, int newQuantity, FillSink& sink) {
+    ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_MODIFY_REQUESTED, 0, orderId);
+    auto it = orderIndex.find(orderId);
+    if (it == orderIndex.end()) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_MODIFY_NOT_FOUND, 0, orderId);
+        return false;
+    }
+    OrderLocation location = it->second;
+    if (!location.book->getInstrument().isValidQuantity(newQuantity)) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_BAD_QUANTITY, 0, newQuantity, location.book->getSymbol());
+        return false;
     }
-    logger.consoleLog("Error: Order ID " + orderId + " not found for modification in any order book.");
-    return {}; // Return empty vector if order not found
+    if (newPrice <= 0) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_BAD_PRICE, 0, newPrice, orderId);
+        return false;
+    }
+    return location.book->modifyOrder(location.handle, newPrice, newQuantity, sink);
+}
+
+std::vector<Trade> MatchingEngine::toTrades(const FillBuffer& fills) const {
+    std::vector<Trade> trades;
+    trades.reserve(fills.size());
+    for (const Fill& fill : fills.getFills()) {
+        trades.push_back(Trade::fromFill(fill));
+    }
+    return trades;
 }
 
 bool MatchingEngine::cancelOrder(const std::string& orderId) {
-    logger.consoleLog("Cancelling order ID: " + orderId);
-    // Find the order in any order book
-    for (auto const& [symbol, orderBook] : orderBooks) {
-        std::vector<Order> ordersInBook = orderBook->getAllOrders();
-        for (const auto& order : ordersInBook) {
-            if (order.getOrderId() == orderId) {
-                return orderBook->cancelOrder(orderId);
-            }
+    ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_CANCEL_REQUESTED, 0, orderId);
+    auto it = orderIndex.find(orderId);
+    if (it == orderIndex.end()) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_CANCEL_NOT_FOUND, 0, orderId);
+        return false; // Return false if order not found
+    }
+    // The book reports the removal back through onOrderRemoved, which drops the index entry
+    OrderLocation location = it->second;
+    return location.book->cancelOrder(location.handle);
+}
+
+bool MatchingEngine::hasOrder(const std::string& orderId) const {
+    return orderIndex.count(orderId) != 0;
+}
+
+const Order* MatchingEngine::findOrder(const std::string& orderId) const {
+    auto it = orderIndex.find(orderId);
+    return it != orderIndex.end() ? &it->second.handle->order : nullptr;
+}
+
+void MatchingEngine::setSideEffectsEnabled(bool on) {
+    logger.setEnabled(on);
+    emailNotifier.setEnabled(on);
+}
+
+void MatchingEngine::setMarketDataListener(MarketDataListener* listener) {
+    marketDataListener = listener;
+    for (const auto& orderBook : orderBooks) {
+        if (orderBook) {
+            orderBook->setMarketDataListener(listener);
         }
     }
-    logger.consoleLog("Error: Order ID " + orderId + " not found for cancellation in any order book.");
-    return false; // Return false if order not found
+}
+
+bool MatchingEngine::setInstrument(const std::string& symbol, double tickSize, int lotSize) {
+    SymbolId symbolId = symbols.find(symbol);
+    if (findOrderBook(symbolId) != nullptr) {
+        logger.consoleLog("Error: Cannot change tick/lot size for " + symbol + " while its order book exists.");
+        return false;
+    }
+    if (tickSize <= 0 || lotSize <= 0) {
+        logger.consoleLog("Error: Invalid tick size or lot size for " + symbol + ".");
+        return false;
+    }
+    if (symbolId == INVALID_SYMBOL_ID) {
+        symbolId = symbols.intern(symbol);
+    }
+    symbols.setInstrument(symbolId, tickSize, lotSize);
+    return true;
+}
+
+const Instrument* MatchingEngine::getOrderInstrument(const std::string& orderId) const {
+    auto it = orderIndex.find(orderId);
+    return it != orderIndex.end() ? &it->second.book->getInstrument() : nullptr;
 }
 
 void MatchingEngine::printOrderBook(const std::string& symbol) const {
-    auto it = orderBooks.find(symbol);
-    if (it != orderBooks.end()) {
-        it->second->printOrderBook();
+    const OrderBook* ob = findOrderBook(symbols.find(symbol));
+    if (ob != nullptr) {
+        ob->printOrderBook();
     } else {
         logger.consoleLog("Order book for symbol " + symbol + " does not exist.");
     }
 }
 
+bool MatchingEngine::getDepth(const std::string& symbol, std::size_t maxLevels, BookDepth& depth) const {
+    const OrderBook* ob = findOrderBook(symbols.find(symbol));
+    if (ob == nullptr) {
+        depth.symbolId = symbols.find(symbol);
+        depth.sequence = sequencer.getLast();
+        depth.bids.clear();
+        depth.asks.clear();
+        return false;
+    }
+    ob->getDepth(maxLevels, depth);
+    return true;
+}
+
+bool MatchingEngine::getTopOfBook(const std::string& symbol, TopOfBook& top) const {
+    const OrderBook* ob = findOrderBook(symbols.find(symbol));
+    if (ob == nullptr) {
+        return false;
+    }
+    top = ob->getTopOfBook();
+    return true;
+}
+
+const SeqLock<TopOfBook>* MatchingEngine::getTopOfBookFeed(const std::string& symbol) const {
+    const OrderBook* ob = findOrderBook(symbols.find(symbol));
+    return ob != nullptr ? &ob->getTopOfBookFeed() : nullptr;
+}
+
 std::vector<Order> MatchingEngine::getAllOrders() const {
     std::vector<Order> allCurrentOrders;
-    for (auto const& [symbol, orderBook] : orderBooks) {
+    for (const auto& orderBook : orderBooks) {
+        if (!orderBook) {
+            continue;
+        }
         std::vector<Order> ordersInBook = orderBook->getAllOrders();
         allCurrentOrders.insert(allCurrentOrders.end(), ordersInBook.begin(), ordersInBook.end());
     }
     return allCurrentOrders;
 }
 
+void MatchingEngine::captureSnapshot(std::uint64_t journalSequence, EngineSnapshot& snapshot) const {
+    snapshot.reset(journalSequence, sequencer.getLast(), orderIndex.size());
+    for (SymbolId symbolId = 0; symbolId < symbols.size(); ++symbolId) {
+        snapshot.addSymbol(symbols.getInstrument(symbolId));
+    }
+    for (const auto& orderBook : orderBooks) {
+        if (!orderBook) {
+            continue;
+        }
+        snapshot.addBook(orderBook->getSymbolId());
+        orderBook->forEachOrder([&snapshot](const Order& order) { snapshot.addOrder(order); });
+    }
+}
+
+bool MatchingEngine::restoreSnapshot(const EngineSnapshot& snapshot) {
+    std::vector<SymbolId> symbolIds; // Snapshot SymbolId -> this engine's SymbolId
+    for (const SnapshotSymbol& entry : snapshot.getSymbols()) {
+        SymbolId symbolId = symbols.intern(entry.symbol);
+        const Instrument& instrument = symbols.getInstrument(symbolId);
+        if ((instrument.tickSize != entry.tickSize || instrument.lotSize != entry.lotSize) &&
+            !setInstrument(entry.symbol, entry.tickSize, entry.lotSize)) {
+            return false;
+        }
+        if (entry.symbolId >= symbolIds.size()) {
+            symbolIds.resize(entry.symbolId + 1, INVALID_SYMBOL_ID);
+        }
+        symbolIds[entry.symbolId] = symbolId;
+    }
+
+    const SnapshotOrder* entry = snapshot.getOrders().data();
+    for (const SnapshotBook& bookEntry : snapshot.getBooks()) {
+        if (bookEntry.symbolId >= symbolIds.size() || symbolIds[bookEntry.symbolId] == INVALID_SYMBOL_ID) {
+            return false;
+        }
+        SymbolId symbolId = symbolIds[bookEntry.symbolId];
+        OrderBook* book = getOrderBook(symbolId);
+        for (std::uint64_t i = 0; i < bookEntry.orderCount; ++i, ++entry) {
+            Order order(entry->orderId, symbolId, static_cast<OrderType>(entry->side), entry->price, entry->quantity);
+            order.timestamp = EngineClock::fromWallNanos(entry->wallNanos);
+            order.sequence = entry->sequence;
+            if (orderIndex.count(order.getOrderId()) || !book->restoreOrder(std::move(order))) {
+                return false;
+            }
+        }
+    }
+    sequencer.resetTo(snapshot.getEngineSequence());
+    return true;
+}
+
+void MatchingEngine::onOrderAdded(OrderBook& book, OrderHandle handle) {
+    orderIndex.emplace(handle->order.getOrderId(), OrderLocation{&book, handle});
+}
+
+void MatchingEngine::onOrderRemoved(OrderBook&, OrderHandle handle) {
+    orderIndex.erase(handle->order.getOrderId());
+}
 
+PoolStats MatchingEngine::getPoolStats() const {
+    PoolStats stats = bookPools.getStats();
+    stats += orderIndexNodes.getStats();
+    return stats;
+}
@@ -2,34 +2,99 @@
 #define MATCHING_ENGINE_H
 
 #include "OrderBook.h"
+#include "Instrument.h"
+#include "SymbolDirectory.h"
+#include "ObjectPool.h"
 #include "Trade.h"
+#include "Fill.h"
 #include "Logger.h"
 #include "EmailNotifier.h"
-#include <map>
+#include "Snapshot.h"
+#include <unordered_map>
 #include <string>
 #include <vector>
 #include <memory>
 
-class MatchingEngine {
+class MatchingEngine : private OrderBookListener {
 public:
-    MatchingEngine(Logger& logger, EmailNotifier& notifier);
+    // orderCapacity sizes the order, level and index pools up front
+    MatchingEngine(Logger& logger, EmailNotifier& notifier, std::size_t orderCapacity = 65536);
 
-    std::vector<Trade> placeOrder(const Order& order);
-    std::vector<Trade> modifyOrder(const std::string& orderId, double newPrice, int newQuantity);
+    // Allocation-free entry points: fills are streamed into the caller's sink. A request is rejected
+    // (false) for an unknown symbol or order, a duplicate ID, an off-lot quantity or a price below one tick.
+    bool placeOrder(Order order, FillSink& sink);
+    bool modifyOrder(const std::string& orderId, Price newPrice, int newQuantity, FillSink& sink);
+
+    std::vector<Trade> placeOrder(Order order);
+    std::vector<Trade> modifyOrder(const std::string& orderId, Price newPrice, int newQuantity);
     bool cancelOrder(const std::string& orderId);
+    bool hasOrder(const std::string& orderId) const;
+    // Resting order with this ID, or nullptr; valid until the order is next modified, filled or cancelled
+    const Order* findOrder(const std::string& orderId) const;
     void printOrderBook(const std::string& symbol) const;
+    // Top-N aggregated levels per side; returns false (and an empty snapshot) if the symbol has no book
+    bool getDepth(const std::string& symbol, std::size_t maxLevels, BookDepth& depth) const;
+    // Best bid/offer of a symbol; returns false if the symbol has no book yet
+    bool getTopOfBook(const std::string& symbol, TopOfBook& top) const;
+    // Seqlock feed other threads can poll without locking; look it up on the matching thread.
+    // Null until the symbol has a book, then valid for the life of the engine.
+    const SeqLock<TopOfBook>* getTopOfBookFeed(const std::string& symbol) const;
+
+    // Interns a ticker at order entry; orders then carry only the returned ID
+    SymbolId internSymbol(const std::string& symbol);
+    const SymbolDirectory& getSymbols() const { return symbols; }
+
+    // Tick and lot size are fixed once a symbol has a book
+    bool setInstrument(const std::string& symbol, double tickSize, int lotSize);
+    // Instrument of the book an order rests in, or nullptr if the order is unknown
+    const Instrument* getOrderInstrument(const std::string& orderId) const;
     
     // For persistence
     std::vector<Order> getAllOrders() const;
 
+    // Copies the symbol table, every book's resting orders and the sequence into snapshot, tagged with
+    // the journal sequence they reflect. Call on the matching thread; matching only waits for the copy.
+    void captureSnapshot(std::uint64_t journalSequence, EngineSnapshot& snapshot) const;
+    // Rebuilds books and sequence from a verified snapshot; call on a fresh engine.
+    // False if an order could not be restored (the engine is then partly rebuilt).
+    bool restoreSnapshot(const EngineSnapshot& snapshot);
+
+    // Turns the engine's logging and notifications off (journal replay) or back on
+    void setSideEffectsEnabled(bool on);
+
+    // Every book, including those created later, reports depth changes and trades to listener; null stops it
+    void setMarketDataListener(MarketDataListener* listener);
+
+    // Sequence number of the most recent accepted order, modify, fill or cancel
+    std::uint64_t getLastSequence() const { return sequencer.getLast(); }
+
+    // Pool usage across all books; heapAllocations() stays flat once matching reaches steady state
+    PoolStats getPoolStats() const;
+
 private:
+    // Where a resting order lives, so cancels and modifies go straight to it
+    struct OrderLocation {
+        OrderBook* book;
+        OrderHandle handle;
+    };
+
     Logger& logger;
     EmailNotifier& emailNotifier;
-    std::map<std::string, std::unique_ptr<OrderBook>> orderBooks;
+    SymbolDirectory symbols;
+    Sequencer sequencer;
+    // Pools are declared before the books and index so they outlive them
+    OrderBookPools bookPools;
+    BlockPool orderIndexNodes;
+    std::vector<std::unique_ptr<OrderBook>> orderBooks; // Indexed by SymbolId, null until the first order
+    MarketDataListener* marketDataListener = nullptr;
+    OrderIdMap<OrderLocation> orderIndex; // Every resting order across all books
 
-    OrderBook* getOrderBook(const std::string& symbol);
+    OrderBook* getOrderBook(SymbolId symbolId);
+    const OrderBook* findOrderBook(SymbolId symbolId) const;
+    std::vector<Trade> toTrades(const FillBuffer& fills) const;
+
+    void onOrderAdded(OrderBook& book, OrderHandle handle) override;
+    void onOrderRemoved(OrderBook& book, OrderHandle handle) override;
 };
 
 #endif // MATCHING_ENGINE_H
-
-
@@ -0,0 +1,176 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+struct PoolStats {
+    std::size_t capacity = 0;        // Blocks owned by the pool
+    std::size_t inUse = 0;           // Blocks currently handed out
+    std::size_t slabAllocations = 0; // Heap allocations made to create or grow the pool
+    std::size_t heapFallbacks = 0;   // Requests the pool could not serve and sent to operator new
+
+    std::size_t heapAllocations() const { return slabAllocations + heapFallbacks; }
+
+    PoolStats& operator+=(const PoolStats& other) {
+        capacity += other.capacity;
+        inUse += other.inUse;
+        slabAllocations += other.slabAllocations;
+        heapFallbacks += other.heapFallbacks;
+        return *this;
+    }
+};
+
+// Fixed-size block allocator. Blocks are carved out of large slabs and freed blocks are
+// recycled through a free list, so once the pool is warm allocate/deallocate never hit the heap.
+// The block size is taken from the first request when it is not known up front (container nodes).
+class BlockPool {
+public:
+    explicit BlockPool(std::size_t blocksPerSlab, std::size_t blockSize = 0)
+        : blocksPerSlab(blocksPerSlab > 0 ? blocksPerSlab : 1) {
+        if (blockSize > 0) {
+            configure(blockSize);
+        }
+    }
+
+    ~BlockPool() {
+        for (void* slab : slabs) {
+            ::operator delete(slab);
+        }
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    void* allocate(std::size_t size) {
+        if (blockSize == 0) {
+            configure(size);
+        }
+        if (size > blockSize) {
+            stats.heapFallbacks++;
+            return ::operator new(size);
+        }
+        if (freeList == nullptr) {
+            addSlab();
+        }
+        FreeBlock* block = freeList;
+        freeList = block->next;
+        stats.inUse++;
+        return block;
+    }
+
+    void deallocate(void* pointer, std::size_t size) noexcept {
+        if (size > blockSize) {
+            ::operator delete(pointer);
+            return;
+        }
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+        block->next = freeList;
+        freeList = block;
+        stats.inUse--;
+    }
+
+    void recordHeapFallback() { stats.heapFallbacks++; }
+    const PoolStats& getStats() const { return stats; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::size_t blocksPerSlab;
+    std::size_t blockSize = 0;
+    FreeBlock* freeList = nullptr;
+    std::vector<void*> slabs;
+    PoolStats stats;
+
+    void configure(std::size_t size) {
+        const std::size_t alignment = alignof(std::max_align_t);
+        if (size < sizeof(FreeBlock)) {
+            size = sizeof(FreeBlock);
+        }
+        blockSize = (size + alignment - 1) / alignment * alignment;
+        slabs.reserve(64);
+        addSlab();
+    }
+
+    void addSlab() {
+        char* slab = static_cast<char*>(::operator new(blockSize * blocksPerSlab));
+        slabs.push_back(slab);
+        stats.slabAllocations++;
+        stats.capacity += blocksPerSlab;
+        // Thread the new blocks onto the free list, lowest address first
+        for (std::size_t i = blocksPerSlab; i > 0; --i) {
+            FreeBlock* block = reinterpret_cast<FreeBlock*>(slab + (i - 1) * blockSize);
+            block->next = freeList;
+            freeList = block;
+        }
+    }
+};
+
+// Typed front end over a BlockPool for objects the engine creates and destroys itself
+template <typename T>
+class ObjectPool {
+public:
+    explicit ObjectPool(std::size_t blocksPerSlab) : pool(blocksPerSlab, sizeof(T)) {}
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        void* memory = pool.allocate(sizeof(T));
+        try {
+            return new (memory) T(std::forward<Args>(args)...);
+        } catch (...) {
+            pool.deallocate(memory, sizeof(T));
+            throw;
+        }
+    }
+
+    void destroy(T* object) {
+        object->~T();
+        pool.deallocate(object, sizeof(T));
+    }
+
+    const PoolStats& getStats() const { return pool.getStats(); }
+
+private:
+    BlockPool pool;
+};
+
+// STL allocator that serves single-node requests (map/unordered_map nodes) from a BlockPool.
+// Array requests such as hash bucket tables go to the heap and are counted as fallbacks.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(BlockPool& blockPool) noexcept : pool(&blockPool) {}
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept : pool(other.pool) {}
+
+    T* allocate(std::size_t n) {
+        if (n == 1) {
+            return static_cast<T*>(pool->allocate(sizeof(T)));
+        }
+        pool->recordHeapFallback();
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t n) noexcept {
+        if (n == 1) {
+            pool->deallocate(pointer, sizeof(T));
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const noexcept { return pool == other.pool; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const noexcept { return pool != other.pool; }
+
+    BlockPool* pool;
+};
+
+#endif // OBJECT_POOL_H
@@ -1,18 +1,17 @@
 
 #include "Order.h"
+#include "EngineClock.h"
 #include <sstream>
 
-Order::Order(std::string id, std::string sym, OrderType t, double p, int q)
-    : orderId(id), symbol(sym), type(t), price(p), quantity(q) {
-    timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-}
+Order::Order(std::string id, SymbolId sym, OrderType t, Price p, int q)
+    : orderId(std::move(id)), symbolId(sym), type(t), price(p), quantity(q), timestamp(EngineClock::now()) {}
 
-std::string Order::toString() const {
+std::string Order::toString(const std::string& symbol) const {
     std::stringstream ss;
     ss << "Order ID: " << orderId << ", Symbol: " << symbol
        << ", Type: " << (type == BUY ? "BUY" : "SELL")
-       << ", Price: " << price << ", Quantity: " << quantity
-       << ", Timestamp: " << timestamp;
+       << ", Price (ticks): " << price << ", Quantity: " << quantity
+       << ", Timestamp (ns): " << timestamp;
     return ss.str();
 }
 
@@ -1,6 +1,8 @@
 #ifndef ORDER_H
 #define ORDER_H
 
+#include "Instrument.h"
+#include <cstdint>
 #include <string>
 #include <chrono>
 
@@ -9,25 +11,29 @@ enum OrderType { BUY, SELL };
 class Order {
 public:
     std::string orderId;
-    std::string symbol;
+    SymbolId symbolId;
     OrderType type;
-    double price;
+    Price price; // In ticks of the symbol's tick size
     int quantity;
-    long long timestamp;
+    long long timestamp; // EngineClock nanoseconds, stamped once when the order is created at entry
+    std::uint64_t sequence = 0; // Engine sequence number assigned when the order is accepted
 
-    Order(std::string orderId, std::string symbol, OrderType type, double price, int quantity);
+    Order(std::string orderId, SymbolId symbolId, OrderType type, Price price, int quantity);
 
     // Getters
-    std::string getOrderId() const { return orderId; }
-    std::string getSymbol() const { return symbol; }
+    const std::string& getOrderId() const { return orderId; }
+    SymbolId getSymbolId() const { return symbolId; }
     OrderType getType() const { return type; }
-    double getPrice() const { return price; }
+    Price getPrice() const { return price; }
     int getQuantity() const { return quantity; }
     long long getTimestamp() const { return timestamp; }
+    std::uint64_t getSequence() const { return sequence; }
 
+    void setPrice(Price p) { price = p; }
     void setQuantity(int qty) { quantity = qty; }
 
-    std::string toString() const;
+    // The symbol name comes from the caller (book or SymbolDirectory); orders only carry the ID
+    std::string toString(const std::string& symbol) const;
 };
 
 #endif // ORDER_H
@@ -1,90 +1,170 @@
 #include "OrderBook.h"
+#include "EngineClock.h"
 #include <iostream>
 #include <algorithm>
+#include <iterator>
 
-OrderBook::OrderBook(const std::string& sym, Logger& log, EmailNotifier& notifier)
-    : symbol(sym), logger(log), emailNotifier(notifier) {}
+// Standalone books size their own pools for this many orders
+static const std::size_t STANDALONE_ORDER_CAPACITY = 4096;
+// Initial per-book index buckets; a book that outgrows them rehashes once and counts a heap allocation
+static const std::size_t INITIAL_INDEX_BUCKETS = 1024;
+
+OrderBookPools::OrderBookPools(std::size_t capacity)
+    : orderCapacity(capacity), orderNodes(capacity), levelNodes(capacity), indexNodes(capacity) {}
+
+PoolStats OrderBookPools::getStats() const {
+    PoolStats stats = orderNodes.getStats();
+    stats += levelNodes.getStats();
+    stats += indexNodes.getStats();
+    return stats;
+}
+
+OrderBook::OrderBook(const Instrument& inst, Logger& log, EmailNotifier& notifier, OrderBookListener* bookListener,
+                     OrderBookPools* sharedPools, Sequencer* sharedSequencer)
+    : instrument(inst), logger(log), emailNotifier(notifier), listener(bookListener),
+      ownedPools(sharedPools == nullptr ? std::make_unique<OrderBookPools>(STANDALONE_ORDER_CAPACITY) : nullptr),
+      pools(sharedPools != nullptr ? *sharedPools : *ownedPools),
+      sequencer(sharedSequencer != nullptr ? *sharedSequencer : ownedSequencer),
+      bidLevels(PoolAllocator<PriceLevelMap::value_type>(pools.levelNodes)),
+      askLevels(PoolAllocator<PriceLevelMap::value_type>(pools.levelNodes)),
+      allOrders(INITIAL_INDEX_BUCKETS, std::hash<std::string_view>(), std::equal_to<std::string_view>(),
+                PoolAllocator<OrderIdMap<OrderHandle>::value_type>(pools.indexNodes)) {
+    topOfBook.symbolId = instrument.id;
+    topOfBookFeed.store(topOfBook);
+}
+
+OrderBook::~OrderBook() {
+    std::vector<OrderHandle> nodes;
+    nodes.reserve(allOrders.size());
+    for (const auto& [orderId, node] : allOrders) {
+        nodes.push_back(node);
+    }
+    allOrders.clear();
+    bidLevels.clear();
+    askLevels.clear();
+    for (OrderHandle node : nodes) {
+        pools.orderNodes.destroy(node);
+    }
+}
 
 std::vector<Trade> OrderBook::addOrder(Order newOrder) {
+    FillBuffer fills;
+    addOrder(std::move(newOrder), fills);
+    return toTrades(fills);
+}
+
+bool OrderBook::addOrder(Order newOrder, FillSink& sink) {
     try {
-        logger.consoleLog("Attempting to add order: " + newOrder.toString());
-        std::vector<Trade> trades;
+        ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_RECEIVED, newOrder.getTimestamp(), newOrder.getOrderId(), instrument.symbol,
+                         newOrder.getType(), newOrder.getPrice(), newOrder.getQuantity(), newOrder.getTimestamp());
+
+        if (newOrder.getOrderId().size() > MAX_ORDER_ID_LENGTH) {
+            ENGINE_LOG_WARN(logger, LogFormat::ORDER_ID_TOO_LONG, 0, newOrder.getOrderId(), MAX_ORDER_ID_LENGTH);
+            return false;
+        }
 
         if (allOrders.count(newOrder.getOrderId())) {
-            logger.consoleLog("Error: Order with ID " + newOrder.getOrderId() + " already exists.");
-            std::ofstream errLog("error.log", std::ios::app); errLog << "Duplicate order ID: " << newOrder.getOrderId() << "\n";
-            return trades;
+            ENGINE_LOG_WARN(logger, LogFormat::ORDER_DUPLICATE, 0, newOrder.getOrderId());
+            return false;
         }
 
-        allOrders.emplace(newOrder.getOrderId(), newOrder);
+        newOrder.sequence = sequencer.next();
 
-        if (newOrder.getType() == BUY) {
-            buyOrders.push(newOrder);
-        } else {
-            sellOrders.push(newOrder);
-        }
+        // Match before resting: an order that fills completely never gets a node or an index entry
+        matchOrders(newOrder, newOrder.getTimestamp(), sink);
 
-        trades = matchOrders();
-        return trades;
+        if (newOrder.getQuantity() > 0) {
+            OrderHandle handle = pools.orderNodes.create(std::move(newOrder));
+            insertIntoLevel(handle);
+            allOrders.emplace(handle->order.getOrderId(), handle);
+            if (listener != nullptr) {
+                listener->onOrderAdded(*this, handle);
+            }
+        }
+        publishTopOfBook();
+        return true;
     } catch (const std::exception& ex) {
         logger.consoleLog(std::string("Exception in addOrder: ") + ex.what());
         std::ofstream errLog("error.log", std::ios::app); errLog << "Exception in addOrder: " << ex.what() << "\n";
-        return {};
+        return false;
     }
 }
 
-std::vector<Trade> OrderBook::modifyOrder(const std::string& orderId, double newPrice, int newQuantity) {
-    try {
-        logger.consoleLog("Attempting to modify order ID: " + orderId);
-        std::vector<Trade> trades;
+std::vector<Trade> OrderBook::modifyOrder(const std::string& orderId, Price newPrice, int newQuantity) {
+    FillBuffer fills;
+    modifyOrder(orderId, newPrice, newQuantity, fills);
+    return toTrades(fills);
+}
 
-        if (allOrders.find(orderId) == allOrders.end()) {
-            logger.consoleLog("Error: Order ID " + orderId + " not found for modification.");
-            std::ofstream errLog("error.log", std::ios::app); errLog << "Order ID not found for modification: " << orderId << "\n";
-            return trades;
-        }
+bool OrderBook::modifyOrder(const std::string& orderId, Price newPrice, int newQuantity, FillSink& sink) {
+    auto it = allOrders.find(orderId);
+    if (it == allOrders.end()) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_MODIFY_NOT_FOUND, 0, orderId);
+        return false;
+    }
+    return modifyOrder(it->second, newPrice, newQuantity, sink);
+}
 
-        Order oldOrder = allOrders.at(orderId);
-        // Remove old order from queues and map
-        removeOrderFromQueues(orderId, oldOrder.getType());
-        allOrders.erase(orderId);
+bool OrderBook::modifyOrder(OrderHandle node, Price newPrice, int newQuantity, FillSink& sink) {
+    try {
+        long long eventTime = EngineClock::now();
+        ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_MODIFY_ATTEMPT, eventTime, node->order.getOrderId());
+        sequencer.next();
 
-        // Create new order with updated details, keeping original timestamp and ID
-        Order modifiedOrder(orderId, oldOrder.getSymbol(), oldOrder.getType(), newPrice, newQuantity);
-        modifiedOrder.timestamp = oldOrder.getTimestamp(); // Preserve original timestamp
+        // The original timestamp is preserved, so the order keeps its time priority
+        if (newPrice == node->order.getPrice()) {
+            // Same price cannot cross an uncrossed book; adjust in place and keep the queue position
+            const int oldQuantity = node->order.getQuantity();
+            node->level->second.totalQuantity += newQuantity - oldQuantity;
+            node->order.setQuantity(newQuantity);
+            if (newQuantity != oldQuantity) {
+                notifyLevel(node->order.getType(), node->level->second, LevelChange::MODIFIED);
+            }
+            ENGINE_LOG_INFO(logger, LogFormat::ORDER_MODIFIED, eventTime, node->order.getOrderId(), node->order.getOrderId(), instrument.symbol,
+                            node->order.getType(), node->order.getPrice(), node->order.getQuantity(), node->order.getTimestamp());
+            publishTopOfBook();
+            return true;
+        }
 
-        allOrders.emplace(modifiedOrder.getOrderId(), modifiedOrder);
+        unlinkFromLevel(node);
+        node->order.setPrice(newPrice);
+        node->order.setQuantity(newQuantity);
+        ENGINE_LOG_INFO(logger, LogFormat::ORDER_MODIFIED, eventTime, node->order.getOrderId(), node->order.getOrderId(), instrument.symbol,
+                        node->order.getType(), node->order.getPrice(), node->order.getQuantity(), node->order.getTimestamp());
 
-        if (modifiedOrder.getType() == BUY) {
-            buyOrders.push(modifiedOrder);
+        matchOrders(node->order, eventTime, sink);
+        if (node->order.getQuantity() > 0) {
+            insertIntoLevel(node);
         } else {
-            sellOrders.push(modifiedOrder);
+            releaseOrder(node);
         }
-
-        logger.consoleLog("Order " + orderId + " modified to: " + modifiedOrder.toString());
-        trades = matchOrders();
-        return trades;
+        publishTopOfBook();
+        return true;
     } catch (const std::exception& ex) {
         logger.consoleLog(std::string("Exception in modifyOrder: ") + ex.what());
         std::ofstream errLog("error.log", std::ios::app); errLog << "Exception in modifyOrder: " << ex.what() << "\n";
-        return {};
+        return false;
     }
 }
 
 bool OrderBook::cancelOrder(const std::string& orderId) {
-    try {
-        logger.consoleLog("Attempting to cancel order ID: " + orderId);
-
-        if (allOrders.find(orderId) == allOrders.end()) {
-            logger.consoleLog("Error: Order ID " + orderId + " not found for cancellation.");
-            std::ofstream errLog("error.log", std::ios::app); errLog << "Order ID not found for cancellation: " << orderId << "\n";
-            return false;
-        }
+    auto it = allOrders.find(orderId);
+    if (it == allOrders.end()) {
+        ENGINE_LOG_WARN(logger, LogFormat::ORDER_CANCEL_NOT_FOUND, 0, orderId);
+        return false;
+    }
+    return cancelOrder(it->second);
+}
 
-        Order orderToCancel = allOrders.at(orderId);
-        removeOrderFromQueues(orderId, orderToCancel.getType());
-        allOrders.erase(orderId);
-        logger.consoleLog("Order " + orderId + " cancelled.");
+bool OrderBook::cancelOrder(OrderHandle node) {
+    try {
+        long long eventTime = EngineClock::now();
+        ENGINE_LOG_DEBUG(logger, LogFormat::ORDER_CANCEL_ATTEMPT, eventTime, node->order.getOrderId());
+        // Recorded before the node (and the ID it holds) goes back to the pool
+        ENGINE_LOG_INFO(logger, LogFormat::ORDER_CANCELLED, eventTime, node->order.getOrderId());
+        removeOrder(node);
+        sequencer.next();
+        publishTopOfBook();
         return true;
     } catch (const std::exception& ex) {
         logger.consoleLog(std::string("Exception in cancelOrder: ") + ex.what());
@@ -93,105 +173,212 @@ bool OrderBook::cancelOrder(const std::string& orderId) {
     }
 }
 
-std::vector<Trade> OrderBook::matchOrders() {
-    std::vector<Trade> trades;
-    while (!buyOrders.empty() && !sellOrders.empty()) {
-        Order buyOrder = buyOrders.top(); // Get a copy
-        Order sellOrder = sellOrders.top(); // Get a copy
-
-        if (buyOrder.getPrice() >= sellOrder.getPrice()) {
-            // Match found
-            int tradedQuantity = std::min(buyOrder.getQuantity(), sellOrder.getQuantity());
-            double tradePrice = (buyOrder.getTimestamp() < sellOrder.getTimestamp()) ? buyOrder.getPrice() : sellOrder.getPrice();
-
-            Trade newTrade(buyOrder.getOrderId(), sellOrder.getOrderId(), symbol, tradePrice, tradedQuantity);
-            trades.push_back(newTrade);
-            logger.consoleLog("Trade executed: " + newTrade.toString());
-            emailNotifier.sendTradeNotification(newTrade.toString());
-
-            // Pop old orders
-            buyOrders.pop();
-            sellOrders.pop();
-
-            // Update quantities and push back if remaining
-            if (buyOrder.getQuantity() - tradedQuantity > 0) {
-                buyOrder.setQuantity(buyOrder.getQuantity() - tradedQuantity);
-                buyOrders.push(buyOrder);
-            }
-            if (sellOrder.getQuantity() - tradedQuantity > 0) {
-                sellOrder.setQuantity(sellOrder.getQuantity() - tradedQuantity);
-                sellOrders.push(sellOrder);
-            }
-
-            // Update allOrders map
-            allOrders.erase(buyOrder.getOrderId());
-            allOrders.erase(sellOrder.getOrderId());
-            if (buyOrder.getQuantity() > 0) {
-                allOrders.emplace(buyOrder.getOrderId(), buyOrder);
-            }
-            if (sellOrder.getQuantity() > 0) {
-                allOrders.emplace(sellOrder.getOrderId(), sellOrder);
-            }
+void OrderBook::matchOrders(Order& incoming, long long eventTime, FillSink& sink) {
+    const bool incomingIsBuy = incoming.getType() == BUY;
+    PriceLevelMap& opposite = incomingIsBuy ? askLevels : bidLevels;
 
-        } else {
+    // The book is uncrossed before every call, so only the incoming order can cross; it sweeps the
+    // opposite side best level first, oldest order first, and is reduced in place as it fills
+    while (incoming.getQuantity() > 0 && !opposite.empty()) {
+        PriceLevel& level = incomingIsBuy ? opposite.begin()->second : std::prev(opposite.end())->second;
+        if (incomingIsBuy ? incoming.getPrice() < level.price : incoming.getPrice() > level.price) {
             // No match, break loop
             break;
         }
+
+        OrderHandle resting = level.head;
+        const Order& buyOrder = incomingIsBuy ? incoming : resting->order;
+        const Order& sellOrder = incomingIsBuy ? resting->order : incoming;
+
+        Fill fill;
+        fill.sequence = sequencer.next();
+        fill.symbolId = instrument.id;
+        fill.aggressorSide = incoming.getType();
+        fill.quantity = std::min(incoming.getQuantity(), resting->order.getQuantity());
+        fill.price = (buyOrder.getTimestamp() < sellOrder.getTimestamp()) ? buyOrder.getPrice() : sellOrder.getPrice();
+        fill.timestamp = eventTime;
+        copyOrderId(fill.buyOrderId, buyOrder.getOrderId());
+        copyOrderId(fill.sellOrderId, sellOrder.getOrderId());
+        sink.onFill(fill);
+        if (marketData != nullptr) {
+            marketData->onTrade(*this, fill);
+        }
+
+        ENGINE_LOG_INFO(logger, LogFormat::TRADE_EXECUTED, eventTime, fill.sequence, fill.buyOrderId, fill.sellOrderId, instrument.symbol,
+                        fill.price, fill.quantity, fill.timestamp);
+        emailNotifier.sendTradeNotification(fill, instrument); // Queued for the notifier's worker
+
+        // The resting order keeps its queue position until it is fully filled
+        incoming.setQuantity(incoming.getQuantity() - fill.quantity);
+        resting->order.setQuantity(resting->order.getQuantity() - fill.quantity);
+        level.totalQuantity -= fill.quantity;
+
+        if (resting->order.getQuantity() == 0) {
+            removeOrder(resting);
+        } else {
+            notifyLevel(resting->order.getType(), level, LevelChange::MODIFIED);
+        }
+    }
+}
+
+std::vector<Trade> OrderBook::toTrades(const FillBuffer& fills) const {
+    std::vector<Trade> trades;
+    trades.reserve(fills.size());
+    for (const Fill& fill : fills.getFills()) {
+        trades.push_back(Trade::fromFill(fill));
     }
     return trades;
 }
 
 void OrderBook::printOrderBook() const {
-    logger.consoleLog("\n--- Order Book for " + symbol + " ---");
+    logger.consoleLog("\n--- Order Book for " + instrument.symbol + " ---");
     logger.consoleLog("Buy Orders (Price | Quantity | ID | Timestamp):");
-    std::priority_queue<Order, std::vector<Order>, CompareBuyOrders> tempBuyOrders = buyOrders;
-    while (!tempBuyOrders.empty()) {
-        const Order& order = tempBuyOrders.top();
-        logger.consoleLog("  " + std::to_string(order.getPrice()) + " | " + std::to_string(order.getQuantity()) + " | " + order.getOrderId() + " | " + std::to_string(order.getTimestamp()));
-        tempBuyOrders.pop();
+    for (auto it = bidLevels.rbegin(); it != bidLevels.rend(); ++it) {
+        printLevel(it->second);
     }
 
     logger.consoleLog("Sell Orders (Price | Quantity | ID | Timestamp):");
-    std::priority_queue<Order, std::vector<Order>, CompareSellOrders> tempSellOrders = sellOrders;
-    while (!tempSellOrders.empty()) {
-        const Order& order = tempSellOrders.top();
-        logger.consoleLog("  " + std::to_string(order.getPrice()) + " | " + std::to_string(order.getQuantity()) + " | " + order.getOrderId() + " | " + std::to_string(order.getTimestamp()));
-        tempSellOrders.pop();
+    for (const auto& [price, level] : askLevels) {
+        printLevel(level);
+    }
+
+    BookDepth depth;
+    getDepth(bidLevels.size() > askLevels.size() ? bidLevels.size() : askLevels.size(), depth);
+    logger.consoleLog("Depth (Side | Price | Quantity | Orders):");
+    for (const DepthLevel& level : depth.bids) {
+        logger.consoleLog("  BID | " + instrument.formatPrice(level.price) + " | " + std::to_string(level.totalQuantity) + " | " + std::to_string(level.orderCount));
+    }
+    for (const DepthLevel& level : depth.asks) {
+        logger.consoleLog("  ASK | " + instrument.formatPrice(level.price) + " | " + std::to_string(level.totalQuantity) + " | " + std::to_string(level.orderCount));
     }
     logger.consoleLog("---------------------------");
 }
 
-void OrderBook::removeOrderFromQueues(const std::string& orderId, OrderType type) {
-    // Rebuild the priority queue without the order to be removed
-    if (type == BUY) {
-        std::priority_queue<Order, std::vector<Order>, CompareBuyOrders> newBuyOrders;
-        while (!buyOrders.empty()) {
-            Order currentOrder = buyOrders.top();
-            buyOrders.pop();
-            if (currentOrder.getOrderId() != orderId) {
-                newBuyOrders.push(currentOrder);
-            }
-        }
-        buyOrders = newBuyOrders;
-    } else { // SELL
-        std::priority_queue<Order, std::vector<Order>, CompareSellOrders> newSellOrders;
-        while (!sellOrders.empty()) {
-            Order currentOrder = sellOrders.top();
-            sellOrders.pop();
-            if (currentOrder.getOrderId() != orderId) {
-                newSellOrders.push(currentOrder);
-            }
-        }
-        sellOrders = newSellOrders;
+void OrderBook::getDepth(std::size_t maxLevels, BookDepth& depth) const {
+    depth.symbolId = instrument.id;
+    depth.sequence = sequencer.getLast();
+    depth.bids.clear();
+    depth.asks.clear();
+    for (auto it = bidLevels.rbegin(); it != bidLevels.rend() && depth.bids.size() < maxLevels; ++it) {
+        depth.bids.push_back(DepthLevel{it->second.price, it->second.totalQuantity, it->second.orderCount});
+    }
+    for (auto it = askLevels.begin(); it != askLevels.end() && depth.asks.size() < maxLevels; ++it) {
+        depth.asks.push_back(DepthLevel{it->second.price, it->second.totalQuantity, it->second.orderCount});
+    }
+}
+
+BookDepth OrderBook::getDepth(std::size_t maxLevels) const {
+    BookDepth depth;
+    depth.bids.reserve(maxLevels);
+    depth.asks.reserve(maxLevels);
+    getDepth(maxLevels, depth);
+    return depth;
+}
+
+void OrderBook::publishTopOfBook() {
+    TopOfBook current;
+    current.symbolId = instrument.id;
+    current.sequence = topOfBook.sequence;
+    if (!bidLevels.empty()) {
+        const PriceLevel& best = std::prev(bidLevels.end())->second;
+        current.bidPrice = best.price;
+        current.bidQuantity = best.totalQuantity;
+        current.bidOrderCount = best.orderCount;
+    }
+    if (!askLevels.empty()) {
+        const PriceLevel& best = askLevels.begin()->second;
+        current.askPrice = best.price;
+        current.askQuantity = best.totalQuantity;
+        current.askOrderCount = best.orderCount;
+    }
+    // Changes behind the top level leave the record alone, so readers are not made to retry for nothing
+    if (current.bidPrice == topOfBook.bidPrice && current.bidQuantity == topOfBook.bidQuantity && current.bidOrderCount == topOfBook.bidOrderCount &&
+        current.askPrice == topOfBook.askPrice && current.askQuantity == topOfBook.askQuantity && current.askOrderCount == topOfBook.askOrderCount) {
+        return;
     }
+    current.sequence = sequencer.getLast();
+    topOfBook = current;
+    topOfBookFeed.store(topOfBook);
+}
+
+void OrderBook::printLevel(const PriceLevel& level) const {
+    for (OrderHandle node = level.head; node != nullptr; node = node->next) {
+        const Order& order = node->order;
+        logger.consoleLog("  " + instrument.formatPrice(order.getPrice()) + " | " + std::to_string(order.getQuantity()) + " | " + order.getOrderId() + " | " + std::to_string(EngineClock::toWallMillis(order.getTimestamp())));
+    }
+}
+
+void OrderBook::insertIntoLevel(OrderHandle node) {
+    PriceLevelMap& levels = sideLevels(node->order.getType());
+    auto [levelIt, created] = levels.try_emplace(node->order.getPrice());
+    PriceLevel& level = levelIt->second;
+    level.price = node->order.getPrice();
+    node->level = levelIt;
+
+    // Orders are queued by timestamp; new orders are the newest, so this stops at the tail
+    OrderHandle prev = level.tail;
+    while (prev != nullptr && prev->order.getTimestamp() > node->order.getTimestamp()) {
+        prev = prev->prev;
+    }
+    OrderHandle next = (prev != nullptr) ? prev->next : level.head;
+
+    node->prev = prev;
+    node->next = next;
+    if (prev != nullptr) prev->next = node; else level.head = node;
+    if (next != nullptr) next->prev = node; else level.tail = node;
+
+    level.totalQuantity += node->order.getQuantity();
+    level.orderCount++;
+    notifyLevel(node->order.getType(), level, created ? LevelChange::ADDED : LevelChange::MODIFIED);
+}
+
+void OrderBook::unlinkFromLevel(OrderHandle node) {
+    PriceLevel& level = node->level->second;
+    if (node->prev != nullptr) node->prev->next = node->next; else level.head = node->next;
+    if (node->next != nullptr) node->next->prev = node->prev; else level.tail = node->prev;
+    node->prev = nullptr;
+    node->next = nullptr;
+
+    level.totalQuantity -= node->order.getQuantity();
+    level.orderCount--;
+    if (level.orderCount == 0) {
+        notifyLevel(node->order.getType(), level, LevelChange::DELETED);
+        sideLevels(node->order.getType()).erase(node->level);
+    } else {
+        notifyLevel(node->order.getType(), level, LevelChange::MODIFIED);
+    }
+}
+
+void OrderBook::removeOrder(OrderHandle node) {
+    unlinkFromLevel(node);
+    releaseOrder(node);
+}
+
+void OrderBook::releaseOrder(OrderHandle node) {
+    if (listener != nullptr) {
+        listener->onOrderRemoved(*this, node);
+    }
+    allOrders.erase(allOrders.find(node->order.getOrderId()));
+    pools.orderNodes.destroy(node);
 }
 
 std::vector<Order> OrderBook::getAllOrders() const {
     std::vector<Order> orders;
-    for (const auto& pair : allOrders) {
-        orders.push_back(pair.second);
-    }
+    orders.reserve(allOrders.size());
+    forEachOrder([&orders](const Order& order) { orders.push_back(order); });
     return orders;
 }
 
-
+bool OrderBook::restoreOrder(Order order) {
+    if (order.getQuantity() <= 0 || order.getOrderId().size() > MAX_ORDER_ID_LENGTH || allOrders.count(order.getOrderId())) {
+        return false;
+    }
+    OrderHandle handle = pools.orderNodes.create(std::move(order));
+    insertIntoLevel(handle);
+    allOrders.emplace(handle->order.getOrderId(), handle);
+    if (listener != nullptr) {
+        listener->onOrderAdded(*this, handle);
+    }
+    publishTopOfBook();
+    return true;
+}
@@ -2,60 +2,207 @@
 #define ORDER_BOOK_H
 
 #include "Order.h"
+#include "Instrument.h"
 #include "Trade.h"
+#include "Fill.h"
 #include "Logger.h"
 #include "EmailNotifier.h"
-#include <queue>
+#include "ObjectPool.h"
+#include "Sequencer.h"
+#include "SeqLock.h"
 #include <map>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 
-// Custom comparator for BUY orders (max-heap: highest price, then oldest timestamp)
-struct CompareBuyOrders {
-    bool operator()(const Order& a, const Order& b) {
-        if (a.getPrice() != b.getPrice()) {
-            return a.getPrice() < b.getPrice(); // Max-heap for price
-        }
-        return a.getTimestamp() > b.getTimestamp(); // Min-heap for timestamp (oldest first)
-    }
+struct OrderNode;
+
+// All resting orders at one price, kept as an intrusive FIFO (oldest at head)
+struct PriceLevel {
+    Price price = 0;
+    int totalQuantity = 0;
+    int orderCount = 0;
+    OrderNode* head = nullptr;
+    OrderNode* tail = nullptr;
 };
 
-// Custom comparator for SELL orders (min-heap: lowest price, then oldest timestamp)
-struct CompareSellOrders {
-    bool operator()(const Order& a, const Order& b) {
-        if (a.getPrice() != b.getPrice()) {
-            return a.getPrice() > b.getPrice(); // Min-heap for price
-        }
-        return a.getTimestamp() > b.getTimestamp(); // Min-heap for timestamp (oldest first)
-    }
+// Aggregated view of one price level as returned by depth queries
+struct DepthLevel {
+    Price price = 0;
+    int totalQuantity = 0;
+    int orderCount = 0;
+};
+
+// Top levels of both sides, best price first. Reusing one snapshot across queries keeps them allocation-free.
+struct BookDepth {
+    SymbolId symbolId = 0;
+    std::uint64_t sequence = 0; // Engine sequence the snapshot reflects
+    std::vector<DepthLevel> bids;
+    std::vector<DepthLevel> asks;
+};
+
+// Best bid and offer with their aggregate size; a quantity of 0 means that side is empty
+struct TopOfBook {
+    SymbolId symbolId = 0;
+    std::uint64_t sequence = 0; // Engine sequence of the change that produced this record
+    Price bidPrice = 0;
+    int bidQuantity = 0;
+    int bidOrderCount = 0;
+    Price askPrice = 0;
+    int askQuantity = 0;
+    int askOrderCount = 0;
+};
+
+// Both sides are sorted ascending: best ask is begin(), best bid is the last level
+using PriceLevelMap = std::map<Price, PriceLevel, std::less<Price>, PoolAllocator<std::pair<const Price, PriceLevel>>>;
+
+// A resting order together with its links inside its price level
+struct OrderNode {
+    Order order;
+    OrderNode* prev = nullptr;
+    OrderNode* next = nullptr;
+    PriceLevelMap::iterator level;
+
+    explicit OrderNode(Order o) : order(std::move(o)) {}
+};
+
+using OrderHandle = OrderNode*;
+
+// Order ID index keyed by a view of the ID stored inside the resting node, so indexing never copies the string
+template <typename Value>
+using OrderIdMap = std::unordered_map<std::string_view, Value, std::hash<std::string_view>, std::equal_to<std::string_view>,
+                                      PoolAllocator<std::pair<const std::string_view, Value>>>;
+
+// Memory for resting orders, price levels and index nodes, sized once at startup and
+// shared by all books of an engine. Freed slots are recycled, so steady-state matching
+// does not allocate; PoolStats::heapAllocations() only moves while the pools grow.
+struct OrderBookPools {
+    explicit OrderBookPools(std::size_t orderCapacity = 65536);
+
+    std::size_t orderCapacity;
+    ObjectPool<OrderNode> orderNodes;
+    BlockPool levelNodes;
+    BlockPool indexNodes;
+
+    PoolStats getStats() const;
+};
+
+class OrderBook;
+
+// Notified whenever an order starts or stops resting in a book (MatchingEngine keeps its order index with it)
+class OrderBookListener {
+public:
+    virtual ~OrderBookListener() = default;
+    virtual void onOrderAdded(OrderBook& book, OrderHandle handle) = 0;
+    virtual void onOrderRemoved(OrderBook& book, OrderHandle handle) = 0;
+};
+
+enum class LevelChange : std::uint8_t { ADDED, MODIFIED, DELETED };
+
+// Notified of every change to a book's aggregated depth and of every trade, in the order they happen
+// on the matching thread (the market-data publisher). A DELETED level is reported before it is erased.
+class MarketDataListener {
+public:
+    virtual ~MarketDataListener() = default;
+    virtual void onLevelChanged(const OrderBook& book, OrderType side, const PriceLevel& level, LevelChange change) = 0;
+    virtual void onTrade(const OrderBook& book, const Fill& fill) = 0;
 };
 
 class OrderBook {
 public:
-    OrderBook(const std::string& symbol, Logger& logger, EmailNotifier& notifier);
+    OrderBook(const Instrument& instrument, Logger& logger, EmailNotifier& notifier, OrderBookListener* listener = nullptr,
+              OrderBookPools* pools = nullptr, Sequencer* sequencer = nullptr);
+    ~OrderBook();
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
 
+    // Fills are streamed into the sink as fixed-size records; these return false if the request was rejected
+    bool addOrder(Order order, FillSink& sink);
+    bool modifyOrder(const std::string& orderId, Price newPrice, int newQuantity, FillSink& sink);
+
+    // Convenience wrappers that collect the fills into Trades
     std::vector<Trade> addOrder(Order order);
-    std::vector<Trade> modifyOrder(const std::string& orderId, double newPrice, int newQuantity);
+    std::vector<Trade> modifyOrder(const std::string& orderId, Price newPrice, int newQuantity);
     bool cancelOrder(const std::string& orderId);
+
+    // Handle-based variants for callers that already know where the order rests
+    bool modifyOrder(OrderHandle handle, Price newPrice, int newQuantity, FillSink& sink);
+    bool cancelOrder(OrderHandle handle);
+
+    const std::string& getSymbol() const { return instrument.symbol; }
+    SymbolId getSymbolId() const { return instrument.id; }
+    const Instrument& getInstrument() const { return instrument; }
     void printOrderBook() const;
 
+    // Null (the default) turns market-data notifications off
+    void setMarketDataListener(MarketDataListener* marketDataListener) { marketData = marketDataListener; }
+
+    // Aggregated top-N levels per side; levels keep their totals as orders add, fill and cancel, so this is O(N)
+    void getDepth(std::size_t maxLevels, BookDepth& depth) const;
+    BookDepth getDepth(std::size_t maxLevels) const;
+
+    // Current best bid/offer. Published after every book change, so this may be called from any thread
+    // without blocking the matching thread; the feed lives as long as the book.
+    TopOfBook getTopOfBook() const { return topOfBookFeed.load(); }
+    const SeqLock<TopOfBook>& getTopOfBookFeed() const { return topOfBookFeed; }
+
     // For persistence
     std::vector<Order> getAllOrders() const;
 
+    // Visits resting orders in priority order: bids best first, then asks best first, FIFO within a level
+    template <typename Visitor>
+    void forEachOrder(Visitor&& visit) const {
+        for (auto it = bidLevels.rbegin(); it != bidLevels.rend(); ++it) {
+            for (OrderHandle node = it->second.head; node != nullptr; node = node->next) {
+                visit(node->order);
+            }
+        }
+        for (const auto& [price, level] : askLevels) {
+            for (OrderHandle node = level.head; node != nullptr; node = node->next) {
+                visit(node->order);
+            }
+        }
+    }
+    std::size_t getOrderCount() const { return allOrders.size(); }
+
+    // Rests an order as a snapshot recorded it: no matching, and it keeps its sequence number
+    bool restoreOrder(Order order);
+
 private:
-    std::string symbol;
+    Instrument instrument;
     Logger& logger;
     EmailNotifier& emailNotifier;
+    OrderBookListener* listener;
+    MarketDataListener* marketData = nullptr;
+    std::unique_ptr<OrderBookPools> ownedPools; // Only set for a standalone book
+    OrderBookPools& pools;
+    Sequencer ownedSequencer; // Only used by a standalone book
+    Sequencer& sequencer;
 
-    std::priority_queue<Order, std::vector<Order>, CompareBuyOrders> buyOrders;
-    std::priority_queue<Order, std::vector<Order>, CompareSellOrders> sellOrders;
-    std::map<std::string, Order> allOrders; // For quick access by orderId
+    PriceLevelMap bidLevels;
+    PriceLevelMap askLevels;
+    OrderIdMap<OrderHandle> allOrders; // Order handle index by orderId
+    TopOfBook topOfBook; // Matching-thread copy of the last published record
+    SeqLock<TopOfBook> topOfBookFeed;
 
-    std::vector<Trade> matchOrders();
-    void removeOrderFromQueues(const std::string& orderId, OrderType type);
+    // eventTime is the stamp of the inbound add/modify and is reused for every fill it produces
+    void matchOrders(Order& incoming, long long eventTime, FillSink& sink);
+    std::vector<Trade> toTrades(const FillBuffer& fills) const;
+    PriceLevelMap& sideLevels(OrderType type) { return type == BUY ? bidLevels : askLevels; }
+    void insertIntoLevel(OrderHandle node);
+    void unlinkFromLevel(OrderHandle node);
+    void removeOrder(OrderHandle node);
+    void releaseOrder(OrderHandle node); // Drops an unlinked node from the index and returns it to the pool
+    void publishTopOfBook(); // Republishes the best bid/offer if the change moved it
+    void notifyLevel(OrderType side, const PriceLevel& level, LevelChange change) {
+        if (marketData != nullptr) {
+            marketData->onLevelChanged(*this, side, level, change);
+        }
+    }
+    void printLevel(const PriceLevel& level) const;
 };
 
 #endif // ORDER_BOOK_H
-
-
@@ -0,0 +1,824 @@
+#include "OrderGateway.h"
+#include "Trade.h"
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// epoll data of the two descriptors that are not sessions
+const std::uint64_t LISTENER_TAG = ~0ULL;
+const std::uint64_t WAKE_TAG = ~0ULL - 1;
+
+// Splits a request line at commas; false if it has more fields than fields can hold
+bool splitFields(std::string_view line, std::string_view* fields, std::size_t capacity, std::size_t& count) {
+    count = 0;
+    while (true) {
+        if (count == capacity) {
+            return false;
+        }
+        std::size_t comma = line.find(',');
+        fields[count++] = line.substr(0, comma);
+        if (comma == std::string_view::npos) {
+            return true;
+        }
+        line.remove_prefix(comma + 1);
+    }
+}
+
+template <typename T>
+bool parseNumber(std::string_view text, T& value) {
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// A NUL-padded field of a binary message, without the padding
+template <std::size_t N>
+std::string_view fieldView(const char (&field)[N]) {
+    return std::string_view(field, strnlen(field, N));
+}
+
+// Fills a NUL-padded field of a zeroed binary message; longer text is cut
+template <std::size_t N>
+void copyField(char (&field)[N], std::string_view text) {
+    std::memcpy(field, text.data(), std::min(text.size(), N));
+}
+
+const char* rejectReasonText(RejectReason reason) {
+    switch (reason) {
+        case RejectReason::INVALID_ORDER_ID: return "Invalid order ID";
+        case RejectReason::INVALID_SYMBOL: return "Invalid symbol";
+        case RejectReason::INVALID_SIDE: return "Invalid side";
+        case RejectReason::INVALID_PRICE: return "Invalid price";
+        case RejectReason::PRICE_NOT_ON_TICK: return "Price not on tick";
+        case RejectReason::INVALID_QUANTITY: return "Invalid quantity";
+        case RejectReason::UNKNOWN_ORDER: return "Unknown order";
+        default: return "Rejected by engine";
+    }
+}
+
+} // namespace
+
+OrderGateway::OrderGateway(MatchingEngine& matchingEngine, const GatewayOptions& gatewayOptions, TradeLogger* logger)
+    : engine(&matchingEngine), options(gatewayOptions), tradeLogger(logger) {
+    sessions.resize(options.maxSessions);
+    freeSlots.reserve(options.maxSessions);
+    for (std::size_t slot = options.maxSessions; slot > 0; --slot) {
+        freeSlots.push_back(static_cast<std::uint32_t>(slot - 1));
+    }
+    dirtySessions.reserve(options.maxSessions);
+}
+
+OrderGateway::OrderGateway(ShardedEngine& matchingEngine, const GatewayOptions& gatewayOptions)
+    : engine(nullptr), shardedEngine(&matchingEngine), options(gatewayOptions), tradeLogger(nullptr),
+      pendingRequests(matchingEngine.getShardCount()), shardFills(matchingEngine.getShardCount()) {
+    sessions.resize(options.maxSessions);
+    freeSlots.reserve(options.maxSessions);
+    for (std::size_t slot = options.maxSessions; slot > 0; --slot) {
+        freeSlots.push_back(static_cast<std::uint32_t>(slot - 1));
+    }
+    dirtySessions.reserve(options.maxSessions);
+}
+
+#ifdef __linux__
+
+OrderGateway::~OrderGateway() {
+    for (Session& session : sessions) {
+        for (int fd : {session.fd, session.retiredFd}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+    for (int fd : {listenFd, epollFd, wakeFd}) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+    // The ring goes last: closing it cancels whatever it still had outstanding on those sockets
+    receiveBuffers.reset();
+    ring.reset();
+}
+
+bool OrderGateway::start() {
+    if (shardedEngine != nullptr && !shardedEngine->hasEventRings()) {
+        error = "Error: A sharded gateway needs an engine with event rings";
+        return false;
+    }
+    listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd < 0 || wakeFd < 0) {
+        error = std::string("Error: Unable to create gateway sockets: ") + std::strerror(errno);
+        return false;
+    }
+    int on = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (::inet_pton(AF_INET, options.bindAddress.c_str(), &address.sin_addr) != 1) {
+        error = "Error: Invalid gateway bind address " + options.bindAddress;
+        return false;
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, SOMAXCONN) != 0) {
+        error = "Error: Unable to listen on " + options.bindAddress + ":" + std::to_string(options.port) + ": " + std::strerror(errno);
+        return false;
+    }
+    socklen_t length = sizeof(address);
+    ::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length);
+    port = ntohs(address.sin_port);
+
+    if (options.backend == GatewayBackend::IO_URING && shardedEngine != nullptr) {
+        fallbackReason = "sharded engines are served by epoll only";
+    } else if (options.backend == GatewayBackend::IO_URING && startRing()) {
+        backend = GatewayBackend::IO_URING;
+        return true;
+    }
+    backend = GatewayBackend::EPOLL;
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        error = std::string("Error: Unable to create epoll instance: ") + std::strerror(errno);
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.u64 = LISTENER_TAG;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.u64 = WAKE_TAG;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    return true;
+}
+
+void OrderGateway::stop() {
+    stopping.store(true, std::memory_order_release);
+    std::uint64_t one = 1;
+    if (wakeFd >= 0 && ::write(wakeFd, &one, sizeof(one)) < 0) {
+        // The counter is already non-zero, so the loop wakes anyway
+    }
+}
+
+void OrderGateway::run() {
+    if (backend == GatewayBackend::IO_URING) {
+        runRing();
+        return;
+    }
+    std::vector<epoll_event> events(static_cast<std::size_t>(options.maxEventsPerWait));
+    while (!stopping.load(std::memory_order_acquire)) {
+        // Shards answer without waking the loop, so it only sleeps once nothing is outstanding
+        int count = ::epoll_wait(epollFd, events.data(), options.maxEventsPerWait, outstanding > 0 ? 0 : -1);
+        stats.syscalls++;
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("Error: epoll_wait failed: ") + std::strerror(errno);
+            break;
+        }
+        if (count > 0) {
+            stats.wakeups++;
+        }
+        for (int i = 0; i < count; ++i) {
+            const epoll_event& event = events[static_cast<std::size_t>(i)];
+            if (event.data.u64 == LISTENER_TAG) {
+                acceptSessions();
+                continue;
+            }
+            if (event.data.u64 == WAKE_TAG) {
+                continue; // stopping is checked once the wakeup is done
+            }
+            std::uint32_t slot = static_cast<std::uint32_t>(event.data.u64);
+            if (sessions[slot].fd < 0) {
+                continue; // Closed earlier in this wakeup
+            }
+            if (event.events & (EPOLLERR | EPOLLHUP)) {
+                closeSession(slot);
+                continue;
+            }
+            if (event.events & EPOLLOUT) {
+                markDirty(slot); // Sent after the journal commit, with this wakeup's responses
+            }
+            if ((event.events & EPOLLIN) && sessions[slot].fd >= 0) {
+                readSession(slot);
+            }
+        }
+        if (shardedEngine != nullptr && pollShards() == 0 && count == 0) {
+            std::this_thread::yield(); // Let the shards run rather than spin on an empty epoll_wait
+        }
+        flushSessions();
+    }
+}
+
+void OrderGateway::flushSessions() {
+    // Nothing is acknowledged before the journal holds it; then everything this wakeup produced goes
+    // out in one write per session
+    if (!commitJournal()) {
+        return;
+    }
+    if (marketData != nullptr && marketData->flush() > 0) {
+        stats.syscalls += marketData->getSendCalls() - marketDataCallsCounted;
+        marketDataCallsCounted = marketData->getSendCalls();
+    }
+    for (std::uint32_t slot : dirtySessions) {
+        if (sessions[slot].fd >= 0 && sessions[slot].dirty) {
+            writeSession(slot);
+        }
+    }
+    dirtySessions.clear();
+}
+
+void OrderGateway::closeAfterFlush(std::uint32_t slot) {
+    if (commitJournal()) {
+        writeSession(slot);
+    }
+    closeSession(slot);
+}
+
+bool OrderGateway::commitJournal() {
+    if (tradeLogger == nullptr || dirtySessions.empty() || tradeLogger->commit()) {
+        return true;
+    }
+    // Acknowledging now would promise orders a restart cannot restore: drop the responses and stop
+    error = "Error: Journal commit failed; stopped without acknowledging the last requests";
+    stopping.store(true, std::memory_order_release);
+    for (std::uint32_t dirty : dirtySessions) {
+        closeSession(dirty);
+    }
+    dirtySessions.clear();
+    return false;
+}
+
+void OrderGateway::acceptSessions() {
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        stats.syscalls++;
+        if (fd < 0) {
+            return; // EAGAIN once the backlog is empty
+        }
+        std::uint32_t slot = 0;
+        if (!openSession(fd, slot)) {
+            continue;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = slot;
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        stats.syscalls++;
+    }
+}
+
+bool OrderGateway::openSession(int fd, std::uint32_t& slot) {
+    if (freeSlots.empty()) {
+        ::close(fd);
+        stats.syscalls++;
+        return false;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    stats.syscalls++;
+
+    slot = freeSlots.back();
+    freeSlots.pop_back();
+    Session& session = sessions[slot];
+    session.fd = fd;
+    session.protocol = Protocol::UNDECIDED;
+    session.generation++;
+    session.input.resize(options.readBufferBytes);
+    session.inputUsed = 0;
+    session.output.clear();
+    session.outputSent = 0;
+    session.readPaused = false;
+    session.writeWaiting = false;
+    session.dirty = false;
+    stats.sessionsAccepted++;
+    return true;
+}
+
+void OrderGateway::readSession(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    ssize_t received = ::read(session.fd, session.input.data() + session.inputUsed, session.input.size() - session.inputUsed);
+    stats.reads++;
+    stats.syscalls++;
+    if (received <= 0) {
+        if (received < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        // The peer is done sending; answer what it sent before hanging up
+        closeAfterFlush(slot);
+        return;
+    }
+    session.inputUsed += static_cast<std::size_t>(received);
+    receive(slot, nullptr, 0);
+}
+
+void OrderGateway::receive(std::uint32_t slot, const char* data, std::size_t length) {
+    Session& session = sessions[slot];
+    if (length > 0 && session.inputUsed == 0) {
+        // Nothing left over from before: decode straight from where the data landed and keep
+        // only the partial request at its end
+        std::size_t consumed = decode(slot, data, length);
+        if (session.fd >= 0 && consumed < length) {
+            std::memcpy(session.input.data(), data + consumed, length - consumed);
+            session.inputUsed = length - consumed;
+        }
+        return;
+    }
+    if (length > 0) {
+        std::memcpy(session.input.data() + session.inputUsed, data, length);
+        session.inputUsed += length;
+    }
+    std::size_t consumed = decode(slot, session.input.data(), session.inputUsed);
+    if (session.fd < 0) {
+        return; // Closed for a protocol error
+    }
+    // Keep the partial request at the start for the next read
+    if (consumed > 0) {
+        std::memmove(session.input.data(), session.input.data() + consumed, session.inputUsed - consumed);
+        session.inputUsed -= consumed;
+    }
+}
+
+void OrderGateway::writeSession(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    session.dirty = false;
+    if (session.fd < 0) {
+        return;
+    }
+    if (backend == GatewayBackend::IO_URING) {
+        submitSend(slot);
+        return;
+    }
+    if (session.outputSent < session.output.size()) {
+        ssize_t written = ::send(session.fd, session.output.data() + session.outputSent, session.output.size() - session.outputSent, MSG_NOSIGNAL);
+        stats.writes++;
+        stats.syscalls++;
+        if (written < 0 && errno != EAGAIN && errno != EINTR) {
+            closeSession(slot);
+            return;
+        }
+        if (written > 0) {
+            session.outputSent += static_cast<std::size_t>(written);
+        }
+    }
+    if (session.outputSent == session.output.size()) {
+        session.output.clear();
+        session.outputSent = 0;
+    }
+    updateInterest(slot);
+}
+
+void OrderGateway::updateInterest(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    if (backend == GatewayBackend::IO_URING) {
+        std::size_t pending = session.output.size() + session.inFlight.size() - session.outputSent;
+        bool pauseRead = pending >= options.maxPendingOutput;
+        if (pauseRead != session.readPaused) {
+            session.readPaused = pauseRead;
+            if (pauseRead) {
+                cancelReceive(slot);
+            } else if (!session.receiveArmed) {
+                armReceive(slot);
+            }
+        }
+        return;
+    }
+    std::size_t pending = session.output.size() - session.outputSent;
+    bool pauseRead = pending >= options.maxPendingOutput;
+    bool waitWrite = pending > 0;
+    if (pauseRead == session.readPaused && waitWrite == session.writeWaiting) {
+        return;
+    }
+    session.readPaused = pauseRead;
+    session.writeWaiting = waitWrite;
+    epoll_event event{};
+    event.events = (pauseRead ? 0u : static_cast<std::uint32_t>(EPOLLIN)) | (waitWrite ? static_cast<std::uint32_t>(EPOLLOUT) : 0u);
+    event.data.u64 = slot;
+    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+    stats.syscalls++;
+}
+
+void OrderGateway::closeSession(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    if (session.fd < 0) {
+        return; // A failed write already closed it
+    }
+    session.dirty = false;
+    session.output.clear();
+    session.output.shrink_to_fit();
+    stats.sessionsClosed++;
+    if (backend == GatewayBackend::IO_URING) {
+        // Ending the receive side finishes the multishot receive; a send in flight may still complete
+        ::shutdown(session.fd, session.sendInFlight ? SHUT_RD : SHUT_RDWR);
+        stats.syscalls++;
+        session.retiredFd = session.fd;
+        session.fd = -1;
+        releaseSession(slot);
+        return;
+    }
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+    ::close(session.fd);
+    stats.syscalls += 2;
+    session.fd = -1;
+    freeSlots.push_back(slot);
+}
+
+#else
+
+OrderGateway::~OrderGateway() {}
+
+bool OrderGateway::start() {
+    error = "Error: The order gateway needs Linux epoll.";
+    return false;
+}
+
+void OrderGateway::run() {}
+void OrderGateway::stop() {}
+void OrderGateway::flushSessions() {}
+bool OrderGateway::commitJournal() { return false; }
+void OrderGateway::closeAfterFlush(std::uint32_t) {}
+void OrderGateway::acceptSessions() {}
+bool OrderGateway::openSession(int, std::uint32_t&) { return false; }
+void OrderGateway::readSession(std::uint32_t) {}
+void OrderGateway::receive(std::uint32_t, const char*, std::size_t) {}
+void OrderGateway::writeSession(std::uint32_t) {}
+void OrderGateway::updateInterest(std::uint32_t) {}
+void OrderGateway::closeSession(std::uint32_t) {}
+
+#endif // __linux__
+
+std::size_t OrderGateway::decode(std::uint32_t slot, const char* data, std::size_t length) {
+    Session& session = sessions[slot];
+    if (session.protocol != Protocol::UNDECIDED) {
+        return session.protocol == Protocol::BINARY ? decodeBinary(slot, data, length) : decodeText(slot, data, length);
+    }
+    if (length == 0) {
+        return 0;
+    }
+    if (data[0] != BINARY_SESSION_MAGIC[0]) {
+        session.protocol = Protocol::TEXT;
+        return decodeText(slot, data, length);
+    }
+    std::size_t compared = std::min(length, sizeof(BINARY_SESSION_MAGIC));
+    if (std::memcmp(data, BINARY_SESSION_MAGIC, compared) != 0) {
+        protocolError(slot, "ERROR,Unknown protocol");
+        return 0;
+    }
+    if (compared < sizeof(BINARY_SESSION_MAGIC)) {
+        return 0; // The rest of the magic is still on its way
+    }
+    session.protocol = Protocol::BINARY;
+    stats.binarySessions++;
+    queue(slot, BINARY_SESSION_MAGIC, sizeof(BINARY_SESSION_MAGIC));
+    return sizeof(BINARY_SESSION_MAGIC) + decodeBinary(slot, data + sizeof(BINARY_SESSION_MAGIC), length - sizeof(BINARY_SESSION_MAGIC));
+}
+
+std::size_t OrderGateway::decodeText(std::uint32_t slot, const char* data, std::size_t length) {
+    std::size_t consumed = 0;
+    while (consumed < length) {
+        const char* start = data + consumed;
+        const void* newline = std::memchr(start, '\n', length - consumed);
+        if (newline == nullptr) {
+            if (length - consumed > MAX_LINE_LENGTH) {
+                protocolError(slot, "ERROR,Request too long");
+            }
+            break;
+        }
+        std::size_t lineLength = static_cast<std::size_t>(static_cast<const char*>(newline) - start);
+        consumed += lineLength + 1;
+        std::string_view line(start, lineLength);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        stats.messages++;
+        if (!handleText(slot, line)) {
+            reply(slot, std::string("ERROR,Unrecognised request: ").append(line));
+        }
+    }
+    return consumed;
+}
+
+std::size_t OrderGateway::decodeBinary(std::uint32_t slot, const char* data, std::size_t length) {
+    // Messages are used where they lie: the buffer starts 8-aligned and every message size is a
+    // multiple of 8, so each one is aligned for its struct
+    std::size_t consumed = 0;
+    while (length - consumed >= sizeof(BinaryHeader)) {
+        const char* start = data + consumed;
+        const BinaryHeader& header = *reinterpret_cast<const BinaryHeader*>(start);
+        std::size_t size = binaryMessageSize(header.type);
+        bool isRequest = header.type == BinaryMessageType::NEW_ORDER || header.type == BinaryMessageType::CANCEL ||
+                       header.type == BinaryMessageType::MODIFY;
+        if (!isRequest || header.length != size) {
+            // A stream with a bad header cannot be resynchronised
+            protocolError(slot, "");
+            break;
+        }
+        if (length - consumed < size) {
+            break;
+        }
+        consumed += size;
+        stats.messages++;
+        if (header.type == BinaryMessageType::NEW_ORDER) {
+            const BinaryNewOrder& request = *reinterpret_cast<const BinaryNewOrder*>(start);
+            std::string_view orderId = fieldView(request.orderId);
+            if (request.side != BINARY_SIDE_BUY && request.side != BINARY_SIDE_SELL) {
+                reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_SIDE);
+                continue;
+            }
+            std::string_view symbol = fieldView(request.symbol);
+            if (symbol.empty()) {
+                reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_SYMBOL);
+                continue;
+            }
+            SymbolId symbolId = internSymbol(symbol);
+            if (symbolId == INVALID_SYMBOL_ID) {
+                reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_SYMBOL);
+                continue;
+            }
+            placeOrder(slot, orderId, symbolId, request.side == BINARY_SIDE_BUY ? BUY : SELL, request.price, request.quantity);
+        } else if (header.type == BinaryMessageType::MODIFY) {
+            const BinaryModify& request = *reinterpret_cast<const BinaryModify*>(start);
+            modifyOrder(slot, fieldView(request.orderId), request.price, request.quantity);
+        } else {
+            const BinaryCancel& request = *reinterpret_cast<const BinaryCancel*>(start);
+            cancelOrder(slot, fieldView(request.orderId));
+        }
+    }
+    return consumed;
+}
+
+bool OrderGateway::handleText(std::uint32_t slot, std::string_view line) {
+    std::string_view fields[7];
+    std::size_t count = 0;
+    if (!splitFields(line, fields, 7, count)) {
+        return false;
+    }
+    const std::string_view type = fields[0];
+    if (type == "ORDER" && count == 6) {
+        double price = 0;
+        int quantity = 0;
+        bool buy = fields[3] == "BUY" || fields[3] == "buy";
+        if (!buy && fields[3] != "SELL" && fields[3] != "sell") {
+            reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::INVALID_SIDE);
+        } else if (!parseNumber(fields[4], price) || price <= 0) {
+            reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::INVALID_PRICE);
+        } else if (!parseNumber(fields[5], quantity)) {
+            reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::INVALID_QUANTITY);
+        } else if (fields[2].empty()) {
+            reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::INVALID_SYMBOL);
+        } else {
+            SymbolId symbolId = internSymbol(fields[2]);
+            if (symbolId == INVALID_SYMBOL_ID) {
+                reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::INVALID_SYMBOL);
+                return true;
+            }
+            const Instrument& instrument = getSymbols().getInstrument(symbolId);
+            if (!instrument.isOnTick(price)) {
+                reject(slot, BinaryMessageType::NEW_ORDER, fields[1], RejectReason::PRICE_NOT_ON_TICK);
+            } else {
+                placeOrder(slot, fields[1], symbolId, buy ? BUY : SELL, instrument.toTicks(price), quantity);
+            }
+        }
+        return true;
+    }
+    if (type == "MODIFY" && count == 4) {
+        double price = 0;
+        int quantity = 0;
+        std::string id(fields[1]);
+        const Instrument* instrument = getOrderInstrument(id);
+        if (instrument == nullptr || !ownsOrder(slot, id)) {
+            reject(slot, BinaryMessageType::MODIFY, fields[1], RejectReason::UNKNOWN_ORDER);
+        } else if (!parseNumber(fields[2], price) || price <= 0) {
+            reject(slot, BinaryMessageType::MODIFY, fields[1], RejectReason::INVALID_PRICE);
+        } else if (!parseNumber(fields[3], quantity)) {
+            reject(slot, BinaryMessageType::MODIFY, fields[1], RejectReason::INVALID_QUANTITY);
+        } else if (!instrument->isOnTick(price)) {
+            reject(slot, BinaryMessageType::MODIFY, fields[1], RejectReason::PRICE_NOT_ON_TICK);
+        } else {
+            modifyOrder(slot, fields[1], instrument->toTicks(price), quantity);
+        }
+        return true;
+    }
+    if (type == "CANCEL" && count == 2) {
+        cancelOrder(slot, fields[1]);
+        return true;
+    }
+    return false;
+}
+
+void OrderGateway::protocolError(std::uint32_t slot, std::string_view message) {
+    stats.protocolErrors++;
+    if (!message.empty()) {
+        reply(slot, message);
+    }
+    closeAfterFlush(slot);
+}
+
+SymbolId OrderGateway::internSymbol(std::string_view symbol) {
+    return engine != nullptr ? engine->internSymbol(std::string(symbol)) : shardedEngine->internSymbol(std::string(symbol));
+}
+
+const Instrument* OrderGateway::getOrderInstrument(const std::string& orderId) const {
+    if (engine != nullptr) {
+        return engine->getOrderInstrument(orderId);
+    }
+    // The shards' books are theirs alone; the gateway knows the symbol of every order it routed
+    auto owner = owners.find(orderId);
+    return owner != owners.end() ? &shardedEngine->getSymbols().getInstrument(owner->second.symbolId) : nullptr;
+}
+
+void OrderGateway::placeOrder(std::uint32_t slot, std::string_view orderId, SymbolId symbolId, OrderType side, Price price, int quantity) {
+    if (orderId.empty() || orderId.size() > MAX_ORDER_ID_LENGTH) {
+        reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_ORDER_ID);
+        return;
+    }
+    if (price <= 0) {
+        reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_PRICE);
+        return;
+    }
+    if (!getSymbols().getInstrument(symbolId).isValidQuantity(quantity)) {
+        reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::INVALID_QUANTITY);
+        return;
+    }
+
+    std::string id(orderId);
+    Order order(id, symbolId, side, price, quantity);
+    if (shardedEngine != nullptr) {
+        placeSharded(slot, order);
+        return;
+    }
+    if (tradeLogger != nullptr) {
+        tradeLogger->logOrder(order);
+    }
+    fills.clear();
+    if (!engine->placeOrder(std::move(order), fills)) {
+        reject(slot, BinaryMessageType::NEW_ORDER, orderId, RejectReason::ENGINE_REJECTED);
+        return;
+    }
+    acknowledge(slot, BinaryMessageType::NEW_ORDER, orderId);
+    if (engine->hasOrder(id)) {
+        owners[id] = Owner{slot, sessions[slot].generation, symbolId};
+    }
+    reportFills(slot, orderId);
+}
+
+void OrderGateway::modifyOrder(std::uint32_t slot, std::string_view orderId, Price price, int quantity) {
+    std::string id(orderId);
+    if (shardedEngine != nullptr) {
+        modifySharded(slot, id, price, quantity);
+        return;
+    }
+    const Order* resting = engine->findOrder(id);
+    if (resting == nullptr || !ownsOrder(slot, id)) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::UNKNOWN_ORDER);
+        return;
+    }
+    if (price <= 0) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::INVALID_PRICE);
+        return;
+    }
+    if (tradeLogger != nullptr) {
+        tradeLogger->logModifiedOrder(*resting, price, quantity);
+    }
+    fills.clear();
+    if (!engine->modifyOrder(id, price, quantity, fills)) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::ENGINE_REJECTED);
+        return;
+    }
+    acknowledge(slot, BinaryMessageType::MODIFY, orderId);
+    reportFills(slot, orderId);
+    if (!engine->hasOrder(id)) {
+        owners.erase(id);
+    }
+}
+
+void OrderGateway::cancelOrder(std::uint32_t slot, std::string_view orderId) {
+    std::string id(orderId);
+    if (shardedEngine != nullptr) {
+        cancelSharded(slot, id);
+        return;
+    }
+    const Order* resting = engine->findOrder(id);
+    if (resting == nullptr || !ownsOrder(slot, id)) {
+        reject(slot, BinaryMessageType::CANCEL, orderId, RejectReason::UNKNOWN_ORDER);
+        return;
+    }
+    if (tradeLogger != nullptr) {
+        tradeLogger->logCancelledOrder(*resting);
+    }
+    engine->cancelOrder(id);
+    owners.erase(id);
+    acknowledge(slot, BinaryMessageType::CANCEL, orderId);
+}
+
+bool OrderGateway::ownsOrder(std::uint32_t slot, const std::string& orderId) const {
+    auto owner = owners.find(orderId);
+    return owner != owners.end() && owner->second.slot == slot && sessions[slot].generation == owner->second.generation;
+}
+
+void OrderGateway::reportFills(std::uint32_t slot, std::string_view orderId) {
+    for (const Fill& fill : fills.getFills()) {
+        if (tradeLogger != nullptr) {
+            tradeLogger->logTrade(Trade::fromFill(fill));
+        }
+        sendFill(slot, orderId, fill);
+        reportPassiveFill(fill, engine->hasOrder(fill.aggressorSide == BUY ? fill.sellOrderId : fill.buyOrderId));
+    }
+}
+
+void OrderGateway::reportPassiveFill(const Fill& fill, bool passiveResting) {
+    // The passive side hears about it too, if the session that entered it is still connected
+    std::string restingId(fill.aggressorSide == BUY ? fill.sellOrderId : fill.buyOrderId);
+    auto owner = owners.find(restingId);
+    if (owner == owners.end()) {
+        return;
+    }
+    const Session& session = sessions[owner->second.slot];
+    if (session.fd >= 0 && session.generation == owner->second.generation) {
+        sendFill(owner->second.slot, restingId, fill);
+    }
+    if (!passiveResting) {
+        owners.erase(owner);
+    }
+}
+
+void OrderGateway::acknowledge(std::uint32_t slot, BinaryMessageType request, std::string_view orderId) {
+    if (sessions[slot].protocol == Protocol::BINARY) {
+        BinaryAck message{};
+        message.header = BinaryHeader{sizeof(BinaryAck), BinaryMessageType::ACK, 0};
+        message.request = request;
+        copyField(message.orderId, orderId);
+        queue(slot, &message, sizeof(message));
+        return;
+    }
+    const char* prefix = request == BinaryMessageType::NEW_ORDER ? "ACK," : request == BinaryMessageType::MODIFY ? "MODIFIED," : "CANCELED,";
+    reply(slot, std::string(prefix).append(orderId));
+}
+
+void OrderGateway::sendFill(std::uint32_t slot, std::string_view orderId, const Fill& fill) {
+    const std::string& symbol = getSymbols().getName(fill.symbolId);
+    if (sessions[slot].protocol == Protocol::BINARY) {
+        BinaryFill message{};
+        message.header = BinaryHeader{sizeof(BinaryFill), BinaryMessageType::FILL, 0};
+        message.quantity = fill.quantity;
+        message.price = fill.price;
+        message.tradeId = fill.sequence;
+        message.side = orderId == fill.buyOrderId ? BINARY_SIDE_BUY : BINARY_SIDE_SELL;
+        copyField(message.symbol, symbol);
+        copyField(message.orderId, orderId);
+        queue(slot, &message, sizeof(message));
+        return;
+    }
+    std::string message("FILL,");
+    message.append(orderId).append(",").append(std::to_string(fill.sequence)).append(",").append(symbol).append(",")
+           .append(getSymbols().getInstrument(fill.symbolId).formatPrice(fill.price)).append(",").append(std::to_string(fill.quantity));
+    reply(slot, message);
+}
+
+void OrderGateway::reject(std::uint32_t slot, BinaryMessageType request, std::string_view orderId, RejectReason reason) {
+    if (sessions[slot].protocol == Protocol::BINARY) {
+        BinaryReject message{};
+        message.header = BinaryHeader{sizeof(BinaryReject), BinaryMessageType::REJECT, 0};
+        message.reason = reason;
+        message.request = request;
+        copyField(message.orderId, orderId);
+        queue(slot, &message, sizeof(message));
+        return;
+    }
+    std::string message("REJECT,");
+    message.append(orderId).append(",").append(rejectReasonText(reason));
+    reply(slot, message);
+}
+
+void OrderGateway::reply(std::uint32_t slot, std::string_view message) {
+    sessions[slot].output.append(message.data(), message.size());
+    queue(slot, "\n", 1); // Ends the line and counts it as one response
+}
+
+void OrderGateway::queue(std::uint32_t slot, const void* message, std::size_t length) {
+    sessions[slot].output.append(static_cast<const char*>(message), length);
+    stats.responses++;
+    markDirty(slot);
+}
+
+void OrderGateway::markDirty(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    if (!session.dirty) {
+        session.dirty = true;
+        dirtySessions.push_back(slot);
+    }
+}
@@ -0,0 +1,242 @@
+#ifndef ORDER_GATEWAY_H
+#define ORDER_GATEWAY_H
+
+#include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include "Fill.h"
+#include "BinaryProtocol.h"
+#include "TradeLogger.h"
+#include "MarketDataPublisher.h"
+#include "IoUring.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class GatewayBackend {
+    EPOLL,   // Readiness: epoll_wait, then read / send per session
+    IO_URING // Completions: multishot accept and receive into registered buffers, sends queued on the ring
+};
+
+struct GatewayOptions {
+    GatewayBackend backend = GatewayBackend::EPOLL; // IO_URING falls back to EPOLL where it is unavailable
+    std::string bindAddress = "127.0.0.1";
+    std::uint16_t port = 8080;                    // 0 picks a free port; see getPort()
+    std::size_t maxSessions = 1024;
+    std::size_t readBufferBytes = 64 * 1024;      // Per session; one read takes up to this much
+    std::size_t maxPendingOutput = 4 * 1024 * 1024; // A session whose unsent responses reach this is not read until they drain
+    int maxEventsPerWait = 256;
+
+    // IO_URING
+    unsigned uringEntries = 4096;
+    unsigned receiveBufferCount = 256;         // Registered receive buffers shared by all sessions; a power of two
+    std::size_t receiveBufferBytes = 16 * 1024; // Most one receive completion carries
+};
+
+// Counters of the event loop; read them from the loop thread or after run() has returned
+struct GatewayStats {
+    std::uint64_t sessionsAccepted = 0;
+    std::uint64_t sessionsClosed = 0;
+    std::uint64_t messages = 0;       // Requests decoded
+    std::uint64_t responses = 0;      // ACK / FILL / REJECT ... messages queued
+    std::uint64_t wakeups = 0;        // epoll_wait / io_uring_enter calls that returned events
+    std::uint64_t reads = 0;          // read syscalls, or receive completions
+    std::uint64_t writes = 0;         // write syscalls, or sends submitted
+    std::uint64_t syscalls = 0;       // Every system call of the loop, journal commits included
+    std::uint64_t protocolErrors = 0; // Sessions closed for sending something undecodable
+    std::uint64_t binarySessions = 0; // Sessions that negotiated the binary protocol
+};
+
+// Order-entry front end over non-blocking TCP sockets and epoll (Linux only). Sessions stay open
+// for any number of requests, and one read can carry many; every complete request in it goes
+// straight to the engine, and the responses are queued on the session and written once per wakeup,
+// so clients can pipeline without waiting for each answer.
+//
+// Each session picks its protocol with its first bytes: BINARY_SESSION_MAGIC selects the fixed-layout
+// messages of BinaryProtocol.h, decoded in place from the receive buffer; anything else is the
+// newline-framed text protocol below, kept for debugging with nc or telnet. Fills reach each side in
+// the protocol of the session that entered it.
+//
+//   ORDER,<orderId>,<symbol>,BUY|SELL,<price>,<quantity>  ->  ACK,<orderId>  then any FILLs
+//   MODIFY,<orderId>,<price>,<quantity>                   ->  MODIFIED,<orderId>  then any FILLs
+//   CANCEL,<orderId>                                      ->  CANCELED,<orderId>
+//   FILL,<orderId>,<tradeId>,<symbol>,<price>,<quantity>     to the sessions that entered either side
+//   REJECT,<orderId>,<reason>                                for a request the engine refused
+//
+// Only the session that entered an order may modify or cancel it; to any other session, including
+// a later connection of the same client, it is an unknown order.
+//
+// With a TradeLogger, requests are journaled before the engine applies them and the journal is
+// committed once per wakeup, before any of that wakeup's responses are sent. If a commit fails, the
+// sessions waiting on it are closed without their responses and run() returns (see getError).
+// With a MarketDataPublisher, the book changes of a wakeup are published right after that commit.
+//
+// run() is the event loop and the thread calling it is the engine's matching thread.
+//
+// With a ShardedEngine instead, the gateway thread only decodes and answers: it is the single
+// producer of the shards' command rings and the consumer of their event rings, which it polls while
+// requests are outstanding, so matching runs on the shard threads. Answers follow the same protocol,
+// in request order per shard. Such a gateway runs on the epoll backend, and neither journals nor
+// publishes market data.
+class OrderGateway {
+public:
+    OrderGateway(MatchingEngine& engine, const GatewayOptions& options = GatewayOptions(), TradeLogger* tradeLogger = nullptr);
+    // The engine needs event rings; create it with CommandRingMode::SINGLE_PRODUCER unless other
+    // front ends submit too
+    OrderGateway(ShardedEngine& engine, const GatewayOptions& options = GatewayOptions());
+    ~OrderGateway(); // Closes every session and the listener
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    // Binds and listens; false (see getError) if the socket cannot be set up
+    bool start();
+    // Serves sessions until stop(); call after start()
+    void run();
+    // Any thread; run() returns after finishing the current wakeup
+    void stop();
+
+    std::uint16_t getPort() const { return port; }
+    // The backend start() set up, and why it is not the one asked for, if it is not
+    GatewayBackend getBackend() const { return backend; }
+    const std::string& getFallbackReason() const { return fallbackReason; }
+    const GatewayStats& getStats() const { return stats; }
+    const std::string& getError() const { return error; }
+
+    // Flushed once per wakeup; attach it to the engine first. Null (the default) publishes nothing.
+    void setMarketDataPublisher(MarketDataPublisher* publisher) { marketData = publisher; }
+
+private:
+    // Longest text request accepted; a session sending a longer line is closed
+    static const std::size_t MAX_LINE_LENGTH = 256;
+
+    enum class Protocol : std::uint8_t { UNDECIDED, TEXT, BINARY };
+
+    struct Session {
+        int fd = -1;
+        Protocol protocol = Protocol::UNDECIDED;
+        std::uint32_t generation = 0; // Tells a reused slot from the session that held it before
+        std::vector<char> input;
+        std::size_t inputUsed = 0;
+        std::string output;           // Responses not yet written
+        std::size_t outputSent = 0;   // Of output (EPOLL) or of inFlight (IO_URING)
+        bool readPaused = false;      // Too much unsent output; EPOLLIN is off until it drains
+        bool writeWaiting = false;    // EPOLLOUT is on after a short write
+        bool dirty = false;           // Has output queued during this wakeup
+        // IO_URING: the kernel owns inFlight until its send completes, and the slot until no
+        // operation on it is outstanding; a closed session's descriptor waits in retiredFd till then
+        std::string inFlight;
+        bool receiveArmed = false;
+        bool sendInFlight = false;
+        int retiredFd = -1;
+    };
+
+    // Who entered a resting order, so the passive side hears about its fills
+    struct Owner {
+        std::uint32_t slot;
+        std::uint32_t generation;
+        SymbolId symbolId;
+    };
+
+    // Session waiting for a shard's answer
+    struct PendingRequest {
+        std::uint32_t slot;
+        std::uint32_t generation;
+    };
+
+    MatchingEngine* engine;              // Null with a ShardedEngine
+    ShardedEngine* shardedEngine = nullptr;
+    GatewayOptions options;
+    TradeLogger* tradeLogger;
+    MarketDataPublisher* marketData = nullptr;
+    std::uint64_t marketDataCallsCounted = 0;
+    GatewayBackend backend = GatewayBackend::EPOLL;
+    std::string fallbackReason;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::uint16_t port = 0;
+    std::atomic<bool> stopping{false};
+    std::vector<Session> sessions;       // Indexed by slot; the epoll data is the slot
+    std::vector<std::uint32_t> freeSlots;
+    std::vector<std::uint32_t> dirtySessions;
+    std::unordered_map<std::string, Owner> owners; // Resting order ID -> session that entered it
+    FillBuffer fills;
+    // ShardedEngine: requests each shard has yet to answer, oldest first, and the fills of the one
+    // it is answering, held back until its ACCEPTED so the ACK goes out first
+    std::vector<std::deque<PendingRequest>> pendingRequests;
+    std::vector<std::vector<EngineEvent>> shardFills;
+    std::size_t outstanding = 0;
+    GatewayStats stats;
+    std::string error;
+    std::unique_ptr<IoUring> ring;
+    std::unique_ptr<IoUringBufferRing> receiveBuffers;
+    std::uint64_t ringEntersCounted = 0;
+
+    void acceptSessions();
+    bool openSession(int fd, std::uint32_t& slot);
+    void readSession(std::uint32_t slot);
+    void receive(std::uint32_t slot, const char* data, std::size_t length);
+    void writeSession(std::uint32_t slot);
+    void closeSession(std::uint32_t slot);
+    void updateInterest(std::uint32_t slot);
+    bool commitJournal(); // On failure closes this wakeup's sessions unanswered and stops the gateway
+    void flushSessions();
+    void closeAfterFlush(std::uint32_t slot); // Commits, sends what is queued, then closes
+
+    // IO_URING backend (OrderGatewayUring.cpp)
+    bool startRing();
+    void runRing();
+    void complete(std::uint64_t userData, std::int32_t result, std::uint32_t flags);
+    void armAccept();
+    void armWake();
+    void armReceive(std::uint32_t slot);
+    void cancelReceive(std::uint32_t slot);
+    void submitSend(std::uint32_t slot);
+    void releaseSession(std::uint32_t slot);
+
+    // Each returns how many bytes of data it consumed; the session may be closed when they return
+    std::size_t decode(std::uint32_t slot, const char* data, std::size_t length);
+    std::size_t decodeText(std::uint32_t slot, const char* data, std::size_t length);
+    std::size_t decodeBinary(std::uint32_t slot, const char* data, std::size_t length);
+    bool handleText(std::uint32_t slot, std::string_view line);
+    void protocolError(std::uint32_t slot, std::string_view message);
+
+    // Whichever engine the gateway serves
+    const SymbolDirectory& getSymbols() const { return engine != nullptr ? engine->getSymbols() : shardedEngine->getSymbols(); }
+    SymbolId internSymbol(std::string_view symbol);
+    const Instrument* getOrderInstrument(const std::string& orderId) const;
+
+    // Shared by both protocols; prices are ticks
+    void placeOrder(std::uint32_t slot, std::string_view orderId, SymbolId symbolId, OrderType side, Price price, int quantity);
+    void modifyOrder(std::uint32_t slot, std::string_view orderId, Price price, int quantity);
+    void cancelOrder(std::uint32_t slot, std::string_view orderId);
+    void reportFills(std::uint32_t slot, std::string_view orderId);
+    void reportPassiveFill(const Fill& fill, bool passiveResting);
+
+    // ShardedEngine (OrderGatewaySharded.cpp)
+    void placeSharded(std::uint32_t slot, const Order& order);
+    void modifySharded(std::uint32_t slot, const std::string& orderId, Price price, int quantity);
+    void cancelSharded(std::uint32_t slot, const std::string& orderId);
+    // Queues a request the shard of symbolId answers later; a full ring is waited out by taking answers
+    template <typename Submit>
+    bool route(std::uint32_t slot, SymbolId symbolId, Submit submit);
+    std::size_t pollShards(); // Returns how many events it handled
+    void handleEvent(std::size_t shard, const EngineEvent& event);
+    // Only the session that entered a resting order may modify or cancel it; to others it is unknown
+    bool ownsOrder(std::uint32_t slot, const std::string& orderId) const;
+
+    // Responses, formatted for the protocol of the receiving session
+    void acknowledge(std::uint32_t slot, BinaryMessageType request, std::string_view orderId);
+    void sendFill(std::uint32_t slot, std::string_view orderId, const Fill& fill);
+    void reject(std::uint32_t slot, BinaryMessageType request, std::string_view orderId, RejectReason reason);
+    void reply(std::uint32_t slot, std::string_view message); // One text line
+    void queue(std::uint32_t slot, const void* message, std::size_t length);
+    void markDirty(std::uint32_t slot); // Written by flushSessions at the end of the wakeup
+};
+
+#endif // ORDER_GATEWAY_H
@@ -0,0 +1,107 @@
+// ShardedEngine mode of OrderGateway: requests are routed to the shard that owns their symbol and
+// answered from the shards' event rings. Each shard answers in the order it was asked, so a FIFO of
+// pending requests per shard tells which session an ACCEPTED / REJECTED belongs to.
+#include "OrderGateway.h"
+#include <thread>
+
+void OrderGateway::placeSharded(std::uint32_t slot, const Order& order) {
+    // An ID still known here rests, or is on its way, in some shard
+    if (owners.find(order.orderId) != owners.end()) {
+        reject(slot, BinaryMessageType::NEW_ORDER, order.orderId, RejectReason::ENGINE_REJECTED);
+        return;
+    }
+    if (!route(slot, order.symbolId, [&] { return shardedEngine->placeOrder(order); })) {
+        reject(slot, BinaryMessageType::NEW_ORDER, order.orderId, RejectReason::ENGINE_REJECTED);
+        return;
+    }
+    // Owned from now on, so the session may modify or cancel it before the shard has answered
+    owners[order.orderId] = Owner{slot, sessions[slot].generation, order.symbolId};
+}
+
+void OrderGateway::modifySharded(std::uint32_t slot, const std::string& orderId, Price price, int quantity) {
+    if (!ownsOrder(slot, orderId)) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::UNKNOWN_ORDER);
+        return;
+    }
+    if (price <= 0) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::INVALID_PRICE);
+        return;
+    }
+    SymbolId symbolId = owners.find(orderId)->second.symbolId;
+    if (!route(slot, symbolId, [&] { return shardedEngine->modifyOrder(symbolId, orderId, price, quantity); })) {
+        reject(slot, BinaryMessageType::MODIFY, orderId, RejectReason::ENGINE_REJECTED);
+    }
+}
+
+void OrderGateway::cancelSharded(std::uint32_t slot, const std::string& orderId) {
+    if (!ownsOrder(slot, orderId)) {
+        reject(slot, BinaryMessageType::CANCEL, orderId, RejectReason::UNKNOWN_ORDER);
+        return;
+    }
+    SymbolId symbolId = owners.find(orderId)->second.symbolId;
+    if (!route(slot, symbolId, [&] { return shardedEngine->cancelOrder(symbolId, orderId); })) {
+        reject(slot, BinaryMessageType::CANCEL, orderId, RejectReason::ENGINE_REJECTED);
+    }
+}
+
+template <typename Submit>
+bool OrderGateway::route(std::uint32_t slot, SymbolId symbolId, Submit submit) {
+    // A full command ring drains only as fast as this thread takes the shard's answers
+    while (!submit()) {
+        if (!shardedEngine->isRunning()) {
+            return false;
+        }
+        if (pollShards() == 0) {
+            std::this_thread::yield();
+        }
+    }
+    pendingRequests[shardedEngine->shardFor(symbolId)].push_back(PendingRequest{slot, sessions[slot].generation});
+    outstanding++;
+    return true;
+}
+
+std::size_t OrderGateway::pollShards() {
+    std::size_t handled = 0;
+    for (std::size_t shard = 0; shard < pendingRequests.size(); ++shard) {
+        if (!pendingRequests[shard].empty()) {
+            handled += shardedEngine->pollEvents(shard, [this, shard](const EngineEvent& event) { handleEvent(shard, event); });
+        }
+    }
+    return handled;
+}
+
+void OrderGateway::handleEvent(std::size_t shard, const EngineEvent& event) {
+    if (event.type == EngineEventType::FILL) {
+        shardFills[shard].push_back(event);
+        return;
+    }
+    PendingRequest request = pendingRequests[shard].front();
+    pendingRequests[shard].pop_front();
+    outstanding--;
+
+    BinaryMessageType type = event.command == EngineCommandType::PLACE ? BinaryMessageType::NEW_ORDER
+                           : event.command == EngineCommandType::MODIFY ? BinaryMessageType::MODIFY : BinaryMessageType::CANCEL;
+    const Session& session = sessions[request.slot];
+    bool live = session.fd >= 0 && session.generation == request.generation;
+    if (live && event.type == EngineEventType::ACCEPTED) {
+        acknowledge(request.slot, type, event.orderId);
+    } else if (live) {
+        reject(request.slot, type, event.orderId,
+               event.command == EngineCommandType::CANCEL ? RejectReason::UNKNOWN_ORDER : RejectReason::ENGINE_REJECTED);
+    }
+    for (const EngineEvent& fill : shardFills[shard]) {
+        if (live) {
+            sendFill(request.slot, event.orderId, fill.fill);
+        }
+        reportPassiveFill(fill.fill, fill.resting);
+    }
+    shardFills[shard].clear();
+
+    // A rejected modify or cancel leaves the order as it was; anything else that no longer rests is forgotten
+    if (event.type == EngineEventType::ACCEPTED ? !event.resting : event.command == EngineCommandType::PLACE) {
+        auto owner = owners.find(event.orderId);
+        if (owner != owners.end() && owner->second.generation == request.generation && owner->second.slot == request.slot) {
+            owners.erase(owner);
+        }
+    }
+}
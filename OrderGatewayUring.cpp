@@ -0,0 +1,254 @@
+// io_uring backend of OrderGateway: the listener and every session keep a multishot operation
+// armed, so a wakeup is one io_uring_enter that both submits the sends queued since the last one
+// and collects whatever arrived, instead of epoll_wait plus a read and a send per session.
+#include "OrderGateway.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#ifdef ENGINE_HAS_IO_URING
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef ENGINE_HAS_IO_URING
+
+namespace {
+
+// What a completion belongs to: the top byte of user_data, with the session slot in the low bits
+enum RingOp : std::uint64_t { OP_ACCEPT = 1, OP_WAKE = 2, OP_RECEIVE = 3, OP_SEND = 4, OP_CANCEL = 5 };
+
+std::uint64_t ringTag(RingOp op, std::uint32_t slot = 0) {
+    return (static_cast<std::uint64_t>(op) << 56) | slot;
+}
+
+const std::uint16_t RECEIVE_BUFFER_GROUP = 1;
+
+} // namespace
+
+bool OrderGateway::startRing() {
+    ring = std::make_unique<IoUring>();
+    // Multishot operations post many completions per entry, so the completion ring is the larger one
+    if (!ring->init(options.uringEntries, options.uringEntries * 4)) {
+        fallbackReason = ring->getError();
+        ring.reset();
+        return false;
+    }
+    // Provided-buffer rings need Linux 5.19; multishot accept and receive need 6.0
+    receiveBuffers = std::make_unique<IoUringBufferRing>();
+    if (!receiveBuffers->init(*ring, RECEIVE_BUFFER_GROUP, options.receiveBufferCount, options.receiveBufferBytes)) {
+        fallbackReason = receiveBuffers->getError();
+        receiveBuffers.reset();
+        ring.reset();
+        return false;
+    }
+    // A session's input holds a partial request plus one receive buffer appended to it
+    options.readBufferBytes = std::max(options.readBufferBytes, options.receiveBufferBytes + MAX_LINE_LENGTH + sizeof(BinaryNewOrder));
+    armAccept();
+    armWake();
+    return true;
+}
+
+void OrderGateway::runRing() {
+    while (!stopping.load(std::memory_order_acquire)) {
+        bool submitted = ring->submit(1);
+        stats.syscalls += ring->getEnterCount() - ringEntersCounted;
+        ringEntersCounted = ring->getEnterCount();
+        if (!submitted) {
+            error = "Error: " + ring->getError();
+            break;
+        }
+        unsigned count = ring->reap([this](const io_uring_cqe& cqe) { complete(cqe.user_data, cqe.res, cqe.flags); });
+        if (count == 0) {
+            continue;
+        }
+        stats.wakeups++;
+        flushSessions();
+    }
+}
+
+void OrderGateway::complete(std::uint64_t userData, std::int32_t result, std::uint32_t flags) {
+    const RingOp op = static_cast<RingOp>(userData >> 56);
+    const std::uint32_t slot = static_cast<std::uint32_t>(userData);
+    const bool more = (flags & IORING_CQE_F_MORE) != 0;
+
+    if (op == OP_ACCEPT) {
+        std::uint32_t opened = 0;
+        if (result >= 0 && openSession(result, opened)) {
+            armReceive(opened);
+        }
+        if (result == -EINVAL) {
+            error = "Error: The kernel does not support multishot accept";
+            stopping.store(true, std::memory_order_release);
+        } else if (!more) {
+            armAccept();
+        }
+        return;
+    }
+    if (op == OP_WAKE) {
+        if (!stopping.load(std::memory_order_acquire)) {
+            armWake();
+        }
+        return;
+    }
+    if (op != OP_RECEIVE && op != OP_SEND) {
+        return; // A cancel request's own completion
+    }
+
+    Session& session = sessions[slot];
+    if (op == OP_SEND) {
+        session.sendInFlight = false;
+        if (session.fd < 0) {
+            releaseSession(slot);
+        } else if (result < 0) {
+            closeSession(slot);
+        } else {
+            session.outputSent += static_cast<std::size_t>(result);
+            if (session.outputSent < session.inFlight.size()) {
+                submitSend(slot); // The rest of a short send; nothing new is sent before the next commit
+            } else if (!session.output.empty()) {
+                markDirty(slot);
+            } else {
+                session.inFlight.clear();
+                session.outputSent = 0;
+                updateInterest(slot);
+            }
+        }
+        return;
+    }
+
+    if (!more) {
+        session.receiveArmed = false;
+    }
+    if (result > 0) {
+        unsigned id = IoUringBufferRing::bufferId(flags);
+        if (session.fd >= 0) {
+            stats.reads++;
+            receive(slot, receiveBuffers->data(id), static_cast<std::size_t>(result));
+        }
+        receiveBuffers->recycle(id);
+    } else if (result != -ENOBUFS && result != -ECANCELED && session.fd >= 0) {
+        // The peer is done sending (or the socket failed); answer what it sent before hanging up
+        closeAfterFlush(slot);
+    }
+    if (!session.receiveArmed) {
+        if (session.fd < 0) {
+            releaseSession(slot);
+        } else if (!session.readPaused) {
+            armReceive(slot); // Out of buffers, or the kernel ended the multishot
+        }
+    }
+}
+
+void OrderGateway::armAccept() {
+    io_uring_sqe* sqe = ring->getSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = ringTag(OP_ACCEPT);
+}
+
+void OrderGateway::armWake() {
+    io_uring_sqe* sqe = ring->getSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeFd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = ringTag(OP_WAKE);
+}
+
+void OrderGateway::armReceive(std::uint32_t slot) {
+    io_uring_sqe* sqe = ring->getSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    // Each completion carries one registered buffer the kernel picked from the group
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sessions[slot].fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = receiveBuffers->getGroup();
+    sqe->user_data = ringTag(OP_RECEIVE, slot);
+    sessions[slot].receiveArmed = true;
+}
+
+void OrderGateway::cancelReceive(std::uint32_t slot) {
+    if (!sessions[slot].receiveArmed) {
+        return;
+    }
+    io_uring_sqe* sqe = ring->getSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = ringTag(OP_RECEIVE, slot);
+    sqe->user_data = ringTag(OP_CANCEL, slot);
+}
+
+void OrderGateway::submitSend(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    if (session.sendInFlight || session.fd < 0) {
+        return; // The completion sends the rest
+    }
+    if (session.outputSent == session.inFlight.size()) {
+        session.inFlight.clear();
+        session.outputSent = 0;
+        if (session.output.empty()) {
+            updateInterest(slot);
+            return;
+        }
+        // Responses queued from now on go to the other string, so the one being sent stays put
+        session.inFlight.swap(session.output);
+    }
+    io_uring_sqe* sqe = ring->getSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = session.fd;
+    sqe->addr = reinterpret_cast<std::uint64_t>(session.inFlight.data() + session.outputSent);
+    sqe->len = static_cast<std::uint32_t>(session.inFlight.size() - session.outputSent);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = ringTag(OP_SEND, slot);
+    session.sendInFlight = true;
+    stats.writes++;
+    updateInterest(slot);
+}
+
+void OrderGateway::releaseSession(std::uint32_t slot) {
+    Session& session = sessions[slot];
+    if (session.retiredFd < 0 || session.receiveArmed || session.sendInFlight) {
+        return; // The kernel still has an operation on it
+    }
+    ::close(session.retiredFd);
+    stats.syscalls++;
+    session.retiredFd = -1;
+    session.inFlight.clear();
+    session.inFlight.shrink_to_fit();
+    session.outputSent = 0;
+    freeSlots.push_back(slot);
+}
+
+#else
+
+bool OrderGateway::startRing() {
+    fallbackReason = "io_uring is not available on this platform";
+    return false;
+}
+
+void OrderGateway::runRing() {}
+void OrderGateway::complete(std::uint64_t, std::int32_t, std::uint32_t) {}
+void OrderGateway::armAccept() {}
+void OrderGateway::armWake() {}
+void OrderGateway::armReceive(std::uint32_t) {}
+void OrderGateway::cancelReceive(std::uint32_t) {}
+void OrderGateway::submitSend(std::uint32_t) {}
+void OrderGateway::releaseSession(std::uint32_t) {}
+
+#endif // ENGINE_HAS_IO_URING
@@ -0,0 +1,186 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// Cursors that different threads write are padded to this so they never share a line
+const std::size_t CACHE_LINE_SIZE = 64;
+
+inline std::size_t roundUpToPowerOfTwo(std::size_t value) {
+    std::size_t capacity = 2;
+    while (capacity < value) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Bounded single-producer/single-consumer ring. Producer and consumer each own one index on its
+// own cache line and keep a cached copy of the other's, so the shared lines are only touched
+// when the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "Ring slots must be trivially copyable");
+
+public:
+    explicit SpscRing(std::size_t minCapacity)
+        : capacity(roundUpToPowerOfTwo(minCapacity)), mask(capacity - 1), slots(new T[capacity]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer thread only
+    bool tryPush(const T& value) {
+        const std::size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cachedOther == capacity) {
+            producer.cachedOther = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cachedOther == capacity) {
+                return false;
+            }
+        }
+        slots[tail & mask] = value;
+        producer.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool tryPop(T& value) {
+        const std::size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cachedOther) {
+            consumer.cachedOther = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cachedOther) {
+                return false;
+            }
+        }
+        value = slots[head & mask];
+        consumer.index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only: hands up to maxItems slots to handler and releases them with one store.
+    // The producer's index is only re-read when the cached one cannot fill the batch.
+    template <typename Handler>
+    std::size_t drain(Handler&& handler, std::size_t maxItems) {
+        const std::size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (consumer.cachedOther - head < maxItems) {
+            consumer.cachedOther = producer.index.load(std::memory_order_acquire);
+        }
+        std::size_t available = consumer.cachedOther - head;
+        std::size_t count = available < maxItems ? available : maxItems;
+        for (std::size_t i = 0; i < count; ++i) {
+            handler(slots[(head + i) & mask]);
+        }
+        if (count > 0) {
+            consumer.index.store(head + count, std::memory_order_release);
+        }
+        return count;
+    }
+
+    std::size_t getCapacity() const { return capacity; }
+    // Approximate when called while the other side is running
+    std::size_t size() const {
+        return producer.index.load(std::memory_order_acquire) - consumer.index.load(std::memory_order_acquire);
+    }
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Cursor {
+        std::atomic<std::size_t> index{0};
+        std::size_t cachedOther = 0; // Last seen value of the opposite cursor
+    };
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    std::unique_ptr<T[]> slots;
+    Cursor producer;
+    Cursor consumer;
+};
+
+// Bounded multi-producer/single-consumer ring (Vyukov's bounded queue). Each slot carries a
+// sequence number: producers claim a position with one CAS and publish the slot by bumping its
+// sequence, so a slow producer never blocks the others from claiming later slots.
+template <typename T>
+class MpscRing {
+    static_assert(std::is_trivially_copyable<T>::value, "Ring slots must be trivially copyable");
+
+public:
+    explicit MpscRing(std::size_t minCapacity)
+        : capacity(roundUpToPowerOfTwo(minCapacity)), mask(capacity - 1), cells(new Cell[capacity]) {
+        for (std::size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread
+    bool tryPush(const T& value) {
+        std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[position & mask];
+            const std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const std::intptr_t difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(position);
+            if (difference == 0) {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                return false; // Full
+            } else {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only
+    bool tryPop(T& value) {
+        Cell& cell = cells[dequeuePosition & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+            return false; // Empty, or the next slot is claimed but not yet published
+        }
+        value = cell.value;
+        cell.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+        dequeuePosition++;
+        return true;
+    }
+
+    // Consumer thread only: hands up to maxItems published slots to handler in order
+    template <typename Handler>
+    std::size_t drain(Handler&& handler, std::size_t maxItems) {
+        std::size_t count = 0;
+        while (count < maxItems) {
+            Cell& cell = cells[dequeuePosition & mask];
+            if (cell.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+                break;
+            }
+            handler(cell.value);
+            cell.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+            dequeuePosition++;
+            count++;
+        }
+        return count;
+    }
+
+    std::size_t getCapacity() const { return capacity; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    const std::size_t capacity;
+    const std::size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueuePosition{0};
+    alignas(CACHE_LINE_SIZE) std::size_t dequeuePosition = 0;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,79 @@
+#ifndef SEQ_LOCK_H
+#define SEQ_LOCK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer, many-reader publication of a small trivially copyable value. The writer never
+// waits; readers copy the value without locking and retry if a write overlapped the copy.
+// The payload is held in atomic words so concurrent reads are well defined; on x86 every
+// access below compiles to a plain load or store.
+template <typename T>
+class alignas(64) SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values must be trivially copyable");
+
+public:
+    SeqLock() {
+        for (auto& word : words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    explicit SeqLock(const T& initial) : SeqLock() { store(initial); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Writer side; only one thread may store
+    void store(const T& value) {
+        std::uint64_t buffer[WORD_COUNT] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const std::uint64_t start = version.load(std::memory_order_relaxed);
+        version.store(start + 1, std::memory_order_relaxed); // Odd: write in progress
+        // Release keeps the odd version ahead of each word, so a reader that sees a new word sees the odd version too
+        for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+            words[i].store(buffer[i], std::memory_order_release);
+        }
+        version.store(start + 2, std::memory_order_release);
+    }
+
+    // Reader side; safe from any thread, spins only while a store is in flight
+    T load() const {
+        T value;
+        while (!tryLoad(value)) {
+        }
+        return value;
+    }
+
+    // Single attempt; returns false if it raced with a store
+    bool tryLoad(T& value) const {
+        const std::uint64_t before = version.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        std::uint64_t buffer[WORD_COUNT];
+        for (std::size_t i = 0; i < WORD_COUNT; ++i) {
+            buffer[i] = words[i].load(std::memory_order_acquire);
+        }
+        if (version.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&value, buffer, sizeof(T));
+        return true;
+    }
+
+    // Number of completed stores
+    std::uint64_t getVersion() const { return version.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t WORD_COUNT = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+    std::atomic<std::uint64_t> version{0};
+    std::atomic<std::uint64_t> words[WORD_COUNT];
+};
+
+#endif // SEQ_LOCK_H
@@ -0,0 +1,20 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <cstdint>
+
+// Engine-wide, gap-free event sequence. Every accepted order, modify, fill and cancel takes the
+// next number, so consumers can order, dedupe and detect gaps without string IDs.
+class Sequencer {
+public:
+    std::uint64_t next() { return ++last; }
+    std::uint64_t getLast() const { return last; }
+
+    // Continue numbering after a restored state (journal replay, snapshots)
+    void resetTo(std::uint64_t value) { last = value; }
+
+private:
+    std::uint64_t last = 0;
+};
+
+#endif // SEQUENCER_H
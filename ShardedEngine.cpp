@@ -0,0 +1,394 @@
+#include "ShardedEngine.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Commands a shard executes between two looks at its ring
+static const std::size_t COMMAND_BATCH = 256;
+// Empty polls before an idle shard starts yielding, then sleeping
+static const std::size_t SPIN_POLLS = 1024;
+static const std::size_t YIELD_POLLS = 2048;
+static const std::chrono::microseconds IDLE_SLEEP(50);
+// Per-shard log ring; matching threads hand messages to the shard's log writer thread
+static const std::size_t SHARD_LOG_RING_CAPACITY = 16384;
+
+namespace {
+
+// Used for shards nobody asked to hear fills from
+class DiscardFillSink : public FillSink {
+public:
+    void onFill(const Fill&) override {}
+};
+
+DiscardFillSink discardFills;
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+void backOff(std::size_t& idlePolls) {
+    idlePolls++;
+    if (idlePolls < SPIN_POLLS) {
+        return;
+    }
+    if (idlePolls < YIELD_POLLS) {
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(IDLE_SLEEP);
+    }
+}
+
+bool copyText(char (&destination)[MAX_ORDER_ID_LENGTH + 1], const std::string& text) {
+    if (text.size() > MAX_ORDER_ID_LENGTH) {
+        return false;
+    }
+    copyOrderId(destination, text);
+    return true;
+}
+
+EngineCommand makeCommand(EngineCommandType type, SymbolId symbolId) {
+    EngineCommand command;
+    std::memset(&command, 0, sizeof(command));
+    command.type = type;
+    command.symbolId = symbolId;
+    return command;
+}
+
+} // namespace
+
+ShardedEngine::Shard::Shard(std::size_t shardIndex, EmailNotifier& notifier, const ShardedEngineOptions& options)
+    : index(shardIndex), logger(options.logPrefix + std::to_string(shardIndex) + ".log", SHARD_LOG_RING_CAPACITY, LogOverflowPolicy::COUNT),
+      engine(logger, notifier, options.orderCapacityPerShard),
+      sharedCommands(options.producers == CommandRingMode::MULTI_PRODUCER ? std::make_unique<MpscRing<EngineCommand>>(options.commandRingCapacity) : nullptr),
+      ownCommands(options.producers == CommandRingMode::SINGLE_PRODUCER ? std::make_unique<SpscRing<EngineCommand>>(options.commandRingCapacity) : nullptr),
+      events(options.eventRingCapacity > 0 ? std::make_unique<SpscRing<EngineEvent>>(options.eventRingCapacity) : nullptr),
+      sink(events ? static_cast<FillSink*>(&requestFills) : &discardFills) {}
+
+bool ShardedEngine::Shard::tryPush(const EngineCommand& command) {
+    return sharedCommands ? sharedCommands->tryPush(command) : ownCommands->tryPush(command);
+}
+
+ShardedEngine::ShardedEngine(EmailNotifier& notifier, const ShardedEngineOptions& options)
+    : symbolStates(new std::atomic<std::uint8_t>[MAX_SHARDED_SYMBOLS]) {
+    for (std::size_t i = 0; i < MAX_SHARDED_SYMBOLS; ++i) {
+        symbolStates[i].store(OPEN, std::memory_order_relaxed);
+    }
+    std::size_t shardCount = options.shardCount > 0 ? options.shardCount : 1;
+    shards.reserve(shardCount);
+    for (std::size_t i = 0; i < shardCount; ++i) {
+        shards.push_back(std::make_unique<Shard>(i, notifier, options));
+    }
+}
+
+ShardedEngine::~ShardedEngine() {
+    stop();
+}
+
+void ShardedEngine::setFillSink(std::size_t shard, FillSink* sink) {
+    if (running || shard >= shards.size()) {
+        return;
+    }
+    Shard& target = *shards[shard];
+    if (sink != nullptr) {
+        target.sink = sink;
+    } else {
+        target.sink = target.events ? static_cast<FillSink*>(&target.requestFills) : &discardFills;
+    }
+}
+
+void ShardedEngine::start(const std::vector<int>& shardCpus) {
+    if (running) {
+        return;
+    }
+    // Set first: from here on the backlogs belong to the shard threads
+    running = true;
+    for (auto& shard : shards) {
+        int cpu = shard->index < shardCpus.size() ? shardCpus[shard->index] : -1;
+        shard->stopping.store(false, std::memory_order_relaxed);
+        shard->thread = std::thread(&ShardedEngine::run, this, std::ref(*shard), cpu);
+    }
+}
+
+void ShardedEngine::stop() {
+    if (!running) {
+        return;
+    }
+    for (auto& shard : shards) {
+        shard->stopping.store(true, std::memory_order_release);
+    }
+    for (auto& shard : shards) {
+        shard->thread.join();
+    }
+    running = false;
+}
+
+SymbolId ShardedEngine::internSymbol(const std::string& symbol) {
+    SymbolId symbolId = symbols.find(symbol);
+    return symbolId != INVALID_SYMBOL_ID ? symbolId : addSymbol(symbol, 0, 0);
+}
+
+bool ShardedEngine::setInstrument(const std::string& symbol, double tickSize, int lotSize) {
+    if (tickSize <= 0 || lotSize <= 0) {
+        return false;
+    }
+    SymbolId symbolId = symbols.find(symbol);
+    if (symbolId == INVALID_SYMBOL_ID) {
+        return addSymbol(symbol, tickSize, lotSize) != INVALID_SYMBOL_ID;
+    }
+    std::uint8_t open = OPEN;
+    if (!symbolStates[symbolId].compare_exchange_strong(open, CONFIGURING, std::memory_order_acq_rel)) {
+        return false; // Already traded
+    }
+    symbols.setInstrument(symbolId, tickSize, lotSize);
+    EngineCommand command = makeCommand(EngineCommandType::SET_INSTRUMENT, symbolId);
+    copyText(command.text, symbol);
+    command.tickSize = tickSize;
+    command.lotSize = lotSize;
+    pushControl(*shards[shardFor(symbolId)], command);
+    // Pending ahead of any PLACE that sees the symbol open again
+    symbolStates[symbolId].store(OPEN, std::memory_order_release);
+    return true;
+}
+
+SymbolId ShardedEngine::addSymbol(const std::string& symbol, double tickSize, int lotSize) {
+    if (symbol.size() > MAX_ORDER_ID_LENGTH || symbols.size() >= MAX_SHARDED_SYMBOLS) {
+        return INVALID_SYMBOL_ID;
+    }
+    SymbolId symbolId = symbols.intern(symbol);
+    EngineCommand command = makeCommand(EngineCommandType::REGISTER_SYMBOL, symbolId);
+    copyText(command.text, symbol);
+    for (auto& shard : shards) {
+        pushControl(*shard, command);
+    }
+    if (tickSize > 0) {
+        symbols.setInstrument(symbolId, tickSize, lotSize);
+        command.type = EngineCommandType::SET_INSTRUMENT;
+        command.tickSize = tickSize;
+        command.lotSize = lotSize;
+        pushControl(*shards[shardFor(symbolId)], command);
+    }
+    symbolCount.store(symbols.size(), std::memory_order_release);
+    return symbolId;
+}
+
+bool ShardedEngine::placeOrder(const Order& order) {
+    EngineCommand command = makeCommand(EngineCommandType::PLACE, order.getSymbolId());
+    command.side = order.getType();
+    command.price = order.getPrice();
+    command.quantity = order.getQuantity();
+    command.timestamp = order.getTimestamp();
+    return copyText(command.text, order.getOrderId()) && submit(command);
+}
+
+bool ShardedEngine::modifyOrder(SymbolId symbolId, const std::string& orderId, Price newPrice, int newQuantity) {
+    EngineCommand command = makeCommand(EngineCommandType::MODIFY, symbolId);
+    command.price = newPrice;
+    command.quantity = newQuantity;
+    return copyText(command.text, orderId) && submit(command);
+}
+
+bool ShardedEngine::cancelOrder(SymbolId symbolId, const std::string& orderId) {
+    EngineCommand command = makeCommand(EngineCommandType::CANCEL, symbolId);
+    return copyText(command.text, orderId) && submit(command);
+}
+
+bool ShardedEngine::submit(const EngineCommand& command) {
+    if (!running || command.symbolId >= symbolCount.load(std::memory_order_acquire)) {
+        return false;
+    }
+    if (command.type != EngineCommandType::PLACE && command.type != EngineCommandType::MODIFY && command.type != EngineCommandType::CANCEL) {
+        return false; // Symbol commands only come from internSymbol / setInstrument
+    }
+    if (command.type == EngineCommandType::PLACE && !markTraded(command.symbolId)) {
+        return false;
+    }
+    Shard& shard = *shards[shardFor(command.symbolId)];
+    if (!shard.tryPush(command)) {
+        return false;
+    }
+    shard.submitted.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool ShardedEngine::markTraded(SymbolId symbolId) {
+    std::atomic<std::uint8_t>& state = symbolStates[symbolId];
+    std::uint8_t current = state.load(std::memory_order_acquire);
+    while (current != TRADED) {
+        if (current == CONFIGURING) {
+            return false;
+        }
+        if (state.compare_exchange_weak(current, TRADED, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            break;
+        }
+    }
+    return true;
+}
+
+void ShardedEngine::pushControl(Shard& shard, const EngineCommand& command) {
+    std::lock_guard<std::mutex> lock(shard.controlMutex);
+    shard.control.push_back(command);
+    shard.controlPending.store(shard.control.size(), std::memory_order_release);
+}
+
+void ShardedEngine::applyControl(Shard& shard) {
+    if (shard.controlPending.load(std::memory_order_acquire) == 0) {
+        return;
+    }
+    std::vector<EngineCommand> commands;
+    {
+        std::lock_guard<std::mutex> lock(shard.controlMutex);
+        commands.swap(shard.control);
+        shard.controlPending.store(0, std::memory_order_relaxed);
+    }
+    for (const EngineCommand& command : commands) {
+        if (command.type == EngineCommandType::REGISTER_SYMBOL) {
+            shard.engine.internSymbol(command.text);
+        } else {
+            shard.engine.setInstrument(command.text, command.tickSize, command.lotSize);
+        }
+    }
+}
+
+void ShardedEngine::waitUntilIdle() const {
+    for (const auto& shard : shards) {
+        std::uint64_t target = shard->submitted.load(std::memory_order_acquire);
+        while (running && shard->processed.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+std::uint64_t ShardedEngine::getProcessedCount() const {
+    std::uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->processed.load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+std::uint64_t ShardedEngine::getRejectedCount() const {
+    std::uint64_t total = 0;
+    for (const auto& shard : shards) {
+        total += shard->rejected.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void ShardedEngine::run(Shard& shard, int cpu) {
+    if (cpu >= 0 && !pinCurrentThread(cpu)) {
+        shard.logger.log("Warning: Could not pin shard " + std::to_string(shard.index) + " to CPU " + std::to_string(cpu));
+    }
+
+    std::size_t idlePolls = 0;
+    while (true) {
+        // Read the stop flag first, so a ring found empty afterwards really is drained
+        bool stopping = shard.stopping.load(std::memory_order_acquire);
+        applyControl(shard);
+        // With events still waiting for room, take no new commands; the command ring fills up and
+        // submissions fail instead. Once stopping, the ring is drained regardless.
+        if (!flushBacklog(shard) && !stopping) {
+            backOff(idlePolls);
+            continue;
+        }
+        std::size_t count = shard.drain([&](const EngineCommand& command) {
+            try {
+                execute(shard, command);
+            } catch (const std::exception& ex) {
+                shard.rejected.fetch_add(1, std::memory_order_relaxed);
+                shard.logger.log(std::string("Exception in shard ") + std::to_string(shard.index) + ": " + ex.what());
+                std::ofstream errLog("error.log", std::ios::app); errLog << "Exception in shard " << shard.index << ": " << ex.what() << "\n";
+            }
+        }, COMMAND_BATCH);
+
+        if (count > 0) {
+            shard.processed.fetch_add(count, std::memory_order_release);
+            idlePolls = 0;
+        } else if (stopping) {
+            break;
+        } else {
+            backOff(idlePolls);
+        }
+    }
+}
+
+void ShardedEngine::execute(Shard& shard, const EngineCommand& command) {
+    // A symbol is registered before its ID is published, so its control command is pending by now
+    applyControl(shard);
+    shard.requestFills.clear();
+    bool accepted = true;
+    switch (command.type) {
+        case EngineCommandType::PLACE: {
+            Order order(command.text, command.symbolId, command.side, command.price, command.quantity);
+            order.timestamp = command.timestamp;
+            accepted = shard.engine.placeOrder(std::move(order), *shard.sink);
+            break;
+        }
+        case EngineCommandType::MODIFY:
+            accepted = shard.engine.modifyOrder(command.text, command.price, command.quantity, *shard.sink);
+            break;
+        case EngineCommandType::CANCEL:
+            accepted = shard.engine.cancelOrder(command.text);
+            break;
+        default:
+            accepted = false; // Symbol commands only travel through the control queues
+            break;
+    }
+    if (!accepted) {
+        shard.rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!shard.events) {
+        return;
+    }
+    EngineEvent event;
+    std::memset(&event, 0, sizeof(event));
+    // Published after the request, so each can say whether its passive order survived it
+    for (const Fill& fill : shard.requestFills.getFills()) {
+        event.type = EngineEventType::FILL;
+        event.symbolId = fill.symbolId;
+        std::memcpy(event.orderId, fill.aggressorSide == BUY ? fill.buyOrderId : fill.sellOrderId, sizeof(event.orderId));
+        event.resting = shard.engine.hasOrder(fill.aggressorSide == BUY ? fill.sellOrderId : fill.buyOrderId);
+        event.fill = fill;
+        publish(shard, event);
+    }
+    std::memset(&event, 0, sizeof(event));
+    event.type = accepted ? EngineEventType::ACCEPTED : EngineEventType::REJECTED;
+    event.command = command.type;
+    event.symbolId = command.symbolId;
+    event.resting = accepted && command.type != EngineCommandType::CANCEL && shard.engine.hasOrder(command.text);
+    std::memcpy(event.orderId, command.text, sizeof(event.orderId));
+    publish(shard, event);
+}
+
+void ShardedEngine::publish(Shard& shard, const EngineEvent& event) {
+    // Events are never dropped or reordered: once one waits, the rest queue behind it
+    if (shard.backlogHead < shard.backlog.size() || !shard.events->tryPush(event)) {
+        shard.backlog.push_back(event);
+    }
+}
+
+bool ShardedEngine::flushBacklog(Shard& shard) {
+    while (shard.backlogHead < shard.backlog.size() && shard.events->tryPush(shard.backlog[shard.backlogHead])) {
+        shard.backlogHead++;
+    }
+    if (shard.backlogHead < shard.backlog.size()) {
+        return false;
+    }
+    shard.backlog.clear();
+    shard.backlogHead = 0;
+    return true;
+}
@@ -0,0 +1,196 @@
+#ifndef SHARDED_ENGINE_H
+#define SHARDED_ENGINE_H
+
+#include "MatchingEngine.h"
+#include "SymbolDirectory.h"
+#include "RingBuffer.h"
+#include "Fill.h"
+#include "Logger.h"
+#include "EmailNotifier.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+const std::size_t MAX_SHARDED_SYMBOLS = 65536;
+
+enum class EngineCommandType : std::uint8_t { REGISTER_SYMBOL, SET_INSTRUMENT, PLACE, MODIFY, CANCEL };
+
+// Fixed-size request slot carried by the command rings. text holds the order ID, or the symbol
+// name for REGISTER_SYMBOL / SET_INSTRUMENT, which reach the shards through their control queues.
+struct EngineCommand {
+    EngineCommandType type;
+    OrderType side;
+    SymbolId symbolId;
+    std::int32_t quantity;
+    std::int32_t lotSize;
+    Price price;
+    double tickSize;
+    long long timestamp; // Entry stamp of a PLACE, kept so time priority reflects arrival at the front end
+    char text[MAX_ORDER_ID_LENGTH + 1];
+};
+
+enum class EngineEventType : std::uint8_t { ACCEPTED, REJECTED, FILL };
+
+// Fixed-size result slot carried by the event rings. The fills a request produces are published
+// before the ACCEPTED that answers it.
+struct EngineEvent {
+    EngineEventType type;
+    EngineCommandType command; // Request an ACCEPTED / REJECTED answers
+    bool resting;              // ACCEPTED: the requesting order rests after it. FILL: the passive order still rests.
+    SymbolId symbolId;
+    char orderId[MAX_ORDER_ID_LENGTH + 1]; // Requesting order; the aggressor for a FILL
+    Fill fill; // FILL only
+};
+
+enum class CommandRingMode : std::uint8_t {
+    MULTI_PRODUCER, // Any number of front-end threads submit; each request claims its slot with a CAS
+    SINGLE_PRODUCER // One front-end thread submits everything; slots are claimed with plain stores
+};
+
+struct ShardedEngineOptions {
+    std::size_t shardCount = 1;
+    std::size_t orderCapacityPerShard = 65536;
+    std::string logPrefix = "engine_shard"; // Each shard logs asynchronously to "<logPrefix><index>.log"
+    std::size_t commandRingCapacity = 65536;
+    std::size_t eventRingCapacity = 0;      // 0 disables the event rings
+    CommandRingMode producers = CommandRingMode::MULTI_PRODUCER;
+};
+
+// Splits symbols across N matching threads. Every shard owns a complete MatchingEngine (books,
+// pools, order index, sequencer) that only its own thread touches, so matching takes no locks.
+// Front ends push fixed-size commands into a shard's lock-free ring (MPSC, or SPSC for a single
+// front end), routed by SymbolId; the shard drains them in batches. Order IDs are unique per shard and sequence numbers are per
+// shard, so (symbol, sequence) identifies a fill engine-wide.
+class ShardedEngine {
+public:
+    explicit ShardedEngine(EmailNotifier& notifier, const ShardedEngineOptions& options = ShardedEngineOptions());
+    ~ShardedEngine();
+
+    ShardedEngine(const ShardedEngine&) = delete;
+    ShardedEngine& operator=(const ShardedEngine&) = delete;
+
+    // Fills of a shard are delivered on that shard's thread. Set before start(). Without a sink,
+    // fills go to the shard's event ring if it has one and are discarded otherwise.
+    void setFillSink(std::size_t shard, FillSink* sink);
+
+    // Starts one matching thread per shard. shardCpus[i] pins shard i to that CPU (Linux only);
+    // missing entries or -1 leave the thread unpinned.
+    void start(const std::vector<int>& shardCpus = {});
+    // Lets every shard drain its ring, then joins the threads. No submissions may race with stop().
+    // Events a shard could not fit in its event ring stay available to pollEvents().
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Symbols are interned here and registered with every shard in the same order, so a SymbolId
+    // means the same instrument in every shard. Intern and configure symbols from one thread, before
+    // or after start(); neither waits for a shard. Front ends may submit for a symbol once its ID has
+    // been returned. Names longer than MAX_ORDER_ID_LENGTH, or more than MAX_SHARDED_SYMBOLS symbols,
+    // return INVALID_SYMBOL_ID.
+    SymbolId internSymbol(const std::string& symbol);
+    // A symbol's instrument may be read once its ID has been returned, unless setInstrument may still
+    // reconfigure it: configure a symbol before handing its ID to front ends
+    const SymbolDirectory& getSymbols() const { return symbols; }
+    // Interns a new symbol with this instrument before its ID is visible. An existing one is claimed
+    // first, so no order can be routed while it changes; refused once an order has been routed for it.
+    bool setInstrument(const std::string& symbol, double tickSize, int lotSize);
+
+    // Safe from any number of front-end threads, or from one with CommandRingMode::SINGLE_PRODUCER.
+    // Return false if the request could not be queued (unknown symbol, over-long order ID, engine not
+    // running, a PLACE while setInstrument is changing the symbol, or a full command ring); nothing
+    // waits, so a caller that gets false for a full ring polls events and tries again.
+    // Rejections by the matcher itself are counted in getRejectedCount() and reported as events.
+    bool placeOrder(const Order& order);
+    bool modifyOrder(SymbolId symbolId, const std::string& orderId, Price newPrice, int newQuantity);
+    bool cancelOrder(SymbolId symbolId, const std::string& orderId);
+    // Lowest-level entry point for front ends that build slots themselves
+    bool submit(const EngineCommand& command);
+
+    // Single consumer per shard: hands up to maxEvents ACCEPTED / REJECTED / FILL events to handler.
+    // A shard whose event ring is full keeps its events in a backlog and takes no further commands
+    // until this consumer makes room, so its command ring fills and submissions return false.
+    template <typename Handler>
+    std::size_t pollEvents(std::size_t shard, Handler&& handler, std::size_t maxEvents = 256) {
+        Shard& target = *shards[shard];
+        if (!target.events) {
+            return 0;
+        }
+        std::size_t count = target.events->drain(handler, maxEvents);
+        // Once the threads are joined the backlog is the consumer's to take
+        for (; count < maxEvents && !running.load(std::memory_order_acquire) && target.backlogHead < target.backlog.size(); ++count) {
+            handler(target.backlog[target.backlogHead++]);
+        }
+        return count;
+    }
+
+    bool hasEventRings() const { return !shards.empty() && shards.front()->events != nullptr; }
+    std::size_t getShardCount() const { return shards.size(); }
+    std::size_t shardFor(SymbolId symbolId) const { return symbolId % shards.size(); }
+
+    // Blocks until every request queued so far has been executed; with event rings, only while their
+    // consumers keep polling
+    void waitUntilIdle() const;
+    std::uint64_t getProcessedCount() const;
+    std::uint64_t getRejectedCount() const;
+
+private:
+    struct Shard {
+        Shard(std::size_t index, EmailNotifier& notifier, const ShardedEngineOptions& options);
+
+        // The command ring options.producers selected
+        bool tryPush(const EngineCommand& command);
+        template <typename Handler>
+        std::size_t drain(Handler&& handler, std::size_t maxCommands) {
+            return sharedCommands ? sharedCommands->drain(handler, maxCommands) : ownCommands->drain(handler, maxCommands);
+        }
+
+        std::size_t index;
+        Logger logger;
+        MatchingEngine engine;
+        std::unique_ptr<MpscRing<EngineCommand>> sharedCommands; // MULTI_PRODUCER
+        std::unique_ptr<SpscRing<EngineCommand>> ownCommands;    // SINGLE_PRODUCER
+        std::unique_ptr<SpscRing<EngineEvent>> events;
+        FillBuffer requestFills; // Fills of the request being executed, published once it is done
+        FillSink* sink;
+        // Events that did not fit in the event ring, oldest at backlogHead; the shard thread's until stop()
+        std::vector<EngineEvent> backlog;
+        std::size_t backlogHead = 0;
+
+        // REGISTER_SYMBOL / SET_INSTRUMENT from the thread that configures symbols. Rare, so a mutex;
+        // controlPending lets the shard check for them before each command without taking it.
+        std::mutex controlMutex;
+        std::vector<EngineCommand> control;
+        std::atomic<std::size_t> controlPending{0};
+
+        std::atomic<std::uint64_t> submitted{0};
+        std::atomic<std::uint64_t> processed{0};
+        std::atomic<std::uint64_t> rejected{0};
+        std::atomic<bool> stopping{false};
+        std::thread thread;
+    };
+
+    // Whether a symbol's instrument may still change. setInstrument claims an OPEN symbol by moving it
+    // to CONFIGURING and a PLACE closes it by moving it to TRADED, so the two cannot interleave.
+    enum SymbolState : std::uint8_t { OPEN, CONFIGURING, TRADED };
+
+    SymbolDirectory symbols;
+    std::atomic<std::size_t> symbolCount{0}; // Symbols visible to front-end threads
+    std::unique_ptr<std::atomic<std::uint8_t>[]> symbolStates; // Indexed by SymbolId
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<bool> running{false};
+
+    // Registers a symbol with every shard, configured first if tickSize > 0, then publishes its ID
+    SymbolId addSymbol(const std::string& symbol, double tickSize, int lotSize);
+    bool markTraded(SymbolId symbolId); // False while setInstrument has the symbol claimed
+    static void pushControl(Shard& shard, const EngineCommand& command);
+    static void applyControl(Shard& shard); // Shard thread, before any command that may depend on it
+    void run(Shard& shard, int cpu);
+    void execute(Shard& shard, const EngineCommand& command);
+    static void publish(Shard& shard, const EngineEvent& event);
+    static bool flushBacklog(Shard& shard); // True once the backlog is empty
+};
+
+#endif // SHARDED_ENGINE_H
@@ -0,0 +1,301 @@
+#include "Snapshot.h"
+#include "Journal.h"
+#include "EngineClock.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Header bytes covered by its crc: everything after the crc field
+const std::size_t HEADER_CRC_OFFSET = offsetof(SnapshotHeader, crc) + sizeof(std::uint32_t);
+const std::size_t BOOK_CRC_OFFSET = sizeof(std::uint32_t);
+
+std::uint32_t headerCrc(const SnapshotHeader& header, const std::vector<SnapshotSymbol>& symbols) {
+    const char* bytes = reinterpret_cast<const char*>(&header);
+    std::uint32_t crc = journalCrc32(bytes, offsetof(SnapshotHeader, crc));
+    crc = journalCrc32(bytes + HEADER_CRC_OFFSET, sizeof(header) - HEADER_CRC_OFFSET, crc);
+    return journalCrc32(symbols.data(), symbols.size() * sizeof(SnapshotSymbol), crc);
+}
+
+std::uint32_t bookCrc(const SnapshotBook& book, const SnapshotOrder* orders) {
+    std::uint32_t crc = journalCrc32(reinterpret_cast<const char*>(&book) + BOOK_CRC_OFFSET, sizeof(book) - BOOK_CRC_OFFSET);
+    return journalCrc32(orders, book.orderCount * sizeof(SnapshotOrder), crc);
+}
+
+#ifndef _WIN32
+// Makes a rename into the snapshot's directory durable
+void syncDirectory(const std::string& path) {
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+#endif
+
+} // namespace
+
+std::string snapshotPath(const std::string& basePath, std::uint64_t journalSequence) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%012llu", static_cast<unsigned long long>(journalSequence));
+    return basePath + suffix;
+}
+
+std::vector<std::pair<std::uint64_t, std::string>> listSnapshots(const std::string& basePath) {
+    // Same naming scheme as journal segments, numbered by journal sequence instead
+    return listJournalSegments(basePath);
+}
+
+EngineSnapshot::EngineSnapshot() {
+    reset(0, 0);
+}
+
+void EngineSnapshot::reset(std::uint64_t journalSequence, std::uint64_t engineSequence, std::size_t expectedOrders) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.journalSequence = journalSequence;
+    header.engineSequence = engineSequence;
+    header.createdWallNanos = EngineClock::toWallNanos(EngineClock::now());
+    symbols.clear();
+    books.clear();
+    orders.clear();
+    orders.reserve(expectedOrders);
+    error.clear();
+}
+
+void EngineSnapshot::addSymbol(const Instrument& instrument) {
+    SnapshotSymbol symbol;
+    std::memset(&symbol, 0, sizeof(symbol));
+    copyOrderId(symbol.symbol, instrument.symbol);
+    symbol.tickSize = instrument.tickSize;
+    symbol.lotSize = instrument.lotSize;
+    symbol.symbolId = instrument.id;
+    symbols.push_back(symbol);
+    header.symbolCount = static_cast<std::uint32_t>(symbols.size());
+}
+
+void EngineSnapshot::addBook(SymbolId symbolId) {
+    books.push_back(SnapshotBook{0, symbolId, 0});
+    header.bookCount = static_cast<std::uint32_t>(books.size());
+}
+
+void EngineSnapshot::addOrder(const Order& order) {
+    SnapshotOrder& record = orders.emplace_back();
+    copyOrderId(record.orderId, order.getOrderId());
+    record.sequence = order.getSequence();
+    record.wallNanos = EngineClock::toWallNanos(order.getTimestamp());
+    record.price = order.getPrice();
+    record.quantity = order.getQuantity();
+    record.side = static_cast<std::uint8_t>(order.getType());
+    std::memset(record.reserved, 0, sizeof(record.reserved));
+    books.back().orderCount++;
+}
+
+void EngineSnapshot::seal() {
+    header.crc = headerCrc(header, symbols);
+    const SnapshotOrder* bookOrders = orders.data();
+    for (SnapshotBook& book : books) {
+        book.crc = bookCrc(book, bookOrders);
+        bookOrders += book.orderCount;
+    }
+}
+
+bool EngineSnapshot::write(const std::string& path, bool sync) {
+    seal();
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        error = "Unable to create " + temporary + ".";
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(symbols.data(), sizeof(SnapshotSymbol), symbols.size(), file) == symbols.size();
+    const SnapshotOrder* bookOrders = orders.data();
+    for (std::size_t i = 0; written && i < books.size(); ++i) {
+        const SnapshotBook& book = books[i];
+        written = std::fwrite(&book, sizeof(book), 1, file) == 1 &&
+                  std::fwrite(bookOrders, sizeof(SnapshotOrder), book.orderCount, file) == book.orderCount;
+        bookOrders += book.orderCount;
+    }
+    written = std::fflush(file) == 0 && written;
+#ifndef _WIN32
+    if (written && sync) {
+        written = ::fsync(::fileno(file)) == 0;
+    }
+#endif
+    written = std::fclose(file) == 0 && written;
+
+    std::error_code ec;
+    if (written) {
+        std::filesystem::rename(temporary, path, ec);
+    }
+    if (!written || ec) {
+        std::filesystem::remove(temporary, ec);
+        error = "Unable to write snapshot " + path + ".";
+        return false;
+    }
+#ifndef _WIN32
+    if (sync) {
+        syncDirectory(path);
+    }
+#endif
+    return true;
+}
+
+bool EngineSnapshot::read(const std::string& path) {
+    reset(0, 0);
+    std::error_code ec;
+    std::uintmax_t remaining = std::filesystem::file_size(path, ec);
+    std::FILE* file = ec ? nullptr : std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = "Unable to open " + path + " for reading.";
+        return false;
+    }
+    // Each check below names the first thing wrong with the file; the header's own fields are only
+    // trusted once its checksum matches
+    SnapshotHeader fileHeader;
+    if (std::fread(&fileHeader, sizeof(fileHeader), 1, file) != 1 || std::memcmp(fileHeader.magic, SNAPSHOT_MAGIC, sizeof(fileHeader.magic)) != 0) {
+        error = "Missing snapshot header in " + path + ".";
+    } else if (fileHeader.version != SNAPSHOT_VERSION) {
+        error = "Unsupported snapshot version " + std::to_string(fileHeader.version) + " in " + path + ".";
+    } else if (fileHeader.symbolCount > (remaining - sizeof(fileHeader)) / sizeof(SnapshotSymbol)) {
+        error = "Torn snapshot " + path + ".";
+    } else {
+        remaining -= sizeof(fileHeader) + fileHeader.symbolCount * sizeof(SnapshotSymbol);
+        symbols.resize(fileHeader.symbolCount);
+        if (std::fread(symbols.data(), sizeof(SnapshotSymbol), symbols.size(), file) != symbols.size() ||
+            headerCrc(fileHeader, symbols) != fileHeader.crc) {
+            error = "Snapshot header checksum mismatch in " + path + ".";
+        }
+    }
+    for (std::uint32_t i = 0; error.empty() && i < fileHeader.bookCount; ++i) {
+        SnapshotBook book;
+        // Counts are checked against what is left of the file before anything is sized from them
+        if (std::fread(&book, sizeof(book), 1, file) != 1 || book.orderCount > (remaining - sizeof(book)) / sizeof(SnapshotOrder)) {
+            error = "Torn snapshot " + path + ".";
+            break;
+        }
+        remaining -= sizeof(book) + book.orderCount * sizeof(SnapshotOrder);
+        std::size_t first = orders.size();
+        orders.resize(first + book.orderCount);
+        if (std::fread(orders.data() + first, sizeof(SnapshotOrder), book.orderCount, file) != book.orderCount) {
+            error = "Torn snapshot " + path + ".";
+        } else if (bookCrc(book, orders.data() + first) != book.crc) {
+            error = "Checksum mismatch in book " + std::to_string(i) + " of snapshot " + path + ".";
+        }
+        books.push_back(book);
+    }
+    std::fclose(file);
+    if (!error.empty()) {
+        std::string readError = error;
+        reset(0, 0);
+        error = readError;
+        return false;
+    }
+    header = fileHeader;
+    return true;
+}
+
+SnapshotWriter::SnapshotWriter(const std::string& snapshotBasePath, const std::string& journalBasePath, std::size_t keep)
+    : basePath(snapshotBasePath), journalPath(journalBasePath), keepSnapshots(keep > 0 ? keep : 1) {
+    for (const auto& snapshot : listSnapshots(basePath)) {
+        lastJournalSequence = snapshot.first;
+    }
+    writer = std::thread(&SnapshotWriter::run, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+bool SnapshotWriter::submit(EngineSnapshot& snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (busy) {
+            return false;
+        }
+        std::swap(pending, snapshot);
+        busy = true;
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool SnapshotWriter::isBusy() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return busy;
+}
+
+void SnapshotWriter::waitIdle() {
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [this] { return !busy; });
+}
+
+std::uint64_t SnapshotWriter::getWrittenCount() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return writtenCount;
+}
+
+std::uint64_t SnapshotWriter::getLastJournalSequence() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return lastJournalSequence;
+}
+
+std::string SnapshotWriter::getError() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return error;
+}
+
+void SnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        wake.wait(lock, [this] { return busy || stopping; });
+        if (!busy) {
+            return; // Stopping with nothing left to write
+        }
+        lock.unlock();
+        std::uint64_t journalSequence = pending.getJournalSequence();
+        bool written = pending.write(snapshotPath(basePath, journalSequence));
+        std::string writeError = pending.getError();
+        if (written) {
+            prune();
+        }
+        lock.lock();
+        if (written) {
+            writtenCount++;
+            lastJournalSequence = journalSequence;
+        } else {
+            error = writeError;
+        }
+        busy = false;
+        idle.notify_all();
+    }
+}
+
+void SnapshotWriter::prune() {
+    auto snapshots = listSnapshots(basePath);
+    if (snapshots.size() < keepSnapshots) {
+        return;
+    }
+    std::size_t excess = snapshots.size() - keepSnapshots;
+    std::error_code ec;
+    for (std::size_t i = 0; i < excess; ++i) {
+        std::filesystem::remove(snapshots[i].second, ec);
+    }
+    // Recovery may have to start from the oldest snapshot kept, so the journal after it stays
+    truncateJournal(journalPath, snapshots[excess].first);
+}
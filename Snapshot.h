@@ -0,0 +1,145 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "Instrument.h"
+#include "Order.h"
+#include "Fill.h"
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Point-in-time image of an engine's books. On disk: a SnapshotHeader, the symbol table, then per book
+// a SnapshotBook followed by its resting orders in priority order. Every part is checksummed.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t crc;             // CRC-32 of the rest of the header and the symbol table
+    std::uint64_t journalSequence; // Last journal record reflected in the books; replay resumes after it
+    std::uint64_t engineSequence;  // Engine Sequencer value at capture
+    long long createdWallNanos;
+    std::uint32_t symbolCount;
+    std::uint32_t bookCount;
+};
+
+struct SnapshotSymbol {
+    char symbol[MAX_ORDER_ID_LENGTH + 1];
+    double tickSize;
+    std::int32_t lotSize;
+    SymbolId symbolId; // ID in the capturing engine, which is also the ID its journal records carry
+};
+
+struct SnapshotBook {
+    std::uint32_t crc;     // CRC-32 of the rest of this record and the book's orders
+    SymbolId symbolId;
+    std::uint64_t orderCount;
+};
+
+struct SnapshotOrder {
+    char orderId[MAX_ORDER_ID_LENGTH + 1];
+    std::uint64_t sequence;
+    long long wallNanos; // Time priority, as wall-clock time so another process can restore it
+    Price price;
+    std::int32_t quantity;
+    std::uint8_t side;   // OrderType
+    std::uint8_t reserved[3];
+};
+
+static_assert(sizeof(SnapshotHeader) == 48, "Snapshot header layout is part of the file format");
+static_assert(sizeof(SnapshotSymbol) == 48, "Snapshot symbol layout is part of the file format");
+static_assert(sizeof(SnapshotBook) == 16, "Snapshot book layout is part of the file format");
+static_assert(sizeof(SnapshotOrder) == 64, "Snapshot order layout is part of the file format");
+static_assert(std::is_trivially_copyable<SnapshotOrder>::value, "Snapshot records are written as raw bytes");
+
+const char SNAPSHOT_MAGIC[8] = {'V', 'C', 'S', 'N', 'A', 'P', '\0', '\0'};
+const std::uint32_t SNAPSHOT_VERSION = 1;
+
+// Snapshot files are named <basePath>.<journal sequence>, zero padded so they sort by age
+std::string snapshotPath(const std::string& basePath, std::uint64_t journalSequence);
+// Existing snapshots of basePath as (journal sequence, path), oldest first
+std::vector<std::pair<std::uint64_t, std::string>> listSnapshots(const std::string& basePath);
+
+// MatchingEngine::captureSnapshot fills one in on the matching thread with plain copies;
+// checksums and I/O are left to write(), which may run on any thread.
+class EngineSnapshot {
+public:
+    EngineSnapshot();
+
+    // Building
+    void reset(std::uint64_t journalSequence, std::uint64_t engineSequence, std::size_t expectedOrders = 0);
+    void addSymbol(const Instrument& instrument);
+    void addBook(SymbolId symbolId); // The orders added next belong to this book
+    void addOrder(const Order& order);
+
+    // Fills in the checksums and replaces path through a temporary file; with sync the data and the
+    // rename are flushed to disk before this returns
+    bool write(const std::string& path, bool sync = true);
+    // Loads path and verifies every checksum; false (see getError) if it is missing, torn or corrupt
+    bool read(const std::string& path);
+
+    std::uint64_t getJournalSequence() const { return header.journalSequence; }
+    std::uint64_t getEngineSequence() const { return header.engineSequence; }
+    const std::vector<SnapshotSymbol>& getSymbols() const { return symbols; }
+    const std::vector<SnapshotBook>& getBooks() const { return books; }
+    // All books' orders back to back, in the order of getBooks()
+    const std::vector<SnapshotOrder>& getOrders() const { return orders; }
+    const std::string& getError() const { return error; }
+
+private:
+    SnapshotHeader header;
+    std::vector<SnapshotSymbol> symbols;
+    std::vector<SnapshotBook> books;
+    std::vector<SnapshotOrder> orders;
+    std::string error;
+
+    void seal();
+};
+
+// Writes snapshots on a background thread, so matching only pauses for the capture. Keeps the newest
+// keepSnapshots files and then truncates the journal up to the oldest one kept, so a newest snapshot
+// that turns out damaged can still fall back to the one before it plus the journal after that.
+class SnapshotWriter {
+public:
+    SnapshotWriter(const std::string& basePath, const std::string& journalPath, std::size_t keepSnapshots = 2);
+    ~SnapshotWriter(); // Finishes the snapshot being written
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Takes the captured snapshot by swapping it with a spent buffer, whose capacity the next capture
+    // can reuse. False, and snapshot is left alone, while the previous one is still being written.
+    bool submit(EngineSnapshot& snapshot);
+    bool isBusy() const;
+    // Blocks until the snapshot being written, if any, is on disk
+    void waitIdle();
+
+    std::uint64_t getWrittenCount() const;
+    // Journal sequence covered by the newest snapshot written; 0 before the first
+    std::uint64_t getLastJournalSequence() const;
+    std::string getError() const; // Last write or truncation failure, empty if none
+
+private:
+    std::string basePath;
+    std::string journalPath;
+    std::size_t keepSnapshots;
+
+    mutable std::mutex mtx;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    EngineSnapshot pending; // Guarded by mtx until busy is set, then owned by the writer thread
+    bool busy = false;
+    bool stopping = false;
+    std::uint64_t writtenCount = 0;
+    std::uint64_t lastJournalSequence = 0;
+    std::string error;
+    std::thread writer;
+
+    void run();
+    void prune();
+};
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,33 @@
+#include "SymbolDirectory.h"
+
+SymbolDirectory::SymbolDirectory(double defaultTickSize, int defaultLotSize) {
+    defaults.id = INVALID_SYMBOL_ID;
+    defaults.tickSize = defaultTickSize;
+    defaults.lotSize = defaultLotSize;
+}
+
+SymbolId SymbolDirectory::intern(const std::string& symbol) {
+    auto it = ids.find(symbol);
+    if (it != ids.end()) {
+        return it->second;
+    }
+    SymbolId id = static_cast<SymbolId>(instruments.size());
+    instruments.push_back(Instrument{id, symbol, defaults.tickSize, defaults.lotSize});
+    ids.emplace(symbol, id);
+    return id;
+}
+
+SymbolId SymbolDirectory::find(const std::string& symbol) const {
+    auto it = ids.find(symbol);
+    return it != ids.end() ? it->second : INVALID_SYMBOL_ID;
+}
+
+void SymbolDirectory::setInstrument(SymbolId id, double tickSize, int lotSize) {
+    instruments[id].tickSize = tickSize;
+    instruments[id].lotSize = lotSize;
+}
+
+const Instrument& SymbolDirectory::getInstrument(const std::string& symbol) const {
+    SymbolId id = find(symbol);
+    return id != INVALID_SYMBOL_ID ? instruments[id] : defaults;
+}
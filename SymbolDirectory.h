@@ -0,0 +1,38 @@
+#ifndef SYMBOL_DIRECTORY_H
+#define SYMBOL_DIRECTORY_H
+
+#include "Instrument.h"
+#include <deque>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+const SymbolId INVALID_SYMBOL_ID = std::numeric_limits<SymbolId>::max();
+
+// Interns ticker strings to dense SymbolIds once at order entry. The engine's hot path
+// (books, orders, trades) only carries the ID; names are looked up again at the edges.
+class SymbolDirectory {
+public:
+    SymbolDirectory(double defaultTickSize = 0.01, int defaultLotSize = 1);
+
+    // Returns the symbol's ID, registering it with the default tick/lot size on first use
+    SymbolId intern(const std::string& symbol);
+    // INVALID_SYMBOL_ID if the symbol was never interned
+    SymbolId find(const std::string& symbol) const;
+    bool contains(SymbolId id) const { return id < instruments.size(); }
+    std::size_t size() const { return instruments.size(); }
+
+    void setInstrument(SymbolId id, double tickSize, int lotSize);
+    const Instrument& getInstrument(SymbolId id) const { return instruments[id]; }
+    const std::string& getName(SymbolId id) const { return instruments[id].symbol; }
+
+    // Edge helper: unknown symbols report the default tick and lot size
+    const Instrument& getInstrument(const std::string& symbol) const;
+
+private:
+    Instrument defaults;
+    std::deque<Instrument> instruments; // Indexed by SymbolId; deque keeps references stable as symbols are added
+    std::unordered_map<std::string, SymbolId> ids;
+};
+
+#endif // SYMBOL_DIRECTORY_H
@@ -2,17 +2,19 @@
 #include "Trade.h"
 #include <sstream>
 
-Trade::Trade(std::string tId, std::string buyId, std::string sellId, std::string sym, double p, int q)
-    : tradeId(tId), buyOrderId(buyId), sellOrderId(sellId), symbol(sym), price(p), quantity(q) {
-    timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
-}
+Trade::Trade(std::uint64_t tId, std::string buyId, std::string sellId, SymbolId sym, Price p, int q)
+    : tradeId(tId), buyOrderId(std::move(buyId)), sellOrderId(std::move(sellId)), symbolId(sym), price(p), quantity(q), timestamp(0) {}
 
-std::string Trade::toString() const {
+std::string Trade::toString(const std::string& symbol) const {
     std::stringstream ss;
     ss << "Trade ID: " << tradeId << ", Buy Order ID: " << buyOrderId << ", Sell Order ID: " << sellOrderId
-       << ", Symbol: " << symbol << ", Price: " << price
-       << ", Quantity: " << quantity << ", Timestamp: " << timestamp;
+       << ", Symbol: " << symbol << ", Price (ticks): " << price
+       << ", Quantity: " << quantity << ", Timestamp (ns): " << timestamp;
     return ss.str();
 }
 
-
+Trade Trade::fromFill(const Fill& fill) {
+    Trade trade(fill.sequence, fill.buyOrderId, fill.sellOrderId, fill.symbolId, fill.price, fill.quantity);
+    trade.timestamp = fill.timestamp;
+    return trade;
+}
@@ -1,31 +1,37 @@
 #ifndef TRADE_H
 #define TRADE_H
 
+#include "Instrument.h"
+#include "Fill.h"
+#include <cstdint>
 #include <string>
 #include <chrono>
 
 class Trade {
 public:
-    std::string tradeId;
+    std::uint64_t tradeId; // Engine sequence number of the fill
     std::string buyOrderId;
     std::string sellOrderId;
-    std::string symbol;
-    double price;
+    SymbolId symbolId;
+    Price price; // In ticks of the symbol's tick size
     int quantity;
-    long long timestamp;
+    long long timestamp; // EngineClock nanoseconds of the event that produced the fill
 
-    Trade(std::string tradeId, std::string buyId, std::string sellId, std::string sym, double p, int q);
+    Trade(std::uint64_t tradeId, std::string buyId, std::string sellId, SymbolId symbolId, Price p, int q);
 
     // Getters
-    std::string getTradeId() const { return tradeId; }
-    std::string getBuyOrderId() const { return buyOrderId; }
-    std::string getSellOrderId() const { return sellOrderId; }
-    std::string getSymbol() const { return symbol; }
-    double getPrice() const { return price; }
+    std::uint64_t getTradeId() const { return tradeId; }
+    const std::string& getBuyOrderId() const { return buyOrderId; }
+    const std::string& getSellOrderId() const { return sellOrderId; }
+    SymbolId getSymbolId() const { return symbolId; }
+    Price getPrice() const { return price; }
     int getQuantity() const { return quantity; }
     long long getTimestamp() const { return timestamp; }
 
-    std::string toString() const;
+    std::string toString(const std::string& symbol) const;
+
+    // Expands a matcher fill record into a Trade for the vector-returning APIs
+    static Trade fromFill(const Fill& fill);
 };
 
 #endif // TRADE_H
@@ -1,88 +1,175 @@
 
+
 #include "TradeLogger.h"
+#include "EngineClock.h"
+#include "MappedJournal.h"
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
-TradeLogger::TradeLogger(Logger& log, const std::string& ordersFile, const std::string& tradesFile, const std::string& cancelledFile)
-    : logger(log), ordersFilePath(ordersFile), tradesFilePath(tradesFile), cancelledFilePath(cancelledFile) {
-    
-    // Ensure headers are written if files are new or empty
-    std::ofstream ofs;
-    ofs.open(ordersFilePath, std::ios::out | std::ios::app);
-    if (ofs.tellp() == 0) { // Check if file is empty
-        writeHeader(ofs, "orderId,symbol,type,price,quantity,timestamp\n");
+TradeLogger::TradeLogger(Logger& log, const SymbolDirectory& symbolDirectory, const std::string& journalFile,
+                         const JournalOptions& journalOptions, const std::string& ordersFile)
+    : logger(log), symbols(symbolDirectory), backend(journalOptions.backend), ordersFilePath(ordersFile) {
+    if (journalOptions.backend == JournalBackend::MAPPED) {
+        journal = std::make_unique<MappedJournal>(journalFile, journalOptions);
+    } else {
+        journal = std::make_unique<Journal>(journalFile, journalOptions);
+    }
+    if (!journal->isOpen()) {
+        logger.consoleLog(journal->getError());
+    } else if (journalOptions.backend == JournalBackend::BUFFERED && journalOptions.flushPolicy == JournalFlushPolicy::INTERVAL) {
+        flusher = std::thread(&TradeLogger::runFlusher, this, journalOptions.flushInterval);
     }
-    ofs.close();
+}
 
-    ofs.open(tradesFilePath, std::ios::out | std::ios::app);
-    if (ofs.tellp() == 0) {
-        writeHeader(ofs, "tradeId,buyOrderId,sellOrderId,symbol,price,quantity,timestamp\n");
+TradeLogger::~TradeLogger() {
+    if (flusher.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        flusherWake.notify_one();
+        flusher.join();
     }
-    ofs.close();
+}
 
-    ofs.open(cancelledFilePath, std::ios::out | std::ios::app);
-    if (ofs.tellp() == 0) {
-        writeHeader(ofs, "orderId,symbol,type,price,quantity,timestamp\n");
+void TradeLogger::runFlusher(std::chrono::microseconds interval) {
+    // Checking twice per interval keeps a record from waiting much longer than the interval itself
+    std::chrono::microseconds period = interval / 2 > std::chrono::microseconds(0) ? interval / 2 : std::chrono::microseconds(1);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!flusherWake.wait_for(lock, period, [this] { return stopping; })) {
+        if (journal->isOpen() && !journal->flushIfDue()) {
+            logger.consoleLog(journal->getError());
+        }
     }
-    ofs.close();
 }
 
 void TradeLogger::writeHeader(std::ofstream& file, const std::string& header) {
     file << header;
 }
 
+std::string TradeLogger::decimalPrice(SymbolId symbolId, Price ticks) const {
+    return symbols.getInstrument(symbolId).formatPrice(ticks);
+}
+
+void TradeLogger::append(JournalRecord& record) {
+    std::uint64_t sequence = journal->append(record);
+    if (sequence == 0) {
+        logger.consoleLog(journal->isOpen() ? "Error: Unable to write to " + journal->getPath() + "." : journal->getError());
+        return;
+    }
+    lastJournaled = sequence;
+}
+
+void TradeLogger::journalSymbol(SymbolId symbolId) {
+    const Instrument& instrument = symbols.getInstrument(symbolId);
+    if (symbolId >= journaledInstruments.size()) {
+        journaledInstruments.resize(symbolId + 1);
+    }
+    Instrument& journaled = journaledInstruments[symbolId];
+    if (!journaled.symbol.empty() && journaled.tickSize == instrument.tickSize && journaled.lotSize == instrument.lotSize) {
+        return;
+    }
+    // SymbolIds are only stable within one process, so each run binds the IDs it uses before using them
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = JournalRecordType::SYMBOL;
+    record.engineNanos = EngineClock::now();
+    record.wallNanos = EngineClock::toWallNanos(record.engineNanos);
+    record.symbolId = symbolId;
+    record.tickSize = instrument.tickSize;
+    record.quantity = instrument.lotSize;
+    copyOrderId(record.orderId, instrument.symbol);
+    append(record);
+    journaled = instrument;
+}
+
+void TradeLogger::journalOrder(JournalRecordType type, const Order& order, Price price, int quantity) {
+    journalSymbol(order.getSymbolId());
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = type;
+    record.side = static_cast<std::uint8_t>(order.getType());
+    // An ORDER keeps its entry stamp; a CANCEL or MODIFY happens now
+    record.engineNanos = type == JournalRecordType::ORDER ? order.getTimestamp() : EngineClock::now();
+    record.wallNanos = EngineClock::toWallNanos(record.engineNanos);
+    record.symbolId = order.getSymbolId();
+    record.price = price;
+    record.quantity = quantity;
+    copyOrderId(record.orderId, order.getOrderId());
+    append(record);
+}
+
 void TradeLogger::logTrade(const Trade& trade) {
     std::lock_guard<std::mutex> lock(mtx);
-    std::ofstream ofs(tradesFilePath, std::ios::app);
-    if (ofs.is_open()) {
-        ofs << trade.getTradeId() << ","
-            << trade.getBuyOrderId() << ","
-            << trade.getSellOrderId() << ","
-            << trade.getSymbol() << ","
-            << trade.getPrice() << ","
-            << trade.getQuantity() << ","
-            << trade.getTimestamp() << "\n";
-        ofs.close();
-        logger.log("Logged trade: " + trade.toString());
-    } else {
-        logger.consoleLog("Error: Unable to open trades.csv for writing.");
-    }
+    journalSymbol(trade.getSymbolId());
+    JournalRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = JournalRecordType::TRADE;
+    record.engineNanos = trade.getTimestamp();
+    record.wallNanos = EngineClock::toWallNanos(trade.getTimestamp());
+    record.tradeId = trade.getTradeId();
+    record.symbolId = trade.getSymbolId();
+    record.price = trade.getPrice();
+    record.quantity = trade.getQuantity();
+    copyOrderId(record.orderId, trade.getBuyOrderId());
+    copyOrderId(record.sellOrderId, trade.getSellOrderId());
+    append(record);
 }
 
 void TradeLogger::logOrder(const Order& order) {
     std::lock_guard<std::mutex> lock(mtx);
-    std::ofstream ofs(ordersFilePath, std::ios::app);
-    if (ofs.is_open()) {
-        ofs << order.getOrderId() << ","
-            << order.getSymbol() << ","
-            << (order.getType() == BUY ? "BUY" : "SELL") << ","
-            << order.getPrice() << ","
-            << order.getQuantity() << ","
-            << order.getTimestamp() << "\n";
-        ofs.close();
-        logger.log("Logged order: " + order.toString());
-    } else {
-        logger.consoleLog("Error: Unable to open orders.csv for writing.");
-    }
+    journalOrder(JournalRecordType::ORDER, order, order.getPrice(), order.getQuantity());
 }
 
 void TradeLogger::logCancelledOrder(const Order& order) {
     std::lock_guard<std::mutex> lock(mtx);
-    std::ofstream ofs(cancelledFilePath, std::ios::app);
-    if (ofs.is_open()) {
-        ofs << order.getOrderId() << ","
-            << order.getSymbol() << ","
-            << (order.getType() == BUY ? "BUY" : "SELL") << ","
-            << order.getPrice() << ","
-            << order.getQuantity() << ","
-            << order.getTimestamp() << "\n";
-        ofs.close();
-        logger.log("Logged cancelled order: " + order.toString());
-    } else {
-        logger.consoleLog("Error: Unable to open cancelled.csv for writing.");
+    journalOrder(JournalRecordType::CANCEL, order, order.getPrice(), order.getQuantity());
+}
+
+void TradeLogger::logModifiedOrder(const Order& order, Price newPrice, int newQuantity) {
+    std::lock_guard<std::mutex> lock(mtx);
+    journalOrder(JournalRecordType::MODIFY, order, newPrice, newQuantity);
+}
+
+void TradeLogger::endBatch() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (journal->isOpen() && !journal->endBatch()) {
+        logger.consoleLog(journal->getError());
     }
 }
 
+bool TradeLogger::commit() {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!journal->isOpen()) {
+        return false;
+    }
+    journal->endBatch();
+    std::uint64_t sequence = lastJournaled;
+    if (sequence == 0) {
+        return true;
+    }
+    // A mapped journal commits on its own thread, so other threads can keep logging while this one waits
+    if (backend == JournalBackend::MAPPED) {
+        lock.unlock();
+    }
+    if (!journal->waitForCommit(sequence)) {
+        logger.consoleLog(journal->getError());
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t TradeLogger::getLastSequence() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return lastJournaled;
+}
+
+std::uint64_t TradeLogger::getJournalSyscallCount() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return journal->getSyscallCount();
+}
+
 void TradeLogger::saveAllOrders(const std::vector<Order>& orders) {
     std::lock_guard<std::mutex> lock(mtx);
     std::ofstream ofs(ordersFilePath, std::ios::out | std::ios::trunc); // Overwrite file
@@ -90,11 +177,11 @@ void TradeLogger::saveAllOrders(const std::vector<Order>& orders) {
         writeHeader(ofs, "orderId,symbol,type,price,quantity,timestamp\n");
         for (const auto& order : orders) {
             ofs << order.getOrderId() << ","
-                << order.getSymbol() << ","
+                << symbols.getName(order.getSymbolId()) << ","
                 << (order.getType() == BUY ? "BUY" : "SELL") << ","
-                << order.getPrice() << ","
+                << decimalPrice(order.getSymbolId(), order.getPrice()) << ","
                 << order.getQuantity() << ","
-                << order.getTimestamp() << "\n";
+                << EngineClock::toWallMillis(order.getTimestamp()) << "\n";
         }
         ofs.close();
         logger.log("Saved all current orders to " + ordersFilePath);
@@ -102,5 +189,3 @@ void TradeLogger::saveAllOrders(const std::vector<Order>& orders) {
         logger.consoleLog("Error: Unable to open orders.csv for saving all orders.");
     }
 }
-
-
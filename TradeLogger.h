@@ -4,32 +4,63 @@
 #include "Order.h"
 #include "Trade.h"
 #include "Logger.h"
+#include "SymbolDirectory.h"
+#include "Journal.h"
+#include <memory>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 
+// Records orders, modifies, trades and cancellations in a binary journal (journal_to_csv turns it into
+// orders.csv / trades.csv / cancelled.csv); saveAllOrders still writes its CSV snapshot directly.
+// journalOptions.backend picks a buffered file or memory-mapped segments with group commit.
+// Orders, modifies and cancels are logged before the engine applies them, so replayJournal can rebuild the books.
+// With JournalFlushPolicy::INTERVAL a flusher thread writes records the engine has gone quiet on.
+// Nothing is formatted per event: the journal is the record, and the engine's ENGINE_LOG_DEBUG events are the trace.
 class TradeLogger {
 public:
-    TradeLogger(Logger& logger, const std::string& ordersFile = "orders.csv",
-                const std::string& tradesFile = "trades.csv",
-                const std::string& cancelledFile = "cancelled.csv");
+    TradeLogger(Logger& logger, const SymbolDirectory& symbols, const std::string& journalFile = "journal.bin",
+                const JournalOptions& journalOptions = JournalOptions(),
+                const std::string& ordersFile = "orders.csv");
+    ~TradeLogger(); // Stops the flusher; the journal writes whatever is still buffered
 
     void logTrade(const Trade& trade);
     void logOrder(const Order& order);
     void logCancelledOrder(const Order& order);
+    void logModifiedOrder(const Order& order, Price newPrice, int newQuantity);
+    // Ends a group of related events (an order and its trades) for the journal's flush policy
+    void endBatch();
+    // Ends the batch and blocks until everything logged so far is committed; call before acknowledging
+    bool commit();
+    // Journal sequence of the last record logged; after commit(), everything the engine has applied
+    std::uint64_t getLastSequence();
+    // System calls the journal has made writing and syncing, where its backend counts them
+    std::uint64_t getJournalSyscallCount();
     void saveAllOrders(const std::vector<Order>& orders);
 
 private:
     Logger& logger;
+    const SymbolDirectory& symbols; // Resolves symbol names and converts tick prices back to decimals for the CSVs
+    JournalBackend backend;
+    std::unique_ptr<JournalWriter> journal;
+    std::uint64_t lastJournaled = 0;
     std::string ordersFilePath;
-    std::string tradesFilePath;
-    std::string cancelledFilePath;
+    std::vector<Instrument> journaledInstruments; // Last SYMBOL binding written per SymbolId; empty symbol = none yet
     std::mutex mtx;
+    std::condition_variable flusherWake;
+    bool stopping = false; // Guarded by mtx
+    std::thread flusher;   // INTERVAL only
+
+    void runFlusher(std::chrono::microseconds interval);
 
     void writeHeader(std::ofstream& file, const std::string& header);
+    std::string decimalPrice(SymbolId symbolId, Price ticks) const;
+    void journalSymbol(SymbolId symbolId);
+    void journalOrder(JournalRecordType type, const Order& order, Price price, int quantity);
+    void append(JournalRecord& record);
 };
 
 #endif // TRADE_LOGGER_H
-
-
@@ -206,30 +206,22 @@ class CPPTradingEngine:
             command = f"4\n{symbol}\n5\n"
             response = self._send_command(command)
             
-            # Parse the response to extract order book data
-            orders = []
+            # Parse the aggregated depth section: "BID | price | quantity | orders"
+            bids = []
+            asks = []
             for line in response.split('\n'):
-                if "Order:" in line and "|" in line:
-                    parts = line.split("|")
-                    if len(parts) >= 4:
-                        order_id = parts[0].split("Order:")[1].strip()
-                        order_type = parts[1].strip()
-                        price_part = parts[2].strip()
-                        quantity_part = parts[3].strip()
-                        
-                        price = float(price_part.split(":")[1].strip())
-                        quantity = int(quantity_part.split(":")[1].strip())
-                        
-                        orders.append({
-                            "order_id": order_id,
-                            "type": order_type,
-                            "price": price,
-                            "quantity": quantity
-                        })
-            
-            # Group by type
-            bids = [order for order in orders if "BUY" in order["type"]]
-            asks = [order for order in orders if "SELL" in order["type"]]
+                parts = [part.strip() for part in line.split("|")]
+                if len(parts) != 4:
+                    continue
+                side = parts[0].split()[-1] if parts[0] else ""
+                if side not in ("BID", "ASK"):
+                    continue
+                level = {
+                    "price": float(parts[1]),
+                    "quantity": int(parts[2]),
+                    "orders": int(parts[3])
+                }
+                (bids if side == "BID" else asks).append(level)
             
             return {
                 "symbol": symbol,
@@ -9,21 +9,70 @@
 #include "Order.h"
 #include "EmailNotifier.h"
 #include "MatchingEngine.h"
+#include "Instrument.h"
+#include "SymbolDirectory.h"
 
 namespace py = pybind11;
 
 PYBIND11_MODULE(trading_engine, m) {
+    // Instrument - converts between decimal prices and the engine's integer ticks
+    py::class_<Instrument>(m, "Instrument")
+        .def_readonly("id", &Instrument::id)
+        .def_readonly("symbol", &Instrument::symbol)
+        .def_readonly("tickSize", &Instrument::tickSize)
+        .def_readonly("lotSize", &Instrument::lotSize)
+        .def("toTicks", &Instrument::toTicks)
+        .def("toDecimal", &Instrument::toDecimal)
+        .def("formatPrice", &Instrument::formatPrice)
+        .def("isOnTick", &Instrument::isOnTick);
+
+    py::class_<PoolStats>(m, "PoolStats")
+        .def_readonly("capacity", &PoolStats::capacity)
+        .def_readonly("inUse", &PoolStats::inUse)
+        .def_readonly("slabAllocations", &PoolStats::slabAllocations)
+        .def_readonly("heapFallbacks", &PoolStats::heapFallbacks)
+        .def("heapAllocations", &PoolStats::heapAllocations);
+
+    py::class_<SymbolDirectory>(m, "SymbolDirectory")
+        .def("find", &SymbolDirectory::find)
+        .def("getName", &SymbolDirectory::getName)
+        .def("getInstrument", py::overload_cast<SymbolId>(&SymbolDirectory::getInstrument, py::const_), py::return_value_policy::reference_internal)
+        .def("getInstrumentBySymbol", py::overload_cast<const std::string&>(&SymbolDirectory::getInstrument, py::const_), py::return_value_policy::reference_internal);
+
     // Order class
     py::class_<Order>(m, "Order")
-        .def(py::init<const std::string&, const std::string&, OrderType, double, int>())
+        .def(py::init<const std::string&, SymbolId, OrderType, Price, int>())
         .def("getOrderId", &Order::getOrderId)
-        .def("getSymbol", &Order::getSymbol)
+        .def("getSymbolId", &Order::getSymbolId)
         .def("getType", &Order::getType)
         .def("getPrice", &Order::getPrice)
         .def("getQuantity", &Order::getQuantity)
+        .def("getSequence", &Order::getSequence)
         .def("setPrice", &Order::setPrice)
         .def("setQuantity", &Order::setQuantity)
-        .def("toString", &Order::toString);
+        .def("toString", &Order::toString, py::arg("symbol"));
+
+    // Depth snapshot
+    py::class_<DepthLevel>(m, "DepthLevel")
+        .def_readonly("price", &DepthLevel::price)
+        .def_readonly("totalQuantity", &DepthLevel::totalQuantity)
+        .def_readonly("orderCount", &DepthLevel::orderCount);
+
+    py::class_<BookDepth>(m, "BookDepth")
+        .def_readonly("symbolId", &BookDepth::symbolId)
+        .def_readonly("sequence", &BookDepth::sequence)
+        .def_readonly("bids", &BookDepth::bids)
+        .def_readonly("asks", &BookDepth::asks);
+
+    py::class_<TopOfBook>(m, "TopOfBook")
+        .def_readonly("symbolId", &TopOfBook::symbolId)
+        .def_readonly("sequence", &TopOfBook::sequence)
+        .def_readonly("bidPrice", &TopOfBook::bidPrice)
+        .def_readonly("bidQuantity", &TopOfBook::bidQuantity)
+        .def_readonly("bidOrderCount", &TopOfBook::bidOrderCount)
+        .def_readonly("askPrice", &TopOfBook::askPrice)
+        .def_readonly("askQuantity", &TopOfBook::askQuantity)
+        .def_readonly("askOrderCount", &TopOfBook::askOrderCount);
 
     // OrderType enum
     py::enum_<OrderType>(m, "OrderType")
@@ -33,44 +82,69 @@ PYBIND11_MODULE(trading_engine, m) {
 
     // Trade class
     py::class_<Trade>(m, "Trade")
-        .def(py::init<const std::string&, const std::string&, const std::string&, const std::string&, double, int>())
+        .def(py::init<std::uint64_t, const std::string&, const std::string&, SymbolId, Price, int>())
         .def("getTradeId", &Trade::getTradeId)
         .def("getBuyOrderId", &Trade::getBuyOrderId)
         .def("getSellOrderId", &Trade::getSellOrderId)
-        .def("getSymbol", &Trade::getSymbol)
+        .def("getSymbolId", &Trade::getSymbolId)
         .def("getPrice", &Trade::getPrice)
         .def("getQuantity", &Trade::getQuantity)
         .def("getTimestamp", &Trade::getTimestamp)
-        .def("toString", &Trade::toString)
-        .def("toCSV", &Trade::toCSV);
+        .def("toString", &Trade::toString, py::arg("symbol"));
+
+    py::enum_<LogOverflowPolicy>(m, "LogOverflowPolicy")
+        .value("DROP", LogOverflowPolicy::DROP)
+        .value("BLOCK", LogOverflowPolicy::BLOCK)
+        .value("COUNT", LogOverflowPolicy::COUNT);
 
     // Logger class
     py::class_<Logger>(m, "Logger")
         .def(py::init<const std::string&>())
-        .def("log", &Logger::log);
+        .def(py::init<const std::string&, std::size_t, LogOverflowPolicy>(), py::arg("filename"), py::arg("ringCapacity"),
+             py::arg("policy") = LogOverflowPolicy::COUNT)
+        .def("log", &Logger::log, py::arg("message"), py::arg("eventNanos") = 0)
+        .def("flush", &Logger::flush)
+        .def("getDroppedCount", &Logger::getDroppedCount);
 
     // EmailNotifier class
     py::class_<EmailNotifier>(m, "EmailNotifier")
         .def(py::init<>())
-        .def("sendOrderPlacedNotification", &EmailNotifier::sendOrderPlacedNotification)
-        .def("sendOrderCancelledNotification", &EmailNotifier::sendOrderCancelledNotification)
-        .def("sendTradeExecutedNotification", &EmailNotifier::sendTradeExecutedNotification);
+        .def("sendOrderPlaced", &EmailNotifier::sendOrderPlaced, py::arg("orderDetails"), py::arg("recipient") = EmailNotifier::DEFAULT_RECIPIENT)
+        .def("sendOrderModified", &EmailNotifier::sendOrderModified, py::arg("orderDetails"), py::arg("recipient") = EmailNotifier::DEFAULT_RECIPIENT)
+        .def("sendOrderCancelled", &EmailNotifier::sendOrderCancelled, py::arg("orderDetails"), py::arg("recipient") = EmailNotifier::DEFAULT_RECIPIENT)
+        .def("setEnabled", &EmailNotifier::setEnabled)
+        .def("flush", &EmailNotifier::flush);
 
     // OrderBook class
     py::class_<OrderBook>(m, "OrderBook")
-        .def(py::init<const std::string&, Logger&, EmailNotifier&>())
-        .def("addOrder", &OrderBook::addOrder)
-        .def("cancelOrder", &OrderBook::cancelOrder)
-        .def("modifyOrder", &OrderBook::modifyOrder)
+        .def(py::init<const Instrument&, Logger&, EmailNotifier&>())
+        .def("addOrder", py::overload_cast<Order>(&OrderBook::addOrder))
+        .def("cancelOrder", py::overload_cast<const std::string&>(&OrderBook::cancelOrder))
+        .def("modifyOrder", py::overload_cast<const std::string&, Price, int>(&OrderBook::modifyOrder))
         .def("getAllOrders", &OrderBook::getAllOrders)
-        .def("matchOrders", &OrderBook::matchOrders);
+        .def("getDepth", py::overload_cast<std::size_t>(&OrderBook::getDepth, py::const_))
+        .def("getTopOfBook", &OrderBook::getTopOfBook);
 
     // MatchingEngine class - Main interface for Python
     py::class_<MatchingEngine>(m, "MatchingEngine")
-        .def(py::init<Logger&, EmailNotifier&>())
-        .def("placeOrder", &MatchingEngine::placeOrder)
+        .def(py::init<Logger&, EmailNotifier&, std::size_t>(), py::arg("logger"), py::arg("notifier"), py::arg("orderCapacity") = 65536)
+        .def("placeOrder", py::overload_cast<Order>(&MatchingEngine::placeOrder))
         .def("cancelOrder", &MatchingEngine::cancelOrder)
-        .def("modifyOrder", &MatchingEngine::modifyOrder)
+        .def("modifyOrder", py::overload_cast<const std::string&, Price, int>(&MatchingEngine::modifyOrder))
         .def("getAllOrders", &MatchingEngine::getAllOrders)
-        .def("matchOrders", &MatchingEngine::matchOrders);
+        .def("getDepth", [](const MatchingEngine& engine, const std::string& symbol, std::size_t maxLevels) {
+            BookDepth depth;
+            engine.getDepth(symbol, maxLevels, depth);
+            return depth;
+        }, py::arg("symbol"), py::arg("maxLevels") = 10)
+        .def("getTopOfBook", [](const MatchingEngine& engine, const std::string& symbol) {
+            TopOfBook top;
+            engine.getTopOfBook(symbol, top);
+            return top;
+        })
+        .def("setInstrument", &MatchingEngine::setInstrument)
+        .def("getPoolStats", &MatchingEngine::getPoolStats)
+        .def("getLastSequence", &MatchingEngine::getLastSequence)
+        .def("internSymbol", &MatchingEngine::internSymbol)
+        .def("getSymbols", &MatchingEngine::getSymbols, py::return_value_policy::reference_internal);
 }
@@ -1,3 +1,9 @@
+// Order-entry server. On Linux it serves persistent sessions through OrderGateway (epoll);
+// the Windows build keeps the original one-request-per-connection Winsock loop.
+// Usage: cpp_engine_server [--shards=N] [port] [epoll|io_uring] [market-data group] [market-data interface]
+// --shards=N matches on N threads behind the gateway (a ShardedEngine), without market data.
+
+#ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iostream>
@@ -36,20 +42,15 @@ void handleRequest(const std::string& request, SOCKET clientSocket) {
         iss >> quantity;
 
         OrderType orderType = (side == "BUY") ? BUY : SELL;
-        Order order;
-        order.orderId = orderId;
-        order.symbol = symbol;
-        order.type = orderType;
-        order.price = price;
-        order.quantity = quantity;
-        order.timestamp = std::chrono::system_clock::now().time_since_epoch().count();
+        const Instrument& instrument = engine.getSymbols().getInstrument(engine.internSymbol(symbol));
+        Order order(orderId, instrument.id, orderType, instrument.toTicks(price), quantity);
 
         auto trades = engine.placeOrder(order);
 
         std::ostringstream oss;
-        oss << "Order placed: " << order.toString() << "\n";
+        oss << "Order placed: " << order.toString(symbol) << "\n";
         for (const auto& trade : trades) {
-            oss << "Trade: " << trade.toString() << "\n";
+            oss << "Trade: " << trade.toString(symbol) << "\n";
         }
         std::string response = oss.str();
         send(clientSocket, response.c_str(), static_cast<int>(response.length()), 0);
@@ -120,4 +121,124 @@ int main() {
     closesocket(serverSocket);
     WSACleanup();
     return 0;
-}
\ No newline at end of file
+}
+
+#else
+
+#include "OrderGateway.h"
+#include "MarketDataPublisher.h"
+#include "MatchingEngine.h"
+#include "ShardedEngine.h"
+#include "Logger.h"
+#include "EmailNotifier.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#define PORT 8080
+
+static OrderGateway* runningGateway = nullptr;
+
+// stop() only stores a flag and writes to an eventfd, both safe in a signal handler
+static void handleSignal(int) {
+    if (runningGateway != nullptr) {
+        runningGateway->stop();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t shardCount = 0;
+    std::vector<char*> args{argv[0]};
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--shards=", 9) == 0) {
+            shardCount = static_cast<std::size_t>(std::atoi(argv[i] + 9));
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (shardCount > 0 && args.size() > 3) {
+        std::cerr << "Error: --shards does not publish market data" << std::endl;
+        return 1;
+    }
+
+    // The gateway thread is the matching thread, so logs are written on a background thread
+    Logger logger("engine.log", 65536, LogOverflowPolicy::COUNT);
+    EmailNotifier notifier;
+    MatchingEngine engine(logger, notifier);
+
+    GatewayOptions options;
+    options.bindAddress = "0.0.0.0";
+    options.port = static_cast<std::uint16_t>(args.size() > 1 ? std::atoi(args[1]) : PORT);
+    if (args.size() > 2 && std::strcmp(args[2], "io_uring") == 0) {
+        options.backend = GatewayBackend::IO_URING;
+    }
+
+    // With shards, the gateway thread is their only producer and matching moves to the shard threads
+    std::unique_ptr<ShardedEngine> shardedEngine;
+    if (shardCount > 0) {
+        ShardedEngineOptions shardOptions;
+        shardOptions.shardCount = shardCount;
+        shardOptions.eventRingCapacity = 65536;
+        shardOptions.producers = CommandRingMode::SINGLE_PRODUCER;
+        shardedEngine = std::make_unique<ShardedEngine>(notifier, shardOptions);
+        shardedEngine->start();
+    }
+    std::unique_ptr<OrderGateway> gatewayOwner =
+        shardedEngine ? std::make_unique<OrderGateway>(*shardedEngine, options) : std::make_unique<OrderGateway>(engine, options);
+    OrderGateway& gateway = *gatewayOwner;
+    if (!gateway.start()) {
+        std::cerr << gateway.getError() << std::endl;
+        return 1;
+    }
+
+    // Book changes and trades go out on UDP multicast when a group is given
+    MarketDataOptions marketDataOptions;
+    std::unique_ptr<MarketDataPublisher> marketData;
+    if (args.size() > 3) {
+        marketDataOptions.group = args[3];
+        if (args.size() > 4) {
+            marketDataOptions.interfaceAddress = args[4];
+        }
+        marketData = std::make_unique<MarketDataPublisher>(marketDataOptions);
+        if (!marketData->start()) {
+            std::cerr << marketData->getError() << std::endl;
+            return 1;
+        }
+        marketData->attach(engine);
+        gateway.setMarketDataPublisher(marketData.get());
+        std::cout << "Publishing market data to " << marketDataOptions.group << " ports " << marketDataOptions.incrementalPort
+                  << " (incremental) and " << marketDataOptions.snapshotPort << " (snapshot) on " << marketDataOptions.interfaceAddress << "\n";
+    }
+    if (!gateway.getFallbackReason().empty()) {
+        std::cerr << "io_uring unavailable (" << gateway.getFallbackReason() << "); using epoll" << std::endl;
+    }
+    runningGateway = &gateway;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+
+    std::cout << "C++ Matching Engine Server listening on port " << gateway.getPort() << " ("
+              << (gateway.getBackend() == GatewayBackend::IO_URING ? "io_uring" : "epoll");
+    if (shardedEngine) {
+        std::cout << ", " << shardCount << " matching shards";
+    }
+    std::cout << ")...\n";
+    gateway.run();
+    if (shardedEngine) {
+        shardedEngine->stop();
+    }
+
+    const GatewayStats& stats = gateway.getStats();
+    std::cout << "Served " << stats.sessionsAccepted << " sessions (" << stats.binarySessions << " binary), " << stats.messages << " requests, "
+              << stats.responses << " responses in " << stats.wakeups << " wakeups, " << stats.syscalls << " system calls" << std::endl;
+    runningGateway = nullptr;
+    if (!gateway.getError().empty()) {
+        std::cerr << gateway.getError() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+#endif // _WIN32
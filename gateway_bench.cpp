@@ -0,0 +1,316 @@
+// Loopback benchmark for OrderGateway: opens persistent sessions, pipelines orders and measures
+// orders per second and round-trip latency (order sent -> ACK read), over the text protocol, the
+// binary protocol or both. Buys and sells alternate at one price, so about half the orders trade
+// and the book stays small.
+// Usage: gateway_bench [sessions] [orders per session] [pipeline window] [text|binary|both] [epoll|io_uring|both]
+//                      [journal on|off] [port of a running gateway]
+// Without a port it runs its own gateway on a free loopback port, with logging and notifications off,
+// and reports system calls per request. With the journal on, every request is journaled and the
+// journal is written and fdatasync'd once per wakeup before the answers go out.
+
+#include "OrderGateway.h"
+#include "BinaryProtocol.h"
+#include "MatchingEngine.h"
+#include "Logger.h"
+#include "EmailNotifier.h"
+#include "EngineClock.h"
+#include "TradeLogger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct SessionResult {
+    std::vector<long long> roundTrips; // Nanoseconds, one per acknowledged order
+    std::uint64_t fills = 0;
+    std::uint64_t rejects = 0;
+    bool failed = false;
+};
+
+// Price of every order: 100.00 at the default tick of 0.01
+const Price BENCH_PRICE_TICKS = 10000;
+// Journal of a journaled phase; recreated by each phase and removed at the end
+const char* const BENCH_JOURNAL = "gateway_bench.journal";
+
+static int connectTo(std::uint16_t port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return -1;
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+// One client session: keeps up to window orders in flight and times each one to its answer
+static bool writeAll(int fd, const char* data, std::size_t length) {
+    for (std::size_t offset = 0; offset < length;) {
+        ssize_t written = ::write(fd, data + offset, length - offset);
+        if (written <= 0) {
+            return false;
+        }
+        offset += static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+// Order number of "B<session>-<n>", or -1
+static int orderIndex(const char* orderId, std::size_t length) {
+    const char* dash = static_cast<const char*>(std::memchr(orderId, '-', length));
+    return dash != nullptr ? std::atoi(dash + 1) : -1;
+}
+
+static void runSession(std::uint16_t port, bool binary, int session, int orders, int window, SessionResult& result) {
+    int fd = connectTo(port);
+    if (fd < 0 || (binary && !writeAll(fd, BINARY_SESSION_MAGIC, sizeof(BINARY_SESSION_MAGIC)))) {
+        result.failed = true;
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+    std::vector<long long> sentAt(static_cast<std::size_t>(orders));
+    result.roundTrips.reserve(static_cast<std::size_t>(orders));
+    std::string prefix = "B" + std::to_string(session) + "-";
+    std::string batch;
+    std::vector<char> input(1 << 16);
+    std::size_t inputUsed = 0;
+    std::size_t skip = binary ? sizeof(BINARY_SESSION_MAGIC) : 0; // The gateway echoes the magic first
+    int sent = 0, answered = 0;
+
+    while (answered < orders) {
+        // Top the pipeline up with one write
+        batch.clear();
+        long long now = EngineClock::now();
+        for (; sent < orders && sent - answered < window; ++sent) {
+            if (binary) {
+                std::string orderId = prefix + std::to_string(sent);
+                BinaryNewOrder request{};
+                request.header = BinaryHeader{sizeof(BinaryNewOrder), BinaryMessageType::NEW_ORDER, 0};
+                request.quantity = 1;
+                request.price = BENCH_PRICE_TICKS;
+                request.side = sent % 2 == 0 ? BINARY_SIDE_BUY : BINARY_SIDE_SELL;
+                std::memcpy(request.symbol, "BENCH", 5);
+                std::memcpy(request.orderId, orderId.data(), orderId.size());
+                batch.append(reinterpret_cast<const char*>(&request), sizeof(request));
+            } else {
+                batch.append("ORDER,").append(prefix).append(std::to_string(sent)).append(sent % 2 == 0 ? ",BENCH,BUY,100.00,1\n" : ",BENCH,SELL,100.00,1\n");
+            }
+            sentAt[static_cast<std::size_t>(sent)] = now;
+        }
+        if (!writeAll(fd, batch.data(), batch.size())) {
+            result.failed = true;
+            ::close(fd);
+            return;
+        }
+
+        ssize_t received = ::read(fd, input.data() + inputUsed, input.size() - inputUsed);
+        if (received <= 0) {
+            result.failed = true;
+            break;
+        }
+        long long readAt = EngineClock::now();
+        inputUsed += static_cast<std::size_t>(received);
+        std::size_t consumed = std::min(skip, inputUsed);
+        skip -= consumed;
+        while (binary) {
+            BinaryHeader header;
+            if (inputUsed - consumed < sizeof(header)) {
+                break;
+            }
+            std::memcpy(&header, input.data() + consumed, sizeof(header));
+            if (header.length < sizeof(BinaryAck) || inputUsed - consumed < header.length) {
+                break;
+            }
+            const char* message = input.data() + consumed;
+            consumed += header.length;
+            if (header.type == BinaryMessageType::FILL) {
+                result.fills++;
+                continue;
+            }
+            // ACK and REJECT both end in the order ID
+            int index = orderIndex(message + header.length - (MAX_ORDER_ID_LENGTH + 1), MAX_ORDER_ID_LENGTH + 1);
+            if (index >= 0 && index < orders) {
+                result.roundTrips.push_back(readAt - sentAt[static_cast<std::size_t>(index)]);
+            }
+            result.rejects += header.type == BinaryMessageType::REJECT ? 1 : 0;
+            answered++;
+        }
+        while (!binary) {
+            char* start = input.data() + consumed;
+            char* newline = static_cast<char*>(std::memchr(start, '\n', inputUsed - consumed));
+            if (newline == nullptr) {
+                break;
+            }
+            consumed = static_cast<std::size_t>(newline - input.data()) + 1;
+            bool ack = std::strncmp(start, "ACK,", 4) == 0;
+            bool reject = std::strncmp(start, "REJECT,", 7) == 0;
+            if (std::strncmp(start, "FILL,", 5) == 0) {
+                result.fills++;
+            }
+            if (!ack && !reject) {
+                continue;
+            }
+            int index = orderIndex(start, static_cast<std::size_t>(newline - start));
+            if (index >= 0 && index < orders) {
+                result.roundTrips.push_back(readAt - sentAt[static_cast<std::size_t>(index)]);
+            }
+            result.rejects += reject ? 1 : 0;
+            answered++;
+        }
+        std::memmove(input.data(), input.data() + consumed, inputUsed - consumed);
+        inputUsed -= consumed;
+    }
+    ::close(fd);
+}
+
+static double percentile(const std::vector<long long>& sorted, double fraction) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1));
+    return static_cast<double>(sorted[index]) / 1000.0;
+}
+
+// What one phase runs against
+struct BenchSetup {
+    bool binary = false;
+    bool uring = false;   // Gateway and journal through io_uring, else epoll and write()
+    bool journal = false; // Journal every request, fdatasync once per wakeup before answering
+    std::uint16_t port = 0;
+};
+
+static void runPhase(const char* name, const BenchSetup& setup, int sessions, int orders, int window) {
+    Logger logger("gateway_bench.log");
+    logger.setEnabled(false);
+    EmailNotifier notifier;
+    notifier.setEnabled(false);
+    MatchingEngine engine(logger, notifier);
+    std::unique_ptr<TradeLogger> tradeLogger;
+    if (setup.journal) {
+        std::remove(BENCH_JOURNAL);
+        JournalOptions journalOptions;
+        journalOptions.bufferRecords = 4096;
+        journalOptions.batchRecords = 4096; // Flushed by the gateway's commit once per wakeup
+        journalOptions.syncOnFlush = true;
+        journalOptions.io = setup.uring ? JournalIo::IO_URING : JournalIo::WRITE;
+        tradeLogger = std::make_unique<TradeLogger>(logger, engine.getSymbols(), BENCH_JOURNAL, journalOptions, "gateway_bench_orders.csv");
+    }
+    GatewayOptions options;
+    options.port = 0;
+    options.backend = setup.uring ? GatewayBackend::IO_URING : GatewayBackend::EPOLL;
+    OrderGateway gateway(engine, options, tradeLogger.get());
+    std::thread server;
+    std::uint16_t port = setup.port;
+    if (port == 0) {
+        if (!gateway.start()) {
+            std::fprintf(stderr, "%s\n", gateway.getError().c_str());
+            return;
+        }
+        if (!gateway.getFallbackReason().empty()) {
+            std::fprintf(stderr, "io_uring unavailable (%s); using epoll\n", gateway.getFallbackReason().c_str());
+        }
+        port = gateway.getPort();
+        server = std::thread([&gateway] { gateway.run(); });
+    }
+
+    std::vector<SessionResult> results(static_cast<std::size_t>(sessions));
+    std::vector<std::thread> clients;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < sessions; ++i) {
+        clients.emplace_back(runSession, port, setup.binary, i, orders, window, std::ref(results[static_cast<std::size_t>(i)]));
+    }
+    for (std::thread& client : clients) {
+        client.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    if (server.joinable()) {
+        gateway.stop();
+        server.join();
+        if (!gateway.getError().empty()) {
+            std::fprintf(stderr, "%s\n", gateway.getError().c_str());
+        }
+    }
+
+    std::vector<long long> roundTrips;
+    std::uint64_t fills = 0, rejects = 0;
+    bool failed = false;
+    for (const SessionResult& result : results) {
+        roundTrips.insert(roundTrips.end(), result.roundTrips.begin(), result.roundTrips.end());
+        fills += result.fills;
+        rejects += result.rejects;
+        failed = failed || result.failed;
+    }
+    std::sort(roundTrips.begin(), roundTrips.end());
+    const char* backend = setup.port != 0 ? "external" : gateway.getBackend() == GatewayBackend::IO_URING ? "io_uring" : "epoll";
+    std::printf("%s (%s, %s%s): %d sessions x %d orders, window %d: %.0f orders/s, %llu fills, %llu rejects%s\n", name,
+                setup.binary ? "binary" : "text", backend, setup.journal ? ", journaled" : "", sessions, orders, window,
+                static_cast<double>(roundTrips.size()) / seconds, static_cast<unsigned long long>(fills),
+                static_cast<unsigned long long>(rejects), failed ? " (a session failed)" : "");
+    std::printf("  round trip us: p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile(roundTrips, 0.5), percentile(roundTrips, 0.99),
+                percentile(roundTrips, 0.999), percentile(roundTrips, 1.0));
+    if (setup.port == 0) {
+        const GatewayStats& stats = gateway.getStats();
+        double requests = static_cast<double>(stats.messages > 0 ? stats.messages : 1);
+        double journalSyscalls = tradeLogger ? static_cast<double>(tradeLogger->getJournalSyscallCount()) : 0.0;
+        std::printf("  gateway: %llu wakeups, %.1f requests/wakeup, %.3f reads and %.3f writes per request\n",
+                    static_cast<unsigned long long>(stats.wakeups), requests / static_cast<double>(stats.wakeups > 0 ? stats.wakeups : 1),
+                    static_cast<double>(stats.reads) / requests, static_cast<double>(stats.writes) / requests);
+        std::printf("  system calls per request: %.3f gateway + %.3f journal\n", static_cast<double>(stats.syscalls) / requests,
+                    journalSyscalls / requests);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int sessions = argc > 1 ? std::atoi(argv[1]) : 4;
+    int orders = argc > 2 ? std::atoi(argv[2]) : 100000;
+    int window = argc > 3 ? std::atoi(argv[3]) : 64;
+    std::string protocol = argc > 4 ? argv[4] : "both";
+    std::string backend = argc > 5 ? argv[5] : "epoll";
+    std::string journal = argc > 6 ? argv[6] : "off";
+    BenchSetup setup;
+    setup.port = static_cast<std::uint16_t>(argc > 7 ? std::atoi(argv[7]) : 0);
+    setup.journal = journal == "on";
+    bool validChoice = (protocol == "text" || protocol == "binary" || protocol == "both") &&
+                       (backend == "epoll" || backend == "io_uring" || backend == "both") && (journal == "on" || journal == "off");
+    if (sessions <= 0 || orders <= 0 || window <= 0 || !validChoice) {
+        std::fprintf(stderr, "Usage: gateway_bench [sessions] [orders per session] [pipeline window] [text|binary|both] "
+                             "[epoll|io_uring|both] [journal on|off] [port]\n");
+        return 1;
+    }
+    for (bool binary : {false, true}) {
+        if (protocol != "both" && binary != (protocol == "binary")) {
+            continue;
+        }
+        for (bool uring : {false, true}) {
+            if (backend != "both" && uring != (backend == "io_uring")) {
+                continue;
+            }
+            setup.binary = binary;
+            setup.uring = uring;
+            // One order at a time shows the bare round trip; the pipelined run shows throughput
+            runPhase("Latency", setup, 1, std::min(orders, 20000), 1);
+            runPhase("Throughput", setup, sessions, orders, window);
+        }
+    }
+    if (setup.journal) {
+        std::remove(BENCH_JOURNAL);
+    }
+    return 0;
+}
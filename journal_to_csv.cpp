@@ -0,0 +1,102 @@
+// Converts a TradeLogger journal into orders.csv, trades.csv and cancelled.csv
+// Usage: journal_to_csv [journal file, or base path of a segmented journal] [output directory]
+
+#include "Journal.h"
+#include "Instrument.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char* const ORDER_HEADER = "orderId,symbol,type,price,quantity,timestamp\n";
+static const char* const TRADE_HEADER = "tradeId,buyOrderId,sellOrderId,symbol,price,quantity,timestamp\n";
+
+static void writeOrder(std::ofstream& out, const JournalRecord& record, const Instrument& instrument) {
+    out << record.orderId << ","
+        << instrument.symbol << ","
+        << (static_cast<OrderType>(record.side) == BUY ? "BUY" : "SELL") << ","
+        << instrument.formatPrice(record.price) << ","
+        << record.quantity << ","
+        << record.wallNanos / 1000000LL << "\n";
+}
+
+static void writeTrade(std::ofstream& out, const JournalRecord& record, const Instrument& instrument) {
+    out << record.tradeId << ","
+        << record.orderId << ","
+        << record.sellOrderId << ","
+        << instrument.symbol << ","
+        << instrument.formatPrice(record.price) << ","
+        << record.quantity << ","
+        << record.wallNanos / 1000000LL << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string journalPath = argc > 1 ? argv[1] : "journal";
+    std::string outputDir = argc > 2 ? argv[2] : ".";
+
+    JournalReader reader(journalPath);
+    if (!reader.isOpen()) {
+        std::cerr << "Error: " << journalPath << ": " << reader.getError() << std::endl;
+        return 1;
+    }
+
+    std::ofstream orders(outputDir + "/orders.csv", std::ios::out | std::ios::trunc);
+    std::ofstream trades(outputDir + "/trades.csv", std::ios::out | std::ios::trunc);
+    std::ofstream cancelled(outputDir + "/cancelled.csv", std::ios::out | std::ios::trunc);
+    if (!orders.is_open() || !trades.is_open() || !cancelled.is_open()) {
+        std::cerr << "Error: Unable to create CSV files in " << outputDir << std::endl;
+        return 1;
+    }
+    orders << ORDER_HEADER;
+    trades << TRADE_HEADER;
+    cancelled << ORDER_HEADER;
+
+    std::vector<Instrument> instruments; // Current SYMBOL binding per SymbolId
+    std::size_t orderCount = 0, tradeCount = 0, cancelCount = 0, unbound = 0;
+    JournalRecord record;
+    while (reader.next(record)) {
+        if (record.type == JournalRecordType::SYMBOL) {
+            if (record.symbolId >= instruments.size()) {
+                instruments.resize(record.symbolId + 1);
+            }
+            Instrument& instrument = instruments[record.symbolId];
+            instrument.id = record.symbolId;
+            instrument.symbol = record.orderId;
+            instrument.tickSize = record.tickSize;
+            instrument.lotSize = record.quantity;
+            continue;
+        }
+        if (record.symbolId >= instruments.size() || instruments[record.symbolId].symbol.empty()) {
+            unbound++;
+            continue;
+        }
+        const Instrument& instrument = instruments[record.symbolId];
+        switch (record.type) {
+            case JournalRecordType::ORDER:
+                writeOrder(orders, record, instrument);
+                orderCount++;
+                break;
+            case JournalRecordType::TRADE:
+                writeTrade(trades, record, instrument);
+                tradeCount++;
+                break;
+            case JournalRecordType::CANCEL:
+                writeOrder(cancelled, record, instrument);
+                cancelCount++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    std::cout << "Converted " << reader.getLastSequence() << " records: " << orderCount << " orders, "
+              << tradeCount << " trades, " << cancelCount << " cancellations" << std::endl;
+    if (unbound > 0) {
+        std::cerr << "Warning: Skipped " << unbound << " records with no symbol binding" << std::endl;
+    }
+    if (reader.isDamaged()) {
+        std::cerr << "Warning: Stopped at a damaged record: " << reader.getError() << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -1,10 +1,16 @@
 
 #include "MatchingEngine.h"
 #include "TradeLogger.h"
+#include "JournalReplay.h"
+#include "Snapshot.h"
 #include "CLI.h"
 #include "Logger.h"
 #include "EmailNotifier.h"
 #include <iomanip>
+#include <algorithm>
+
+// Journal records between snapshots; restart replays at most about this many
+const std::uint64_t SNAPSHOT_INTERVAL_RECORDS = 100000;
 
 // Utility for colored CLI output
 void printColored(const std::string& text, int colorCode) {
@@ -16,9 +22,47 @@ int main() {
     Logger consoleLogger("vittcott_log.txt");
     EmailNotifier emailNotifier;
     MatchingEngine matchingEngine(consoleLogger, emailNotifier);
-    TradeLogger tradeLogger(consoleLogger);
+    // Rebuild the books left by earlier runs before accepting new orders: the newest snapshot, then the journal after it
+    ReplayStats replay = recoverEngine("snapshot", "journal", matchingEngine);
+    if (replay.records > 0 || !replay.snapshotPath.empty() || replay.damaged) {
+        printColored("Recovered: ", replay.damaged || replay.tradeMismatches > 0 || replay.snapshotsRejected > 0 ? 33 : 32);
+        std::cout << replay.toString() << "\n";
+    }
+
+    JournalOptions journalOptions;
+#ifndef _WIN32
+    journalOptions.backend = JournalBackend::MAPPED;
+    journalOptions.syncMode = JournalSyncMode::FDATASYNC;
+#endif
+    TradeLogger tradeLogger(consoleLogger, matchingEngine.getSymbols(), "journal", journalOptions);
+
+    // Captured between commands, once everything journaled has been applied; written and the journal
+    // truncated on the writer's thread
+    SnapshotWriter snapshotWriter("snapshot", "journal");
+    EngineSnapshot snapshot;
+    std::uint64_t lastSnapshotSequence = replay.lastSequence;
+    std::string lastSnapshotError;
+    auto takeSnapshot = [&]() {
+        std::uint64_t journalSequence = tradeLogger.getLastSequence();
+        if (journalSequence == 0 || journalSequence == lastSnapshotSequence || !tradeLogger.commit()) {
+            return;
+        }
+        matchingEngine.captureSnapshot(journalSequence, snapshot);
+        if (snapshotWriter.submit(snapshot)) {
+            lastSnapshotSequence = journalSequence;
+        }
+    };
 
     while (true) {
+        if (tradeLogger.getLastSequence() >= lastSnapshotSequence + SNAPSHOT_INTERVAL_RECORDS) {
+            takeSnapshot();
+        }
+        std::string snapshotError = snapshotWriter.getError();
+        if (!snapshotError.empty() && snapshotError != lastSnapshotError) {
+            consoleLogger.consoleLog("Error: " + snapshotError);
+            std::ofstream errLog("error.log", std::ios::app); errLog << "Snapshot failed: " << snapshotError << "\n";
+            lastSnapshotError = snapshotError;
+        }
         // Main CLI menu
         printColored("\n1. Place Order\n", 36);
         printColored("2. Modify Order\n", 36);
@@ -63,14 +107,18 @@ int main() {
                     continue;
                 }
                 std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                const Instrument& instrument = matchingEngine.getSymbols().getInstrument(symbol);
+                if (!instrument.isOnTick(price)) {
+                    printColored("Invalid price. Must be a multiple of the tick size.\n", 31);
+                    continue;
+                }
                 // Generate unique orderId and check for duplicates
                 std::string orderId;
                 bool unique = false;
                 int attempts = 0;
                 do {
                     orderId = "ORD-" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) + std::to_string(rand() % 10000);
-                    auto allOrders = matchingEngine.getAllOrders();
-                    unique = std::none_of(allOrders.begin(), allOrders.end(), [&](const Order& o) { return o.getOrderId() == orderId; });
+                    unique = !matchingEngine.hasOrder(orderId);
                     attempts++;
                 } while (!unique && attempts < 5);
                 if (!unique) {
@@ -78,14 +126,15 @@ int main() {
                     std::ofstream errLog("error.log", std::ios::app); errLog << "Failed to generate unique order ID after 5 attempts.\n";
                     continue;
                 }
-                Order order(orderId, symbol, type, price, quantity);
+                Order order(orderId, matchingEngine.internSymbol(symbol), type, instrument.toTicks(price), quantity);
                 tradeLogger.logOrder(order);
-                emailNotifier.sendOrderPlaced(order.toString());
+                emailNotifier.sendOrderPlaced(order.toString(symbol));
                 auto trades = matchingEngine.placeOrder(order);
                 for (const auto& trade : trades) {
-                    tradeLogger.logTrade(trade);
-                    emailNotifier.sendTradeNotification(trade.toString());
+                    tradeLogger.logTrade(trade); // The book has already queued the trade notifications
                 }
+                tradeLogger.commit(); // Durable before the order is acknowledged
+                emailNotifier.flush(); // Keeps the digest ahead of the next prompt
                 printColored("Order placed with ID: ", 32);
                 std::cout << orderId << "\n";
             } catch (const std::exception& ex) {
@@ -117,12 +166,23 @@ int main() {
             }
             std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
             try {
-                auto trades = matchingEngine.modifyOrder(orderId, newPrice, newQuantity);
+                const Instrument* instrument = matchingEngine.getOrderInstrument(orderId);
+                if (instrument == nullptr) {
+                    printColored("Order not found or already matched.\n", 31);
+                    continue;
+                }
+                if (!instrument->isOnTick(newPrice)) {
+                    printColored("Invalid price. Must be a multiple of the tick size.\n", 31);
+                    continue;
+                }
+                tradeLogger.logModifiedOrder(*matchingEngine.findOrder(orderId), instrument->toTicks(newPrice), newQuantity);
                 emailNotifier.sendOrderModified("Order ID: " + orderId + ", New Price: " + std::to_string(newPrice) + ", New Quantity: " + std::to_string(newQuantity));
+                auto trades = matchingEngine.modifyOrder(orderId, instrument->toTicks(newPrice), newQuantity);
                 for (const auto& trade : trades) {
                     tradeLogger.logTrade(trade);
-                    emailNotifier.sendTradeNotification(trade.toString());
                 }
+                tradeLogger.commit(); // Durable before the order is acknowledged
+                emailNotifier.flush();
                 printColored("Order modified.\n", 32);
             } catch (const std::exception& ex) {
                 printColored("Exception: ", 31);
@@ -134,8 +194,14 @@ int main() {
             std::cout << "Enter Order ID to cancel: ";
             std::getline(std::cin, orderId);
             try {
+                const Order* resting = matchingEngine.findOrder(orderId);
+                if (resting != nullptr) {
+                    tradeLogger.logCancelledOrder(*resting);
+                }
                 if (matchingEngine.cancelOrder(orderId)) {
+                    tradeLogger.commit();
                     emailNotifier.sendOrderCancelled("Order ID: " + orderId);
+                    emailNotifier.flush();
                 printColored("Order ", 32);
                 std::cout << orderId << " cancelled.\n";
                 } else {
@@ -162,6 +228,9 @@ int main() {
             try {
                 auto allOrders = matchingEngine.getAllOrders();
                 tradeLogger.saveAllOrders(allOrders);
+                // So the next start has nothing to replay
+                snapshotWriter.waitIdle();
+                takeSnapshot();
             printColored("All orders exported. Exiting.\n", 32);
                 break;
             } catch (const std::exception& ex) {
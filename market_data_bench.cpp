@@ -0,0 +1,328 @@
+// Loopback check and benchmark of the multicast market-data feed: an engine publishes a random order
+// flow while three receivers rebuild its books from 239.255.42.1 on the loopback interface. One
+// listens from the start, one discards some datagrams on purpose and one joins halfway, so the last
+// two have to recover from the snapshot channel. The first also feeds a MarketDataFanout with three
+// subscribers: a fast and a slow one on every symbol, and one that subscribes to a single symbol
+// halfway. At the end every receiver's and subscriber's books must equal the engine's and the two
+// subscribed from the start must have every trade; the exit status is 1 otherwise.
+// Usage: market_data_bench [orders] [symbols] [requests per flush]
+
+#include "MarketDataFanout.h"
+#include "MarketDataPublisher.h"
+#include "MarketDataReceiver.h"
+#include "MatchingEngine.h"
+#include "Logger.h"
+#include "EmailNotifier.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+// Polls one receiver on its own thread until it has applied everything up to target
+class ReceiverThread {
+public:
+    ReceiverThread(const char* receiverName, const MarketDataOptions& options, MarketDataHandler* handler = nullptr)
+        : name(receiverName), receiver(options, handler) {}
+
+    bool start() {
+        if (!receiver.start()) {
+            std::fprintf(stderr, "%s: %s\n", name, receiver.getError().c_str());
+            return false;
+        }
+        thread = std::thread([this] {
+            while (!stopping.load(std::memory_order_acquire)) {
+                if (!receiver.poll(10)) {
+                    std::fprintf(stderr, "%s: %s\n", name, receiver.getError().c_str());
+                    return;
+                }
+                std::uint64_t wanted = target.load(std::memory_order_acquire);
+                if (wanted != 0 && receiver.isSynced() && receiver.getNextSequence() == wanted) {
+                    caughtUp.store(true, std::memory_order_release);
+                }
+            }
+        });
+        return true;
+    }
+
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    const char* name;
+    MarketDataReceiver receiver;
+    std::atomic<std::uint64_t> target{0}; // Next sequence the publisher will use, once it is done
+    std::atomic<bool> caughtUp{false};
+
+private:
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+};
+
+// Reads one fan-out subscriber on its own thread, pausing after each poll, and rebuilds what it is sent
+class SubscriberThread {
+public:
+    SubscriberThread(const char* subscriberName, std::shared_ptr<MarketDataSubscriber> queue, std::size_t batch, int pause)
+        : name(subscriberName), subscriber(std::move(queue)), maxUpdates(batch), pauseMillis(pause) {}
+
+    void start() {
+        thread = std::thread([this] {
+            std::vector<FanoutUpdate> updates;
+            for (;;) {
+                bool draining = stopping.load(std::memory_order_acquire);
+                updates.clear();
+                std::size_t count = subscriber->poll(updates, maxUpdates, draining ? 0 : 10);
+                for (const FanoutUpdate& update : updates) {
+                    apply(update);
+                }
+                if ((draining && count == 0) || subscriber->isOverrun()) {
+                    return;
+                }
+                if (pauseMillis > 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(pauseMillis));
+                }
+            }
+        });
+    }
+
+    // Returns once everything queued so far has been read
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    BookDepth getDepth(SymbolId symbolId) const {
+        BookDepth depth;
+        if (symbolId < books.size()) {
+            for (auto level = books[symbolId].bids.rbegin(); level != books[symbolId].bids.rend(); ++level) {
+                depth.bids.push_back(level->second);
+            }
+            for (const auto& level : books[symbolId].asks) {
+                depth.asks.push_back(level.second);
+            }
+        }
+        return depth;
+    }
+
+    const char* name;
+    std::shared_ptr<MarketDataSubscriber> subscriber;
+    std::vector<MarketDataBook> books; // By SymbolId
+    std::vector<std::uint64_t> trades; // By SymbolId
+
+private:
+    std::size_t maxUpdates;
+    int pauseMillis;
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    void apply(const FanoutUpdate& update) {
+        if (update.symbolId >= books.size()) {
+            books.resize(update.symbolId + 1);
+            trades.resize(update.symbolId + 1, 0);
+        }
+        MarketDataBook& book = books[update.symbolId];
+        if (update.type == FanoutUpdateType::BOOK_RESET) {
+            book.bids.clear();
+            book.asks.clear();
+        } else if (update.type == FanoutUpdateType::TRADE) {
+            trades[update.symbolId]++;
+        } else {
+            auto& levels = update.side == MARKET_DATA_SIDE_BID ? book.bids : book.asks;
+            if (update.quantity == 0) {
+                levels.erase(update.price);
+            } else {
+                levels[update.price] = DepthLevel{update.price, update.quantity, update.orderCount};
+            }
+        }
+    }
+};
+
+static bool sameDepth(const BookDepth& expected, const BookDepth& actual) {
+    auto sameSide = [](const std::vector<DepthLevel>& a, const std::vector<DepthLevel>& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (a[i].price != b[i].price || a[i].totalQuantity != b[i].totalQuantity || a[i].orderCount != b[i].orderCount) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return sameSide(expected.bids, actual.bids) && sameSide(expected.asks, actual.asks);
+}
+
+int main(int argc, char* argv[]) {
+    const int orders = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const int symbolCount = argc > 2 ? std::atoi(argv[2]) : 8;
+    const int batch = argc > 3 ? std::atoi(argv[3]) : 16;
+    if (orders <= 0 || symbolCount <= 0 || batch <= 0) {
+        std::fprintf(stderr, "Usage: market_data_bench [orders] [symbols] [requests per flush]\n");
+        return 1;
+    }
+
+    Logger logger("market_data_bench.log");
+    logger.setEnabled(false);
+    EmailNotifier notifier;
+    notifier.setEnabled(false);
+    MatchingEngine engine(logger, notifier);
+    std::vector<SymbolId> symbols;
+    for (int i = 0; i < symbolCount; ++i) {
+        symbols.push_back(engine.internSymbol("SYM" + std::to_string(i)));
+    }
+
+    // Ports of their own, so runs on the same host do not hear each other
+    MarketDataOptions options;
+    options.incrementalPort = static_cast<std::uint16_t>(32000 + (::getpid() % 1000) * 2);
+    options.snapshotPort = static_cast<std::uint16_t>(options.incrementalPort + 1);
+    options.snapshotIntervalMillis = 100;
+    MarketDataOptions lossy = options;
+    lossy.dropOneIn = 50;
+
+    MarketDataFanout fanout;
+    std::vector<std::unique_ptr<SubscriberThread>> subscribers;
+    subscribers.push_back(std::make_unique<SubscriberThread>("fast", fanout.addSubscriber(), 1024, 0));
+    subscribers.push_back(std::make_unique<SubscriberThread>("slow", fanout.addSubscriber(), 64, 1));
+    subscribers.push_back(std::make_unique<SubscriberThread>("SYM0 halfway", fanout.addSubscriber(), 1024, 0));
+    for (std::size_t i = 0; i < 2; ++i) {
+        for (SymbolId symbolId : symbols) {
+            fanout.subscribe(*subscribers[i]->subscriber, engine.getSymbols().getName(symbolId));
+        }
+    }
+    for (auto& subscriber : subscribers) {
+        subscriber->start();
+    }
+
+    std::vector<std::unique_ptr<ReceiverThread>> receivers;
+    receivers.push_back(std::make_unique<ReceiverThread>("from start", options, &fanout));
+    receivers.push_back(std::make_unique<ReceiverThread>("lossy (1 in 50)", lossy));
+    receivers.push_back(std::make_unique<ReceiverThread>("late joiner", options));
+    for (std::size_t i = 0; i < 2; ++i) {
+        if (!receivers[i]->start()) {
+            return 1;
+        }
+    }
+
+    MarketDataPublisher publisher(options);
+    if (!publisher.start()) {
+        std::fprintf(stderr, "%s\n", publisher.getError().c_str());
+        return 1;
+    }
+    publisher.attach(engine);
+
+    // Prices wander around a mid of 10000 ticks; a third of the requests cancel or modify an earlier order
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> offset(-20, 20);
+    std::uniform_int_distribution<int> quantity(1, 100);
+    std::uniform_int_distribution<int> action(0, 5);
+    FillBuffer fills;
+    std::vector<std::uint64_t> trades(symbols.size(), 0); // By SymbolId
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < orders; ++i) {
+        if (i == orders / 2) {
+            if (!receivers[2]->start()) {
+                return 1;
+            }
+            fanout.subscribe(*subscribers[2]->subscriber, engine.getSymbols().getName(symbols[0]));
+        }
+        SymbolId symbolId = symbols[static_cast<std::size_t>(i) % symbols.size()];
+        int kind = action(random);
+        fills.clear();
+        if (kind == 0 && i > 0) {
+            engine.cancelOrder("O" + std::to_string(random() % static_cast<unsigned>(i)));
+        } else if (kind == 1 && i > 0) {
+            engine.modifyOrder("O" + std::to_string(random() % static_cast<unsigned>(i)), 10000 + offset(random), quantity(random), fills);
+        } else {
+            OrderType side = (random() & 1) ? BUY : SELL;
+            Price price = 10000 + offset(random) + (side == BUY ? -3 : 3);
+            engine.placeOrder(Order("O" + std::to_string(i), symbolId, side, price, quantity(random)), fills);
+        }
+        for (const Fill& fill : fills.getFills()) {
+            trades[fill.symbolId]++;
+        }
+        if ((i + 1) % batch == 0) {
+            publisher.flush();
+            std::this_thread::yield(); // Lets the receivers run on a single CPU
+        }
+    }
+    publisher.flush();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    for (auto& receiver : receivers) {
+        receiver->target.store(publisher.getNextSequence(), std::memory_order_release);
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (auto& receiver : receivers) {
+        while (!receiver->caughtUp.load(std::memory_order_acquire) && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        receiver->stop();
+    }
+
+    MarketDataStats stats = publisher.getStats();
+    std::printf("Published %d requests on %d symbols in %.3f s (%.0f requests/s), flushed every %d requests\n", orders, symbolCount, seconds,
+                orders / seconds, batch);
+    std::printf("  incremental: %llu messages in %llu datagrams (%.1f per datagram), %llu sendmmsg calls (%.3f per request), %llu send errors\n",
+                static_cast<unsigned long long>(stats.messages), static_cast<unsigned long long>(stats.datagrams),
+                stats.datagrams > 0 ? static_cast<double>(stats.messages) / stats.datagrams : 0.0,
+                static_cast<unsigned long long>(stats.sendCalls), static_cast<double>(stats.sendCalls) / orders,
+                static_cast<unsigned long long>(stats.sendErrors));
+    std::printf("  snapshot: %llu cycles, %llu datagrams\n", static_cast<unsigned long long>(stats.snapshotCycles),
+                static_cast<unsigned long long>(stats.snapshotDatagrams));
+
+    bool allMatch = true;
+    BookDepth expected;
+    BookDepth actual;
+    for (auto& entry : receivers) {
+        const MarketDataReceiver& receiver = entry->receiver;
+        bool match = entry->caughtUp.load(std::memory_order_acquire);
+        for (SymbolId symbolId : symbols) {
+            engine.getDepth(engine.getSymbols().getName(symbolId), std::numeric_limits<std::size_t>::max(), expected);
+            receiver.getDepth(symbolId, std::numeric_limits<std::size_t>::max(), actual);
+            match = match && sameDepth(expected, actual);
+        }
+        const MarketDataReceiverStats& received = receiver.getStats();
+        std::printf("Receiver %-16s %llu datagrams, %llu messages, %llu dropped, %llu gaps, %llu recoveries: books %s\n", entry->name,
+                    static_cast<unsigned long long>(received.datagrams), static_cast<unsigned long long>(received.messages),
+                    static_cast<unsigned long long>(received.dropped), static_cast<unsigned long long>(received.gaps),
+                    static_cast<unsigned long long>(received.recoveries), match ? "match the engine" : "DIFFER from the engine");
+        allMatch = allMatch && match;
+    }
+
+    for (auto& entry : subscribers) {
+        entry->stop();
+        bool subscribedFromStart = entry != subscribers.back();
+        bool booksMatch = !entry->subscriber->isOverrun();
+        bool tradesMatch = booksMatch;
+        std::uint64_t received = 0;
+        for (SymbolId symbolId : symbols) {
+            if (!subscribedFromStart && symbolId != symbols[0]) {
+                continue;
+            }
+            engine.getDepth(engine.getSymbols().getName(symbolId), std::numeric_limits<std::size_t>::max(), expected);
+            booksMatch = booksMatch && sameDepth(expected, entry->getDepth(symbolId));
+            std::uint64_t count = symbolId < entry->trades.size() ? entry->trades[symbolId] : 0;
+            tradesMatch = tradesMatch && (!subscribedFromStart || count == trades[symbolId]);
+            received += count;
+        }
+        SubscriberStats counters = entry->subscriber->getStats();
+        std::printf("Subscriber %-14s %llu queued, %llu delivered, %llu conflated, %llu book resets, %llu trades%s: books %s, trades %s\n", entry->name,
+                    static_cast<unsigned long long>(counters.queued), static_cast<unsigned long long>(counters.delivered),
+                    static_cast<unsigned long long>(counters.conflated), static_cast<unsigned long long>(counters.resets),
+                    static_cast<unsigned long long>(received), entry->subscriber->isOverrun() ? " (overrun)" : "",
+                    booksMatch ? "match" : "DIFFER", subscribedFromStart ? (tradesMatch ? "complete" : "MISSING") : "not checked");
+        allMatch = allMatch && booksMatch && tradesMatch;
+    }
+    return allMatch ? 0 : 1;
+}
@@ -32,13 +32,23 @@ def compile_cpp():
     
     # Source files in dependency order
     source_files = [
+        "EngineClock.cpp",
+        "LogFormat.cpp",
         "Logger.cpp",
+        "Instrument.cpp",
+        "SymbolDirectory.cpp",
         "EmailNotifier.cpp", 
         "Order.cpp",
         "Trade.cpp",
+        "IoUring.cpp",
+        "Journal.cpp",
+        "MappedJournal.cpp",
+        "JournalReplay.cpp",
+        "Snapshot.cpp",
         "TradeLogger.cpp",
         "OrderBook.cpp",
         "MatchingEngine.cpp",
+        "ShardedEngine.cpp",
         "main.cpp"
     ]
     
@@ -48,6 +58,7 @@ def compile_cpp():
         "-Wall",
         "-Wextra",
         "-O2",
+        "-pthread",
         "-I."
     ]
     
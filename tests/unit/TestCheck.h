@@ -0,0 +1,27 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <cstdio>
+
+// Minimal assertions for the C++ unit tests: a failed CHECK is reported and makes the test exit 1
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                            \
+    do {                                                                            \
+        if (!(condition)) {                                                         \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures()++;                                                       \
+        }                                                                           \
+    } while (0)
+
+#define RUN_TEST(test)                                          \
+    do {                                                        \
+        int before = testFailures();                            \
+        test();                                                 \
+        std::printf("%s %s\n", testFailures() == before ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+#endif // TEST_CHECK_H
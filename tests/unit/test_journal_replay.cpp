@@ -0,0 +1,247 @@
+// Crash recovery: a scripted session is journaled the way main.cpp does it, then replayed into a fresh engine
+#include "JournalReplay.h"
+#include "TradeLogger.h"
+#include "TestCheck.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string DIRECTORY = "journal_replay_test";
+const std::string JOURNAL = DIRECTORY + "/journal.bin";
+const std::string SNAPSHOTS = DIRECTORY + "/snapshot";
+const std::vector<std::string> SYMBOLS = {"AAA", "BBB"}; // BBB trades in lots of 10
+const std::size_t COMMANDS = 600;
+
+// Books, sequence and resting orders of an engine, compared before and after recovery
+struct EngineState {
+    std::vector<BookDepth> books;
+    std::vector<bool> present;
+    std::uint64_t sequence = 0;
+    std::vector<std::string> orderIds;
+
+    explicit EngineState(const MatchingEngine& engine) : sequence(engine.getLastSequence()) {
+        for (const std::string& symbol : SYMBOLS) {
+            BookDepth depth;
+            present.push_back(engine.getDepth(symbol, 1024, depth));
+            books.push_back(depth);
+        }
+        for (const Order& order : engine.getAllOrders()) {
+            orderIds.push_back(order.orderId);
+        }
+        std::sort(orderIds.begin(), orderIds.end());
+    }
+
+    bool operator==(const EngineState& other) const {
+        if (present != other.present || sequence != other.sequence || orderIds != other.orderIds) return false;
+        for (std::size_t i = 0; i < books.size(); ++i) {
+            if (!sameLevels(books[i].bids, other.books[i].bids) || !sameLevels(books[i].asks, other.books[i].asks)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool sameLevels(const std::vector<DepthLevel>& a, const std::vector<DepthLevel>& b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const DepthLevel& x, const DepthLevel& y) {
+            return x.price == y.price && x.totalQuantity == y.totalQuantity && x.orderCount == y.orderCount;
+        });
+    }
+};
+
+// An engine with its logging and notifications off
+struct Engine {
+    Logger logger{DIRECTORY + "/engine.log"};
+    EmailNotifier notifier;
+    MatchingEngine engine{logger, notifier};
+
+    Engine() {
+        logger.setEnabled(false);
+        notifier.setEnabled(false);
+    }
+};
+
+// The engine whose journal is recovered: every command is journaled before it is applied
+class Session : public Engine {
+public:
+    Session() : journal(new TradeLogger(logger, engine.getSymbols(), JOURNAL)), random(7) {
+        engine.internSymbol(SYMBOLS[0]);
+        engine.setInstrument(SYMBOLS[1], 0.05, 10);
+    }
+
+    // Places, modifies and cancels in a fixed pseudo-random mix around one price, so orders cross often
+    void run(std::size_t commands) {
+        for (std::size_t i = 0; i < commands; ++i) {
+            unsigned kind = random() % 10;
+            if (kind < 6 || placed.empty()) {
+                SymbolId symbolId = static_cast<SymbolId>(random() % SYMBOLS.size());
+                OrderType side = random() % 2 == 0 ? OrderType::BUY : OrderType::SELL;
+                Price price = 100 + static_cast<Price>(random() % 11);
+                int quantity = static_cast<int>(1 + random() % 5) * (symbolId == 1 ? 10 : 1);
+                place(Order("O" + std::to_string(placed.size()), symbolId, side, price, quantity));
+            } else if (kind < 8) {
+                const std::string& orderId = placed[random() % placed.size()];
+                Price price = 100 + static_cast<Price>(random() % 11);
+                const Instrument* instrument = engine.getOrderInstrument(orderId);
+                int quantity = static_cast<int>(1 + random() % 5) * (instrument != nullptr ? instrument->lotSize : 1);
+                modify(orderId, price, quantity);
+            } else {
+                cancel(placed[random() % placed.size()]);
+            }
+        }
+    }
+
+    void place(const Order& order) {
+        placed.push_back(order.orderId);
+        journal->logOrder(order);
+        for (const Trade& trade : engine.placeOrder(order)) {
+            journal->logTrade(trade);
+            trades++;
+        }
+        journal->commit();
+    }
+
+    void modify(const std::string& orderId, Price price, int quantity) {
+        const Order* resting = engine.findOrder(orderId);
+        if (resting == nullptr) return;
+        journal->logModifiedOrder(*resting, price, quantity);
+        for (const Trade& trade : engine.modifyOrder(orderId, price, quantity)) {
+            journal->logTrade(trade);
+            trades++;
+        }
+        journal->commit();
+    }
+
+    bool cancel(const std::string& orderId) {
+        const Order* resting = engine.findOrder(orderId);
+        if (resting == nullptr) return false;
+        journal->logCancelledOrder(*resting);
+        engine.cancelOrder(orderId);
+        journal->commit();
+        return true;
+    }
+
+    // Committed journal sequence, for a snapshot taken now
+    std::uint64_t journalSequence() {
+        journal->commit();
+        return journal->getLastSequence();
+    }
+
+    // Flushes and closes the journal, as a process exit would
+    void close() { journal.reset(); }
+
+    std::vector<std::string> placed;
+    std::uint64_t trades = 0;
+
+private:
+    std::unique_ptr<TradeLogger> journal;
+    std::mt19937 random;
+};
+
+void resetDirectory() {
+    std::filesystem::remove_all(DIRECTORY);
+    std::filesystem::create_directories(DIRECTORY);
+}
+
+void testReplayRebuildsBooksAndSequence() {
+    resetDirectory();
+    Session session;
+    session.run(COMMANDS);
+    session.close();
+    CHECK(session.trades > 0);
+
+    Engine recovered;
+    ReplayStats stats = replayJournal(JOURNAL, recovered.engine);
+    CHECK(stats.error.empty());
+    CHECK(!stats.damaged);
+    CHECK(stats.orders == session.placed.size());
+    CHECK(stats.modifies > 0);
+    CHECK(stats.cancels > 0);
+    CHECK(stats.tradesVerified == session.trades);
+    CHECK(stats.tradeMismatches == 0);
+    CHECK(EngineState(recovered.engine) == EngineState(session.engine));
+    CHECK(recovered.engine.getSymbols().getInstrument(SYMBOLS[1]).lotSize == 10);
+}
+
+// Replays a copy of the journal damaged by damage(); the last record, a cancel, must be left out
+template <typename Damage>
+void checkDamagedLastRecord(const std::string& copy, Damage damage) {
+    resetDirectory();
+    Session session;
+    session.run(COMMANDS);
+    std::string victim;
+    for (const std::string& orderId : session.placed) {
+        if (session.engine.hasOrder(orderId)) victim = orderId;
+    }
+    CHECK(!victim.empty());
+    EngineState beforeCancel(session.engine);
+    CHECK(session.cancel(victim));
+    session.close();
+
+    std::filesystem::copy_file(JOURNAL, copy);
+    damage(copy, std::filesystem::file_size(copy));
+
+    Engine recovered;
+    ReplayStats stats = replayJournal(copy, recovered.engine);
+    CHECK(stats.damaged);
+    CHECK(stats.tradeMismatches == 0);
+    CHECK(recovered.engine.hasOrder(victim));
+    CHECK(EngineState(recovered.engine) == beforeCancel);
+}
+
+void testTornLastRecordIsLeftOut() {
+    checkDamagedLastRecord(DIRECTORY + "/torn.bin", [](const std::string& path, std::uintmax_t size) {
+        std::filesystem::resize_file(path, size - sizeof(JournalRecord) / 2);
+    });
+}
+
+void testCorruptLastRecordIsLeftOut() {
+    checkDamagedLastRecord(DIRECTORY + "/corrupt.bin", [](const std::string& path, std::uintmax_t size) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(size - 8));
+        char byte = 0;
+        file.get(byte);
+        file.seekp(static_cast<std::streamoff>(size - 8));
+        file.put(static_cast<char>(byte ^ 0x5A));
+    });
+}
+
+void testSnapshotThenJournalTail() {
+    resetDirectory();
+    Session session;
+    session.run(COMMANDS / 2);
+    std::uint64_t journalSequence = session.journalSequence();
+    EngineSnapshot snapshot;
+    session.engine.captureSnapshot(journalSequence, snapshot);
+    CHECK(snapshot.write(snapshotPath(SNAPSHOTS, journalSequence), false));
+    session.run(COMMANDS / 2);
+    session.close();
+
+    Engine recovered;
+    ReplayStats stats = recoverEngine(SNAPSHOTS, JOURNAL, recovered.engine);
+    CHECK(stats.error.empty());
+    CHECK(stats.snapshotPath == snapshotPath(SNAPSHOTS, journalSequence));
+    CHECK(stats.snapshotOrders > 0);
+    CHECK(stats.skipped == journalSequence);
+    CHECK(stats.records > 0);
+    CHECK(!stats.damaged);
+    CHECK(stats.tradesVerified > 0);
+    CHECK(stats.tradeMismatches == 0);
+    CHECK(EngineState(recovered.engine) == EngineState(session.engine));
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testReplayRebuildsBooksAndSequence);
+    RUN_TEST(testTornLastRecordIsLeftOut);
+    RUN_TEST(testCorruptLastRecordIsLeftOut);
+    RUN_TEST(testSnapshotThenJournalTail);
+    std::filesystem::remove_all(DIRECTORY);
+    return testFailures() == 0 ? 0 : 1;
+}
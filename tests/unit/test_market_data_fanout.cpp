@@ -0,0 +1,228 @@
+// MarketDataFanout: what a fast and a slow subscriber each get, fed through onLevel / onTrade directly
+#include "MarketDataFanout.h"
+#include "TestCheck.h"
+#include <thread>
+#include <vector>
+
+namespace {
+
+// One symbol's book as the receiver would hand it over, with the updates applied to it
+class Feed {
+public:
+    explicit Feed(MarketDataFanout& target) : fanout(target) {
+        book.symbolId = 3;
+        book.symbol = "AAA";
+        book.tickSize = 0.01;
+    }
+
+    void level(Price price, int quantity) {
+        MarketDataLevel message{};
+        message.header.type = quantity > 0 ? MarketDataMessageType::MODIFY_LEVEL : MarketDataMessageType::DELETE_LEVEL;
+        message.symbolId = book.symbolId;
+        message.side = MARKET_DATA_SIDE_BID;
+        message.price = price;
+        message.quantity = quantity;
+        message.orderCount = quantity > 0 ? 1 : 0;
+        if (quantity > 0) {
+            book.bids[price] = DepthLevel{price, quantity, 1};
+        } else {
+            book.bids.erase(price);
+        }
+        fanout.onLevel(book, message);
+    }
+
+    void trade(std::uint64_t tradeId) {
+        MarketDataTrade message{};
+        message.header.type = MarketDataMessageType::TRADE;
+        message.symbolId = book.symbolId;
+        message.price = 100;
+        message.quantity = 1;
+        message.aggressorSide = MARKET_DATA_SIDE_ASK;
+        message.tradeId = tradeId;
+        fanout.onTrade(book, message);
+    }
+
+private:
+    MarketDataFanout& fanout;
+    MarketDataBook book;
+};
+
+std::vector<FanoutUpdate> drain(MarketDataSubscriber& subscriber) {
+    std::vector<FanoutUpdate> out;
+    while (subscriber.poll(out, 64, 0) > 0) {
+    }
+    return out;
+}
+
+bool isLevel(const FanoutUpdate& update, Price price, int quantity) {
+    return update.type == FanoutUpdateType::LEVEL && update.price == price && update.quantity == quantity;
+}
+
+bool isTrade(const FanoutUpdate& update, std::uint64_t tradeId) {
+    return update.type == FanoutUpdateType::TRADE && update.tradeId == tradeId;
+}
+
+void testSameLevelIsConflated() {
+    MarketDataFanout fanout;
+    auto fast = fanout.addSubscriber();
+    auto slow = fanout.addSubscriber();
+    fanout.subscribe(*fast, "AAA");
+    fanout.subscribe(*slow, "AAA");
+    Feed feed(fanout);
+
+    std::vector<FanoutUpdate> fastSeen;
+    auto step = [&](auto update) {
+        update();
+        std::vector<FanoutUpdate> batch = drain(*fast);
+        fastSeen.insert(fastSeen.end(), batch.begin(), batch.end());
+    };
+    step([&] { feed.level(100, 5); });
+    step([&] { feed.level(101, 3); });
+    step([&] { feed.trade(1); });
+    step([&] { feed.level(100, 7); });
+    step([&] { feed.level(100, 9); });
+
+    // The fast reader sees every step
+    CHECK(fastSeen.size() == 5);
+    CHECK(fastSeen.size() == 5 && isLevel(fastSeen[0], 100, 5) && isLevel(fastSeen[3], 100, 7) && isLevel(fastSeen[4], 100, 9));
+    CHECK(fast->getStats().conflated == 0);
+
+    // The slow one gets each level's latest state, queued behind the trade it came after
+    std::vector<FanoutUpdate> slowSeen = drain(*slow);
+    CHECK(slowSeen.size() == 3);
+    CHECK(slowSeen.size() == 3 && isLevel(slowSeen[0], 101, 3) && isTrade(slowSeen[1], 1) && isLevel(slowSeen[2], 100, 9));
+    CHECK(slow->getStats().conflated == 2);
+    CHECK(slow->getStats().delivered == 3);
+}
+
+void testTooManyLevelsResetTheBook() {
+    MarketDataFanoutOptions options;
+    options.maxPendingLevels = 4;
+    MarketDataFanout fanout(options);
+    auto fast = fanout.addSubscriber();
+    auto slow = fanout.addSubscriber();
+    fanout.subscribe(*fast, "AAA");
+    fanout.subscribe(*slow, "AAA");
+    Feed feed(fanout);
+
+    std::size_t fastLevels = 0;
+    for (Price price = 100; price < 110; ++price) {
+        feed.level(price, static_cast<int>(price));
+        fastLevels += drain(*fast).size();
+    }
+    feed.level(104, 0);
+    fastLevels += drain(*fast).size();
+    CHECK(fastLevels == 11);
+    CHECK(fast->getStats().resets == 0);
+
+    // Past four pending levels the slow reader's queue collapses into one book, read when it is delivered
+    std::vector<FanoutUpdate> slowSeen = drain(*slow);
+    CHECK(slow->getStats().resets == 1);
+    CHECK(!slowSeen.empty() && slowSeen[0].type == FanoutUpdateType::BOOK_RESET);
+    CHECK(slowSeen.size() == 10); // The reset, then the nine bids left, best first
+    bool bestFirst = slowSeen.size() == 10;
+    Price expected = 109;
+    for (std::size_t i = 1; bestFirst && i < slowSeen.size(); ++i, --expected) {
+        expected = expected == 104 ? 103 : expected;
+        bestFirst = isLevel(slowSeen[i], expected, static_cast<int>(expected));
+    }
+    CHECK(bestFirst);
+    CHECK(drain(*slow).empty());
+}
+
+void testTradesAreKeptUntilOverrun() {
+    MarketDataFanoutOptions options;
+    options.maxPendingLevels = 2;
+    options.maxPendingTrades = 3;
+    MarketDataFanout fanout(options);
+    auto fast = fanout.addSubscriber();
+    auto slow = fanout.addSubscriber();
+    fanout.subscribe(*fast, "AAA");
+    fanout.subscribe(*slow, "AAA");
+    Feed feed(fanout);
+    std::vector<std::uint64_t> fastTrades;
+    auto keepUp = [&] {
+        for (const FanoutUpdate& update : drain(*fast)) {
+            if (update.type == FanoutUpdateType::TRADE) fastTrades.push_back(update.tradeId);
+        }
+    };
+
+    // A book reset purges the queued levels but not the trades around them
+    feed.trade(1);
+    keepUp();
+    for (Price price = 100; price < 103; ++price) {
+        feed.level(price, 1);
+        keepUp();
+    }
+    feed.trade(2);
+    keepUp();
+    std::vector<FanoutUpdate> slowSeen = drain(*slow);
+    std::vector<std::uint64_t> trades;
+    for (const FanoutUpdate& update : slowSeen) {
+        if (update.type == FanoutUpdateType::TRADE) trades.push_back(update.tradeId);
+    }
+    CHECK(slow->getStats().resets == 1);
+    CHECK(trades == std::vector<std::uint64_t>({1, 2}));
+    CHECK(!slow->isOverrun());
+
+    // A fourth unread trade would have to be dropped, so the slow reader is cut off instead
+    for (std::uint64_t tradeId = 3; tradeId <= 6; ++tradeId) {
+        feed.trade(tradeId);
+        keepUp();
+    }
+    CHECK(slow->isOverrun());
+    CHECK(drain(*slow).empty());
+    feed.trade(7);
+    keepUp();
+    CHECK(drain(*slow).empty());
+
+    CHECK(!fast->isOverrun());
+    CHECK(fastTrades == std::vector<std::uint64_t>({1, 2, 3, 4, 5, 6, 7}));
+}
+
+void testSlowReaderDoesNotHoldBackFastOne() {
+    const std::uint64_t count = 20000;
+    MarketDataFanoutOptions options;
+    options.maxPendingTrades = count / 4;
+    MarketDataFanout fanout(options);
+    auto fast = fanout.addSubscriber();
+    auto slow = fanout.addSubscriber(); // Never polled
+    fanout.subscribe(*fast, "AAA");
+    fanout.subscribe(*slow, "AAA");
+    Feed feed(fanout);
+
+    std::uint64_t next = 1;
+    bool ordered = true;
+    std::thread reader([&] {
+        std::vector<FanoutUpdate> batch;
+        while (next <= count && !fast->isOverrun()) {
+            batch.clear();
+            fast->poll(batch, 256, 10);
+            for (const FanoutUpdate& update : batch) {
+                ordered = ordered && isTrade(update, next++);
+            }
+        }
+    });
+    // The producer never waits on a subscriber, so this finishes whatever the slow one does
+    for (std::uint64_t tradeId = 1; tradeId <= count; ++tradeId) {
+        feed.trade(tradeId);
+        if (tradeId % 16 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    reader.join();
+    CHECK(ordered);
+    CHECK(next == count + 1);
+    CHECK(!fast->isOverrun());
+    CHECK(slow->isOverrun());
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testSameLevelIsConflated);
+    RUN_TEST(testTooManyLevelsResetTheBook);
+    RUN_TEST(testTradesAreKeptUntilOverrun);
+    RUN_TEST(testSlowReaderDoesNotHoldBackFastOne);
+    return testFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+// MarketDataReceiver recovery, driven through process() with hand-built datagrams
+#include "MarketDataReceiver.h"
+#include "TestCheck.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const SymbolId OLD = 0; // Defined before every snapshot cycle below
+const SymbolId NEW = 1; // Defined after the second cycle starts
+
+class Datagram {
+public:
+    Datagram(MarketDataChannel channel, std::uint64_t sequence) : bytes(sizeof(MarketDataPacket)) {
+        MarketDataPacket* packet = header();
+        packet->sequence = sequence;
+        packet->length = sizeof(MarketDataPacket);
+        packet->channel = channel;
+        packet->version = MARKET_DATA_VERSION;
+    }
+
+    template <typename Message>
+    Datagram& add(const Message& message) {
+        std::size_t offset = bytes.size();
+        bytes.resize(offset + sizeof(Message));
+        std::memcpy(bytes.data() + offset, &message, sizeof(Message));
+        header()->length = static_cast<std::uint16_t>(bytes.size());
+        header()->messageCount++;
+        return *this;
+    }
+
+    void deliver(MarketDataReceiver& receiver) const { receiver.process(bytes.data(), bytes.size()); }
+
+private:
+    std::vector<char> bytes;
+
+    MarketDataPacket* header() { return reinterpret_cast<MarketDataPacket*>(bytes.data()); }
+};
+
+MarketDataHeader header(MarketDataMessageType type) {
+    MarketDataHeader result{};
+    result.length = static_cast<std::uint16_t>(marketDataMessageSize(type));
+    result.type = type;
+    return result;
+}
+
+MarketDataLevel level(MarketDataMessageType type, SymbolId symbolId, Price price, int quantity) {
+    MarketDataLevel message{};
+    message.header = header(type);
+    message.symbolId = symbolId;
+    message.price = price;
+    message.quantity = quantity;
+    message.orderCount = quantity > 0 ? 1 : 0;
+    message.side = MARKET_DATA_SIDE_BID;
+    return message;
+}
+
+MarketDataSymbol symbol(SymbolId symbolId, const char* name) {
+    MarketDataSymbol message{};
+    message.header = header(MarketDataMessageType::SYMBOL);
+    message.symbolId = symbolId;
+    message.tickSize = 0.01;
+    std::strncpy(message.symbol, name, MARKET_DATA_SYMBOL_LENGTH);
+    return message;
+}
+
+MarketDataSnapshotBegin begin(std::uint32_t bookCount, std::uint64_t sequence) {
+    MarketDataSnapshotBegin message{};
+    message.header = header(MarketDataMessageType::SNAPSHOT_BEGIN);
+    message.bookCount = bookCount;
+    message.sequence = sequence;
+    return message;
+}
+
+MarketDataSnapshotBook book(SymbolId symbolId, std::uint64_t lastSequence, std::uint32_t bidCount) {
+    MarketDataSnapshotBook message{};
+    message.header = header(MarketDataMessageType::SNAPSHOT_BOOK);
+    message.symbolId = symbolId;
+    message.lastSequence = lastSequence;
+    message.bidCount = bidCount;
+    return message;
+}
+
+int bidQuantity(const MarketDataReceiver& receiver, SymbolId symbolId, Price price) {
+    const MarketDataBook* found = receiver.findBook(symbolId);
+    if (found == nullptr) {
+        return -1;
+    }
+    auto entry = found->bids.find(price);
+    return entry == found->bids.end() ? 0 : entry->second.totalQuantity;
+}
+
+// The feed up to sequence 4: OLD is defined (1), gets a bid at 100 (2), which grows (3), and one at 99 (4)
+const std::uint64_t FIRST_CYCLE = 2;
+Datagram oldDefined() {
+    return Datagram(MarketDataChannel::INCREMENTAL, 1)
+        .add(symbol(OLD, "OLD"))
+        .add(level(MarketDataMessageType::ADD_LEVEL, OLD, 100, 10));
+}
+Datagram oldModified() {
+    return Datagram(MarketDataChannel::INCREMENTAL, 3).add(level(MarketDataMessageType::MODIFY_LEVEL, OLD, 100, 15));
+}
+Datagram oldAdded() {
+    return Datagram(MarketDataChannel::INCREMENTAL, 4).add(level(MarketDataMessageType::ADD_LEVEL, OLD, 99, 5));
+}
+// A cycle that started at sequence 2, with OLD copied once it reflected 3
+Datagram firstCycle() {
+    return Datagram(MarketDataChannel::SNAPSHOT, 0)
+        .add(begin(1, FIRST_CYCLE))
+        .add(symbol(OLD, "OLD"))
+        .add(book(OLD, 3, 1))
+        .add(level(MarketDataMessageType::SNAPSHOT_LEVEL, OLD, 100, 15));
+}
+
+// Then NEW is defined with a bid at 50 (5, 6) and OLD's bid at 100 goes (7). A cycle started at 4 but
+// only copied OLD once it reflected 7, so it has no NEW.
+const std::uint64_t SECOND_CYCLE = 4;
+Datagram newDefined() {
+    return Datagram(MarketDataChannel::INCREMENTAL, 5)
+        .add(symbol(NEW, "NEW"))
+        .add(level(MarketDataMessageType::ADD_LEVEL, NEW, 50, 7));
+}
+Datagram oldDeleted() {
+    return Datagram(MarketDataChannel::INCREMENTAL, 7).add(level(MarketDataMessageType::DELETE_LEVEL, OLD, 100, 0));
+}
+Datagram secondCycle(std::uint64_t packetNumber) {
+    return Datagram(MarketDataChannel::SNAPSHOT, packetNumber)
+        .add(begin(1, SECOND_CYCLE))
+        .add(symbol(OLD, "OLD"))
+        .add(book(OLD, 7, 1))
+        .add(level(MarketDataMessageType::SNAPSHOT_LEVEL, OLD, 99, 5));
+}
+
+void testJoinsFromSnapshotAndReplaysBuffer() {
+    MarketDataReceiver receiver;
+    CHECK(!receiver.isSynced());
+    oldModified().deliver(receiver); // Buffered: the receiver joined after sequence 2
+    CHECK(!receiver.isSynced());
+    firstCycle().deliver(receiver);
+    CHECK(receiver.isSynced());
+    CHECK(receiver.getNextSequence() == 4);
+    CHECK(bidQuantity(receiver, OLD, 100) == 15);
+    oldAdded().deliver(receiver);
+    CHECK(receiver.getNextSequence() == 5);
+    CHECK(bidQuantity(receiver, OLD, 99) == 5);
+    CHECK(receiver.getStats().recoveries == 1);
+}
+
+void testRecoversFromGap() {
+    MarketDataReceiver receiver;
+    oldDefined().deliver(receiver);
+    firstCycle().deliver(receiver);
+    oldModified().deliver(receiver);
+    CHECK(receiver.isSynced());
+    oldAdded().deliver(receiver);
+    CHECK(receiver.getNextSequence() == 5);
+
+    // Sequences 5 and 6 are lost
+    oldDeleted().deliver(receiver);
+    CHECK(!receiver.isSynced());
+    CHECK(receiver.getStats().gaps == 1);
+    // The second cycle started before the hole, and NEW is not in it: wait for a later one
+    secondCycle(1).deliver(receiver);
+    CHECK(!receiver.isSynced());
+
+    // A cycle that started at 7 has both books
+    Datagram(MarketDataChannel::SNAPSHOT, 2)
+        .add(begin(2, 7))
+        .add(symbol(OLD, "OLD"))
+        .add(book(OLD, 7, 1))
+        .add(level(MarketDataMessageType::SNAPSHOT_LEVEL, OLD, 99, 5))
+        .add(symbol(NEW, "NEW"))
+        .add(book(NEW, 7, 1))
+        .add(level(MarketDataMessageType::SNAPSHOT_LEVEL, NEW, 50, 7))
+        .deliver(receiver);
+    CHECK(receiver.isSynced());
+    CHECK(receiver.getNextSequence() == 8);
+    CHECK(bidQuantity(receiver, OLD, 100) == 0);
+    CHECK(bidQuantity(receiver, NEW, 50) == 7);
+    CHECK(receiver.getStats().recoveries == 2);
+}
+
+void testBookDefinedDuringCycleComesFromBuffer() {
+    MarketDataReceiver receiver;
+    newDefined().deliver(receiver);
+    oldDeleted().deliver(receiver);
+    secondCycle(0).deliver(receiver);
+    CHECK(receiver.isSynced());
+    CHECK(receiver.getNextSequence() == 8);
+    const MarketDataBook* added = receiver.findBook(NEW);
+    CHECK(added != nullptr && added->symbol == "NEW");
+    CHECK(bidQuantity(receiver, NEW, 50) == 7);
+    CHECK(bidQuantity(receiver, OLD, 100) == 0);
+    CHECK(bidQuantity(receiver, OLD, 99) == 5);
+}
+
+void testWaitsWhenBufferStartsAfterCycle() {
+    // Sequences 5 and 6 arrived before this receiver joined: the cycle alone cannot rebuild NEW
+    MarketDataReceiver receiver;
+    oldDeleted().deliver(receiver);
+    secondCycle(0).deliver(receiver);
+    CHECK(!receiver.isSynced());
+    CHECK(receiver.findBook(NEW) == nullptr);
+}
+
+void testWaitsWithEmptyBufferWhenCycleMovedOn() {
+    // Nothing buffered yet, and OLD reflects sequences past the cycle's start that NEW needs
+    MarketDataReceiver receiver;
+    secondCycle(0).deliver(receiver);
+    CHECK(!receiver.isSynced());
+
+    // A cycle no book moved past is enough on its own
+    MarketDataReceiver quiet;
+    Datagram(MarketDataChannel::SNAPSHOT, 0)
+        .add(begin(1, 3))
+        .add(symbol(OLD, "OLD"))
+        .add(book(OLD, 3, 1))
+        .add(level(MarketDataMessageType::SNAPSHOT_LEVEL, OLD, 100, 15))
+        .deliver(quiet);
+    CHECK(quiet.isSynced());
+    CHECK(quiet.getNextSequence() == 4);
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testJoinsFromSnapshotAndReplaysBuffer);
+    RUN_TEST(testRecoversFromGap);
+    RUN_TEST(testBookDefinedDuringCycleComesFromBuffer);
+    RUN_TEST(testWaitsWhenBufferStartsAfterCycle);
+    RUN_TEST(testWaitsWithEmptyBufferWhenCycleMovedOn);
+    return testFailures() == 0 ? 0 : 1;
+}
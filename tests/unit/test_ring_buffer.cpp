@@ -0,0 +1,156 @@
+// SpscRing and MpscRing: capacity, wraparound, batch drain and per-producer order across threads
+#include "RingBuffer.h"
+#include "TestCheck.h"
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Item {
+    std::uint32_t producer;
+    std::uint64_t sequence;
+};
+
+void testSpscFillsToCapacityAndWraps() {
+    SpscRing<Item> ring(5);
+    CHECK(ring.getCapacity() == 8);
+    Item item{};
+    CHECK(!ring.tryPop(item));
+
+    // Pushing and popping in uneven steps walks the indices around the slots many times
+    std::uint64_t pushed = 0;
+    std::uint64_t popped = 0;
+    bool ordered = true;
+    for (int round = 0; round < 50; ++round) {
+        while (ring.tryPush(Item{0, pushed})) {
+            pushed++;
+        }
+        CHECK(ring.size() == 8);
+        for (int i = 0; i < 3 + round % 5 && ring.tryPop(item); ++i) {
+            ordered = ordered && item.sequence == popped++;
+        }
+    }
+    while (ring.tryPop(item)) {
+        ordered = ordered && item.sequence == popped++;
+    }
+    CHECK(ordered);
+    CHECK(popped == pushed);
+    CHECK(pushed > 8 * 20);
+}
+
+void testSpscDrainsInBatches() {
+    SpscRing<Item> ring(8);
+    for (std::uint64_t i = 0; i < 6; ++i) {
+        CHECK(ring.tryPush(Item{0, i}));
+    }
+    std::vector<std::uint64_t> seen;
+    auto collect = [&](const Item& item) { seen.push_back(item.sequence); };
+    CHECK(ring.drain(collect, 4) == 4);
+    CHECK(ring.size() == 2);
+    // Slots freed by the batch are reusable, across the wrap
+    for (std::uint64_t i = 6; i < 12; ++i) {
+        CHECK(ring.tryPush(Item{0, i}));
+    }
+    CHECK(!ring.tryPush(Item{0, 12}));
+    CHECK(ring.drain(collect, 100) == 8);
+    CHECK(ring.drain(collect, 100) == 0);
+    CHECK(seen.size() == 12);
+    for (std::size_t i = 0; i < seen.size(); ++i) {
+        CHECK(seen[i] == i);
+    }
+}
+
+void testSpscAcrossThreads() {
+    const std::uint64_t count = 200000;
+    SpscRing<Item> ring(64);
+    std::thread producer([&] {
+        for (std::uint64_t i = 0; i < count; ++i) {
+            while (!ring.tryPush(Item{0, i})) {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::uint64_t next = 0;
+    bool ordered = true;
+    while (next < count) {
+        if (ring.drain([&](const Item& item) { ordered = ordered && item.sequence == next++; }, 16) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(ordered);
+    Item item{};
+    CHECK(!ring.tryPop(item));
+}
+
+void testMpscFillsToCapacityAndWraps() {
+    MpscRing<Item> ring(4);
+    CHECK(ring.getCapacity() == 4);
+    std::uint64_t pushed = 0;
+    std::uint64_t popped = 0;
+    bool ordered = true;
+    Item item{};
+    CHECK(!ring.tryPop(item));
+    for (int round = 0; round < 50; ++round) {
+        while (ring.tryPush(Item{0, pushed})) {
+            pushed++;
+        }
+        std::size_t batch = ring.drain([&](const Item& drained) { ordered = ordered && drained.sequence == popped++; }, 1 + round % 3);
+        CHECK(batch == 1 + static_cast<std::size_t>(round % 3));
+    }
+    while (ring.tryPop(item)) {
+        ordered = ordered && item.sequence == popped++;
+    }
+    CHECK(ordered);
+    CHECK(popped == pushed);
+}
+
+void testMpscKeepsEachProducersOrder() {
+    const std::uint32_t producers = 4;
+    const std::uint64_t perProducer = 50000;
+    MpscRing<Item> ring(256);
+    std::vector<std::thread> threads;
+    for (std::uint32_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&ring, p, perProducer] {
+            for (std::uint64_t i = 0; i < perProducer; ++i) {
+                while (!ring.tryPush(Item{p, i})) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    // Producers interleave arbitrarily, but each one's items must come out in the order it pushed them
+    std::vector<std::uint64_t> next(producers, 0);
+    std::uint64_t received = 0;
+    bool ordered = true;
+    while (received < producers * perProducer) {
+        std::size_t batch = ring.drain([&](const Item& item) {
+            ordered = ordered && item.producer < producers && item.sequence == next[item.producer]++;
+        }, 32);
+        if (batch == 0) {
+            std::this_thread::yield();
+        }
+        received += batch;
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    CHECK(ordered);
+    for (std::uint32_t p = 0; p < producers; ++p) {
+        CHECK(next[p] == perProducer);
+    }
+    Item item{};
+    CHECK(!ring.tryPop(item));
+}
+
+} // namespace
+
+int main() {
+    RUN_TEST(testSpscFillsToCapacityAndWraps);
+    RUN_TEST(testSpscDrainsInBatches);
+    RUN_TEST(testSpscAcrossThreads);
+    RUN_TEST(testMpscFillsToCapacityAndWraps);
+    RUN_TEST(testMpscKeepsEachProducersOrder);
+    return testFailures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,291 @@
+// ShardedEngine: routing by symbol, per-shard events, back-pressure, idle waits, shutdown and pinning
+#include "ShardedEngine.h"
+#include "TestCheck.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+
+const std::string DIRECTORY = "sharded_engine_test";
+
+ShardedEngineOptions shardOptions(std::size_t shardCount, CommandRingMode producers = CommandRingMode::MULTI_PRODUCER) {
+    ShardedEngineOptions options;
+    options.shardCount = shardCount;
+    options.orderCapacityPerShard = 1024;
+    options.logPrefix = DIRECTORY + "/shard";
+    options.commandRingCapacity = 1024;
+    options.eventRingCapacity = 1024;
+    options.producers = producers;
+    return options;
+}
+
+// Notifications off; the shard loggers write into DIRECTORY
+struct Quiet {
+    Quiet() {
+        std::filesystem::create_directories(DIRECTORY);
+        notifier.setEnabled(false);
+    }
+    EmailNotifier notifier;
+};
+
+Order order(const std::string& orderId, SymbolId symbolId, OrderType side, Price price, int quantity) {
+    return Order(orderId, symbolId, side, price, quantity);
+}
+
+// Everything the shard has published, polling until `expected` events arrived or a few seconds passed
+std::vector<EngineEvent> collect(ShardedEngine& engine, std::size_t shard, std::size_t expected) {
+    std::vector<EngineEvent> events;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (events.size() < expected && std::chrono::steady_clock::now() < deadline) {
+        if (engine.pollEvents(shard, [&](const EngineEvent& event) { events.push_back(event); }) == 0) {
+            std::this_thread::yield();
+        }
+    }
+    engine.pollEvents(shard, [&](const EngineEvent& event) { events.push_back(event); });
+    return events;
+}
+
+bool isEvent(const EngineEvent& event, EngineEventType type, EngineCommandType command, const std::string& orderId, bool resting) {
+    return event.type == type && (type == EngineEventType::FILL || event.command == command) && orderId == event.orderId &&
+           event.resting == resting;
+}
+
+void checkRoutesBySymbol(CommandRingMode producers) {
+    Quiet quiet;
+    ShardedEngine engine(quiet.notifier, shardOptions(2, producers));
+    SymbolId aaa = engine.internSymbol("AAA");
+    SymbolId bbb = engine.internSymbol("BBB");
+    SymbolId ccc = engine.internSymbol("CCC");
+    CHECK(engine.shardFor(aaa) == 0);
+    CHECK(engine.shardFor(bbb) == 1);
+    CHECK(engine.shardFor(ccc) == 0);
+    CHECK(!engine.placeOrder(order("EARLY", aaa, BUY, 100, 1))); // Not running yet
+
+    engine.start();
+    CHECK(engine.isRunning());
+    // Shard 0: AAA and CCC
+    CHECK(engine.placeOrder(order("S1", aaa, SELL, 100, 10)));
+    CHECK(engine.placeOrder(order("A2", aaa, BUY, 100, 4)));
+    CHECK(engine.placeOrder(order("S1", ccc, SELL, 105, 1)));  // Order IDs are unique per shard
+    CHECK(engine.cancelOrder(ccc, "NOPE"));
+    CHECK(engine.cancelOrder(aaa, "S1"));
+    // Shard 1: BBB
+    CHECK(engine.placeOrder(order("B1", bbb, SELL, 200, 5)));
+    CHECK(engine.placeOrder(order("B2", bbb, BUY, 201, 5)));
+    CHECK(engine.modifyOrder(bbb, "B1", 199, 5));              // Filled already
+    CHECK(engine.placeOrder(order("S1", bbb, BUY, 150, 2)));   // Another shard's index
+    CHECK(!engine.placeOrder(order("X", static_cast<SymbolId>(3), BUY, 100, 1)));
+    CHECK(!engine.cancelOrder(aaa, std::string(MAX_ORDER_ID_LENGTH + 1, 'L')));
+
+    engine.waitUntilIdle();
+    CHECK(engine.getProcessedCount() == 9);
+    CHECK(engine.getRejectedCount() == 3);
+
+    std::vector<EngineEvent> first = collect(engine, 0, 6);
+    CHECK(first.size() == 6);
+    if (first.size() == 6) {
+        CHECK(isEvent(first[0], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "S1", true));
+        CHECK(isEvent(first[1], EngineEventType::FILL, EngineCommandType::PLACE, "A2", true)); // S1 keeps 6
+        CHECK(first[1].fill.quantity == 4 && first[1].fill.price == 100 && first[1].fill.aggressorSide == BUY);
+        CHECK(std::string(first[1].fill.sellOrderId) == "S1");
+        CHECK(isEvent(first[2], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "A2", false));
+        CHECK(isEvent(first[3], EngineEventType::REJECTED, EngineCommandType::PLACE, "S1", false));
+        CHECK(isEvent(first[4], EngineEventType::REJECTED, EngineCommandType::CANCEL, "NOPE", false));
+        CHECK(isEvent(first[5], EngineEventType::ACCEPTED, EngineCommandType::CANCEL, "S1", false));
+    }
+    std::vector<EngineEvent> second = collect(engine, 1, 5);
+    CHECK(second.size() == 5);
+    if (second.size() == 5) {
+        CHECK(isEvent(second[0], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "B1", true));
+        CHECK(isEvent(second[1], EngineEventType::FILL, EngineCommandType::PLACE, "B2", false)); // B1 is done
+        CHECK(second[1].fill.price == 200 && second[1].fill.quantity == 5);
+        CHECK(isEvent(second[2], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "B2", false));
+        CHECK(isEvent(second[3], EngineEventType::REJECTED, EngineCommandType::MODIFY, "B1", false));
+        CHECK(isEvent(second[4], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "S1", true));
+    }
+    for (std::size_t shard = 0; shard < 2; ++shard) {
+        for (const EngineEvent& event : shard == 0 ? first : second) {
+            CHECK(engine.shardFor(event.symbolId) == shard);
+        }
+    }
+
+    engine.stop();
+    CHECK(!engine.isRunning());
+    CHECK(!engine.placeOrder(order("LATE", aaa, BUY, 100, 1)));
+}
+
+void testRoutesBySymbolWithSharedRings() {
+    checkRoutesBySymbol(CommandRingMode::MULTI_PRODUCER);
+}
+
+void testRoutesBySymbolWithSingleProducerRings() {
+    checkRoutesBySymbol(CommandRingMode::SINGLE_PRODUCER);
+}
+
+void testSubmitsFromSeveralThreads() {
+    Quiet quiet;
+    ShardedEngine engine(quiet.notifier, shardOptions(2));
+    std::vector<SymbolId> symbols = {engine.internSymbol("AAA"), engine.internSymbol("BBB")};
+    engine.start();
+    const int perThread = 200;
+    std::vector<std::thread> frontEnds;
+    for (int t = 0; t < 4; ++t) {
+        frontEnds.emplace_back([&engine, &symbols, t, perThread] {
+            for (int i = 0; i < perThread; ++i) {
+                // Resting bids far apart, so nothing trades and every request is accepted
+                Order bid("T" + std::to_string(t) + "-" + std::to_string(i), symbols[static_cast<std::size_t>(i % 2)], BUY, 1 + t, 1);
+                while (!engine.placeOrder(bid)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (std::thread& frontEnd : frontEnds) {
+        frontEnd.join();
+    }
+    // The event rings hold every answer, so waiting for the shards needs no consumer
+    engine.waitUntilIdle();
+    CHECK(engine.getProcessedCount() == 4 * perThread);
+    CHECK(engine.getRejectedCount() == 0);
+    std::size_t accepted = 0;
+    for (std::size_t shard = 0; shard < 2; ++shard) {
+        for (const EngineEvent& event : collect(engine, shard, 2 * perThread)) {
+            accepted += event.type == EngineEventType::ACCEPTED && event.resting && engine.shardFor(event.symbolId) == shard;
+        }
+    }
+    CHECK(accepted == 4 * perThread);
+}
+
+void testConfiguresSymbolsBeforeAndAfterStart() {
+    Quiet quiet;
+    ShardedEngine engine(quiet.notifier, shardOptions(2));
+    CHECK(engine.setInstrument("LOTS", 0.05, 10));
+    SymbolId lots = engine.getSymbols().find("LOTS");
+    engine.start();
+    CHECK(engine.placeOrder(order("L1", lots, BUY, 100, 5)));   // Not a whole lot
+    CHECK(engine.placeOrder(order("L2", lots, BUY, 100, 20)));
+    CHECK(!engine.setInstrument("LOTS", 0.01, 1));              // Traded already
+    CHECK(engine.setInstrument("LATE", 1.0, 100));              // A new symbol while running
+    SymbolId late = engine.getSymbols().find("LATE");
+    CHECK(engine.placeOrder(order("N1", late, SELL, 7, 100)));
+    engine.waitUntilIdle();
+
+    std::vector<EngineEvent> events = collect(engine, engine.shardFor(lots), 2);
+    CHECK(events.size() == 2 && events[0].type == EngineEventType::REJECTED && events[1].type == EngineEventType::ACCEPTED);
+    events = collect(engine, engine.shardFor(late), engine.shardFor(late) == engine.shardFor(lots) ? 0 : 1);
+    CHECK(!events.empty() && isEvent(events.back(), EngineEventType::ACCEPTED, EngineCommandType::PLACE, "N1", true));
+    CHECK(engine.getSymbols().getInstrument(late).lotSize == 100);
+}
+
+void testFullEventRingPushesBackWithoutBlocking() {
+    Quiet quiet;
+    ShardedEngineOptions options = shardOptions(1);
+    options.commandRingCapacity = 8;
+    options.eventRingCapacity = 4;
+    ShardedEngine engine(quiet.notifier, options);
+    SymbolId symbol = engine.internSymbol("AAA");
+    engine.start();
+
+    // Nobody polls: the shard parks answers in its backlog and stops taking commands, so the
+    // command ring fills and submissions fail rather than wait
+    int submitted = 0;
+    bool refused = false;
+    for (int i = 0; i < 10000 && !refused; ++i) {
+        if (engine.placeOrder(order("P" + std::to_string(submitted), symbol, BUY, 100, 1))) {
+            submitted++;
+        } else {
+            refused = true;
+        }
+    }
+    CHECK(refused);
+
+    std::vector<EngineEvent> events = collect(engine, 0, static_cast<std::size_t>(submitted));
+    CHECK(events.size() == static_cast<std::size_t>(submitted));
+    bool ordered = true;
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        ordered = ordered && isEvent(events[i], EngineEventType::ACCEPTED, EngineCommandType::PLACE, "P" + std::to_string(i), true);
+    }
+    CHECK(ordered);
+    CHECK(engine.placeOrder(order("AGAIN", symbol, BUY, 100, 1)));
+    engine.waitUntilIdle();
+    CHECK(collect(engine, 0, 1).size() == 1);
+
+    // stop() still returns with answers waiting, and they stay available afterwards
+    int pending = 0;
+    while (engine.placeOrder(order("Q" + std::to_string(pending), symbol, BUY, 100, 1))) {
+        pending++;
+    }
+    engine.stop();
+    events = collect(engine, 0, static_cast<std::size_t>(pending));
+    CHECK(pending > 0 && events.size() == static_cast<std::size_t>(pending));
+    CHECK(!events.empty() && std::string(events.back().orderId) == "Q" + std::to_string(pending - 1));
+}
+
+void testStopDrainsQueuedCommands() {
+    Quiet quiet;
+    ShardedEngine engine(quiet.notifier, shardOptions(2));
+    SymbolId aaa = engine.internSymbol("AAA");
+    SymbolId bbb = engine.internSymbol("BBB");
+    engine.start();
+    for (int i = 0; i < 100; ++i) {
+        CHECK(engine.placeOrder(order("D" + std::to_string(i), i % 2 == 0 ? aaa : bbb, SELL, 100 + i, 1)));
+    }
+    engine.stop();
+    CHECK(engine.getProcessedCount() == 100);
+    CHECK(collect(engine, 0, 50).size() + collect(engine, 1, 50).size() == 100);
+}
+
+void testPinsShardThreads() {
+#ifdef __linux__
+    Quiet quiet;
+    std::filesystem::remove(DIRECTORY + "/pinned1.log");
+    int fillCpu = -1;
+    {
+        ShardedEngineOptions options = shardOptions(2);
+        options.logPrefix = DIRECTORY + "/pinned";
+        ShardedEngine engine(quiet.notifier, options);
+        // A caller's sink runs on the shard's thread and takes the fills in place of the event ring
+        auto sink = makeFillSink([&fillCpu](const Fill&) { fillCpu = sched_getcpu(); });
+        engine.setFillSink(0, &sink);
+        SymbolId aaa = engine.internSymbol("AAA");
+        // Shard 1 asks for a CPU that does not exist and runs unpinned
+        engine.start({0, CPU_SETSIZE});
+        CHECK(engine.placeOrder(order("S", aaa, SELL, 100, 1)));
+        CHECK(engine.placeOrder(order("B", aaa, BUY, 100, 1)));
+        engine.waitUntilIdle();
+        std::vector<EngineEvent> events = collect(engine, 0, 2);
+        CHECK(events.size() == 2);
+        for (const EngineEvent& event : events) {
+            CHECK(event.type == EngineEventType::ACCEPTED);
+        }
+    }
+    CHECK(fillCpu == 0);
+    std::ifstream log(DIRECTORY + "/pinned1.log");
+    std::stringstream text;
+    text << log.rdbuf();
+    CHECK(text.str().find("Could not pin shard 1") != std::string::npos);
+#endif
+}
+
+} // namespace
+
+int main() {
+    std::filesystem::remove_all(DIRECTORY);
+    RUN_TEST(testRoutesBySymbolWithSharedRings);
+    RUN_TEST(testRoutesBySymbolWithSingleProducerRings);
+    RUN_TEST(testSubmitsFromSeveralThreads);
+    RUN_TEST(testConfiguresSymbolsBeforeAndAfterStart);
+    RUN_TEST(testFullEventRingPushesBackWithoutBlocking);
+    RUN_TEST(testStopDrainsQueuedCommands);
+    RUN_TEST(testPinsShardThreads);
+    std::filesystem::remove_all(DIRECTORY);
+    return testFailures() == 0 ? 0 : 1;
+}